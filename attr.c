@@ -448,8 +448,11 @@ struct attr_stack {
 	unsigned num_matches;
 	unsigned alloc;
 	struct match_attr **attrs;
+	struct attr_rule_index *index;
 };
 
+static void attr_rule_index_free(struct attr_rule_index *index);
+
 static void attr_stack_free(struct attr_stack *e)
 {
 	int i;
@@ -470,6 +473,7 @@ static void attr_stack_free(struct attr_stack *e)
 		free(a);
 	}
 	free(e->attrs);
+	attr_rule_index_free(e->index);
 	free(e);
 }
 
@@ -621,6 +625,8 @@ struct attr_check_item *attr_check_append(struct attr_check *check,
 	return item;
 }
 
+static void attr_dir_rules_free(struct attr_dir_rules *d);
+
 void attr_check_reset(struct attr_check *check)
 {
 	check->nr = 0;
@@ -636,6 +642,8 @@ void attr_check_clear(struct attr_check *check)
 	check->all_attrs_nr = 0;
 
 	drop_attr_stack(&check->stack);
+	attr_dir_rules_free(check->dir_rules);
+	check->dir_rules = NULL;
 }
 
 void attr_check_free(struct attr_check *check)
@@ -869,14 +877,14 @@ static void push_stack(struct attr_stack **attr_stack_p,
 	}
 }
 
-static void bootstrap_attr_stack(struct index_state *istate,
-				 struct attr_stack **stack)
+static int bootstrap_attr_stack(struct index_state *istate,
+				struct attr_stack **stack)
 {
 	struct attr_stack *e;
 	unsigned flags = READ_ATTR_MACRO_OK;
 
 	if (*stack)
-		return;
+		return 0;
 
 	/* builtin frame */
 	e = read_attr_from_array(builtin_attr);
@@ -906,14 +914,21 @@ static void bootstrap_attr_stack(struct index_state *istate,
 	if (!e)
 		CALLOC_ARRAY(e, 1);
 	push_stack(stack, e, NULL, 0);
+	return 1;
 }
 
-static void prepare_attr_stack(struct index_state *istate,
-			       const char *path, int dirlen,
-			       struct attr_stack **stack)
+/*
+ * Make "stack" the attribute stack for the directory "path[0..dirlen)".
+ * Return 1 if it had to be changed for that, 0 if it was already the
+ * stack for that directory.
+ */
+static int prepare_attr_stack(struct index_state *istate,
+			      const char *path, int dirlen,
+			      struct attr_stack **stack)
 {
 	struct attr_stack *info;
 	struct strbuf pathbuf = STRBUF_INIT;
+	int changed;
 
 	/*
 	 * At the bottom of the attribute stack is the built-in
@@ -930,7 +945,7 @@ static void prepare_attr_stack(struct index_state *istate,
 	 * .gitattributes in deeper directories to shallower ones,
 	 * and finally use the built-in set as the default.
 	 */
-	bootstrap_attr_stack(istate, stack);
+	changed = bootstrap_attr_stack(istate, stack);
 
 	/*
 	 * Pop the "info" one that is always at the top of the stack.
@@ -957,6 +972,7 @@ static void prepare_attr_stack(struct index_state *istate,
 		debug_pop(elem);
 		*stack = elem->prev;
 		attr_stack_free(elem);
+		changed = 1;
 	}
 
 	/*
@@ -993,6 +1009,7 @@ static void prepare_attr_stack(struct index_state *istate,
 
 		origin = xstrdup(pathbuf.buf);
 		push_stack(stack, next, origin, len);
+		changed = 1;
 	}
 
 	/*
@@ -1001,6 +1018,7 @@ static void prepare_attr_stack(struct index_state *istate,
 	push_stack(stack, info, NULL, 0);
 
 	strbuf_release(&pathbuf);
+	return changed;
 }
 
 static int path_matches(const char *pathname, int pathlen,
@@ -1026,6 +1044,265 @@ static int path_matches(const char *pathname, int pathlen,
 			      pattern, prefix, pat->patternlen, pat->flags);
 }
 
+/*
+ * Most rules in large .gitattributes files either name a file ("Makefile")
+ * or an extension ("*.png"). Instead of trying each of them on every path
+ * in turn, the rules of each frame of the stack are indexed when it is
+ * first used: the former by the name and the latter by the suffix they
+ * want, so that only the few that can match a basename need to be looked
+ * at. Everything else (true globs, patterns with a slash) is tried on
+ * every path, except for the patterns with a slash whose leading literal
+ * part cannot match in the directory at hand; see attr_dir_rules.
+ *
+ * A rule list holds the positions of rules in their frame's attrs[],
+ * in ascending order.
+ */
+struct attr_rule_list {
+	int *nr_rule;
+	size_t nr, alloc;
+};
+
+struct attr_rule_index {
+	struct hashmap literal;		/* basename -> attr_rule_list */
+	struct hashmap suffix;		/* suffix -> attr_rule_list */
+	int *suffix_len;		/* lengths of the suffixes, ascending */
+	size_t suffix_len_nr, suffix_len_alloc;
+	struct attr_rule_list other;	/* all other pattern rules */
+	struct attr_rule_list macros;	/* the macro definitions */
+};
+
+static void rule_list_add(struct attr_rule_list *list, int nr)
+{
+	ALLOC_GROW(list->nr_rule, list->nr + 1, list->alloc);
+	list->nr_rule[list->nr++] = nr;
+}
+
+static void rule_map_add(struct hashmap *map, const char *key, size_t keylen,
+			 int nr)
+{
+	struct attr_hash_entry k, *e;
+
+	hashmap_entry_init(&k.ent, memhash(key, keylen));
+	k.key = key;
+	k.keylen = keylen;
+	e = hashmap_get_entry(map, &k, ent, NULL);
+	if (!e) {
+		struct attr_rule_list *list;
+
+		CALLOC_ARRAY(e, 1);
+		hashmap_entry_init(&e->ent, k.ent.hash);
+		e->key = key;
+		e->keylen = keylen;
+		CALLOC_ARRAY(list, 1);
+		e->value = list;
+		hashmap_add(map, &e->ent);
+	}
+	rule_list_add(e->value, nr);
+}
+
+static const struct attr_rule_list *rule_map_get(const struct hashmap *map,
+						 const char *key, size_t keylen)
+{
+	struct attr_hash_entry k, *e;
+
+	hashmap_entry_init(&k.ent, memhash(key, keylen));
+	k.key = key;
+	k.keylen = keylen;
+	e = hashmap_get_entry(map, &k, ent, NULL);
+	return e ? e->value : NULL;
+}
+
+static void rule_map_clear(struct hashmap *map)
+{
+	struct hashmap_iter iter;
+	struct attr_hash_entry *e;
+
+	hashmap_for_each_entry(map, &iter, e, ent) {
+		struct attr_rule_list *list = e->value;
+		free(list->nr_rule);
+		free(list);
+	}
+	hashmap_clear_and_free(map, struct attr_hash_entry, ent);
+}
+
+static void attr_rule_index_free(struct attr_rule_index *index)
+{
+	if (!index)
+		return;
+	rule_map_clear(&index->literal);
+	rule_map_clear(&index->suffix);
+	free(index->suffix_len);
+	free(index->other.nr_rule);
+	free(index->macros.nr_rule);
+	free(index);
+}
+
+static void add_suffix_len(struct attr_rule_index *index, int len)
+{
+	size_t i;
+
+	for (i = 0; i < index->suffix_len_nr; i++)
+		if (index->suffix_len[i] >= len)
+			break;
+	if (i < index->suffix_len_nr && index->suffix_len[i] == len)
+		return;
+	ALLOC_GROW(index->suffix_len, index->suffix_len_nr + 1,
+		   index->suffix_len_alloc);
+	MOVE_ARRAY(index->suffix_len + i + 1, index->suffix_len + i,
+		   index->suffix_len_nr - i);
+	index->suffix_len[i] = len;
+	index->suffix_len_nr++;
+}
+
+static struct attr_rule_index *index_attr_stack(struct attr_stack *stack)
+{
+	struct attr_rule_index *index;
+	int i;
+
+	if (stack->index)
+		return stack->index;
+
+	CALLOC_ARRAY(index, 1);
+	hashmap_init(&index->literal, attr_hash_entry_cmp, NULL, 0);
+	hashmap_init(&index->suffix, attr_hash_entry_cmp, NULL, 0);
+	for (i = 0; i < stack->num_matches; i++) {
+		const struct match_attr *a = stack->attrs[i];
+		const struct pattern *pat = &a->u.pat;
+
+		if (a->is_macro) {
+			rule_list_add(&index->macros, i);
+			continue;
+		}
+		/*
+		 * The hash tables compare names byte for byte, which
+		 * core.ignoreCase does not.
+		 */
+		if (!(pat->flags & PATTERN_FLAG_NODIR) || ignore_case) {
+			rule_list_add(&index->other, i);
+		} else if (pat->nowildcardlen == pat->patternlen) {
+			rule_map_add(&index->literal, pat->pattern,
+				     pat->patternlen, i);
+		} else if (pat->flags & PATTERN_FLAG_ENDSWITH) {
+			rule_map_add(&index->suffix, pat->pattern + 1,
+				     pat->patternlen - 1, i);
+			add_suffix_len(index, pat->patternlen - 1);
+		} else {
+			rule_list_add(&index->other, i);
+		}
+	}
+	stack->index = index;
+	return index;
+}
+
+/*
+ * The rules of each frame of the stack that have to be tried on the
+ * paths in one directory, i.e. those in attr_rule_index.other except
+ * the patterns with a slash that can be ruled out for the directory as
+ * a whole. The attr_check keeps them for the directory of the last path
+ * it looked at, and recomputes them when it moves to another one.
+ */
+struct attr_dir_rules {
+	struct strbuf dir;
+	struct attr_rule_list *frame;	/* from the top of the stack */
+	size_t frame_nr, frame_alloc;
+
+	/* scratch space for fill() */
+	const struct attr_rule_list **lists;
+	size_t *pos;
+	size_t lists_alloc;
+};
+
+static void attr_dir_rules_free(struct attr_dir_rules *d)
+{
+	size_t i;
+
+	if (!d)
+		return;
+	strbuf_release(&d->dir);
+	for (i = 0; i < d->frame_alloc; i++)
+		free(d->frame[i].nr_rule);
+	free(d->frame);
+	free(d->lists);
+	free(d->pos);
+	free(d);
+}
+
+/*
+ * Can a pattern with a slash in frame "stack" match a path in the
+ * directory "path[0..dirlen)"? The name of the path relative to the
+ * directory of the frame starts with the directory part, which must
+ * agree with the literal part of the pattern; what is left of that
+ * must be within the basename, i.e. have no slash.
+ */
+static int may_match_in_dir(const struct attr_stack *stack,
+			    const struct pattern *pat,
+			    const char *path, int dirlen)
+{
+	const char *pattern = pat->pattern;
+	int prefix = pat->nowildcardlen;
+	int baselen = stack->origin ? stack->originlen : 0;
+	const char *name;
+	int namelen;
+
+	if (*pattern == '/') {
+		pattern++;
+		prefix--;
+	}
+	if (dirlen <= baselen) {
+		name = "";
+		namelen = 0;
+	} else {
+		/* include the slash after the directory */
+		name = path + baselen + !!baselen;
+		namelen = dirlen + 1 - baselen - !!baselen;
+	}
+
+	if (prefix <= namelen)
+		return !fspathncmp(pattern, name, prefix);
+	return !fspathncmp(pattern, name, namelen) &&
+		!memchr(pattern + namelen, '/', prefix - namelen);
+}
+
+static void prepare_dir_rules(struct attr_check *check,
+			      const char *path, int dirlen)
+{
+	struct attr_dir_rules *d = check->dir_rules;
+	struct attr_stack *stack;
+	size_t f;
+
+	if (!d) {
+		CALLOC_ARRAY(d, 1);
+		strbuf_init(&d->dir, 0);
+		check->dir_rules = d;
+	}
+	strbuf_reset(&d->dir);
+	strbuf_add(&d->dir, path, dirlen);
+
+	for (f = 0, stack = check->stack; stack; stack = stack->prev, f++) {
+		struct attr_rule_index *index = index_attr_stack(stack);
+		struct attr_rule_list *list;
+		size_t i;
+
+		if (f >= d->frame_alloc) {
+			size_t old = d->frame_alloc;
+			ALLOC_GROW(d->frame, f + 1, d->frame_alloc);
+			memset(d->frame + old, 0,
+			       (d->frame_alloc - old) * sizeof(*d->frame));
+		}
+		list = &d->frame[f];
+		list->nr = 0;
+		for (i = 0; i < index->other.nr; i++) {
+			int nr = index->other.nr_rule[i];
+			const struct pattern *pat = &stack->attrs[nr]->u.pat;
+
+			if ((pat->flags & PATTERN_FLAG_NODIR) ||
+			    may_match_in_dir(stack, pat, path, dirlen))
+				rule_list_add(list, nr);
+		}
+	}
+	d->frame_nr = f;
+}
+
 static int macroexpand_one(struct all_attrs_item *all_attrs, int nr, int rem);
 
 static int fill_one(const char *what, struct all_attrs_item *all_attrs,
@@ -1050,18 +1327,70 @@ static int fill_one(const char *what, struct all_attrs_item *all_attrs,
 	return rem;
 }
 
+static void add_fill_list(struct attr_dir_rules *d, size_t *nr,
+			  const struct attr_rule_list *list)
+{
+	if (!list || !list->nr)
+		return;
+	ALLOC_GROW(d->lists, *nr + 1, d->lists_alloc);
+	REALLOC_ARRAY(d->pos, d->lists_alloc);
+	d->lists[*nr] = list;
+	d->pos[*nr] = list->nr;
+	(*nr)++;
+}
+
+/*
+ * Try the rules that may match the path, frame after frame from the
+ * top of the stack and from the last rule of each frame to the first,
+ * i.e. in the order in which all of them used to be tried.
+ */
 static int fill(const char *path, int pathlen, int basename_offset,
-		const struct attr_stack *stack,
+		const struct attr_stack *stack, struct attr_dir_rules *d,
 		struct all_attrs_item *all_attrs, int rem)
 {
-	for (; rem > 0 && stack; stack = stack->prev) {
-		int i;
+	int isdir = (pathlen && path[pathlen - 1] == '/');
+	const char *basename = path + basename_offset;
+	size_t basenamelen = pathlen - basename_offset - isdir;
+	size_t f;
+
+	for (f = 0; rem > 0 && stack; stack = stack->prev, f++) {
 		const char *base = stack->origin ? stack->origin : "";
+		const struct attr_rule_index *index = stack->index;
+		size_t i, nr = 0;
+
+		add_fill_list(d, &nr, &d->frame[f]);
+		add_fill_list(d, &nr, rule_map_get(&index->literal,
+						   basename, basenamelen));
+		for (i = 0; i < index->suffix_len_nr; i++) {
+			size_t len = index->suffix_len[i];
+			if (len > basenamelen)
+				break;
+			add_fill_list(d, &nr,
+				      rule_map_get(&index->suffix,
+						   basename + basenamelen - len,
+						   len));
+		}
+
+		while (0 < rem) {
+			const struct match_attr *a;
+			size_t best = nr;
+			int best_rule = -1;
+
+			for (i = 0; i < nr; i++) {
+				int r;
+				if (!d->pos[i])
+					continue;
+				r = d->lists[i]->nr_rule[d->pos[i] - 1];
+				if (r > best_rule) {
+					best_rule = r;
+					best = i;
+				}
+			}
+			if (best == nr)
+				break;
+			d->pos[best]--;
 
-		for (i = stack->num_matches - 1; 0 < rem && 0 <= i; i--) {
-			const struct match_attr *a = stack->attrs[i];
-			if (a->is_macro)
-				continue;
+			a = stack->attrs[best_rule];
 			if (path_matches(path, pathlen, basename_offset,
 					 &a->u.pat, base, stack->originlen))
 				rem = fill_one("fill", all_attrs, a, rem);
@@ -1090,14 +1419,13 @@ static void determine_macros(struct all_attrs_item *all_attrs,
 			     const struct attr_stack *stack)
 {
 	for (; stack; stack = stack->prev) {
+		const struct attr_rule_list *macros = &stack->index->macros;
 		int i;
-		for (i = stack->num_matches - 1; i >= 0; i--) {
-			const struct match_attr *ma = stack->attrs[i];
-			if (ma->is_macro) {
-				int n = ma->u.attr->attr_nr;
-				if (!all_attrs[n].macro) {
-					all_attrs[n].macro = ma;
-				}
+		for (i = macros->nr - 1; i >= 0; i--) {
+			const struct match_attr *ma = stack->attrs[macros->nr_rule[i]];
+			int n = ma->u.attr->attr_nr;
+			if (!all_attrs[n].macro) {
+				all_attrs[n].macro = ma;
 			}
 		}
 	}
@@ -1129,12 +1457,16 @@ static void collect_some_attrs(struct index_state *istate,
 		dirlen = 0;
 	}
 
-	prepare_attr_stack(istate, path, dirlen, &check->stack);
+	if (prepare_attr_stack(istate, path, dirlen, &check->stack) ||
+	    !check->dir_rules || check->dir_rules->dir.len != dirlen ||
+	    memcmp(check->dir_rules->dir.buf, path, dirlen))
+		prepare_dir_rules(check, path, dirlen);
 	all_attrs_init(&g_attr_hashmap, check);
 	determine_macros(check->all_attrs, check->stack);
 
 	rem = check->all_attrs_nr;
-	fill(path, pathlen, basename_offset, check->stack, check->all_attrs, rem);
+	fill(path, pathlen, basename_offset, check->stack, check->dir_rules,
+	     check->all_attrs, rem);
 }
 
 void git_check_attr(struct index_state *istate,
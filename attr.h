@@ -170,6 +170,7 @@ struct attr_check {
 	int all_attrs_nr;
 	struct all_attrs_item *all_attrs;
 	struct attr_stack *stack;
+	struct attr_dir_rules *dir_rules;
 };
 
 struct attr_check *attr_check_alloc(void);
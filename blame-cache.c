@@ -0,0 +1,292 @@
+#include "cache.h"
+#include "blame-cache.h"
+#include "dir.h"
+#include "lockfile.h"
+#include "quote.h"
+#include "repository.h"
+
+#define BLAME_CACHE_SIGNATURE "blame-cache 2"
+
+void blame_cache_init(struct blame_cache *cache, struct repository *repo,
+		      const char *options)
+{
+	cache->repo = repo;
+	strbuf_init(&cache->options, 0);
+	strbuf_addstr(&cache->options, options);
+}
+
+void blame_cache_clear(struct blame_cache *cache)
+{
+	strbuf_release(&cache->options);
+}
+
+static void blame_cache_origin_release(struct blame_cache_origin *o)
+{
+	FREE_AND_NULL(o->path);
+}
+
+void blame_cache_result_release(struct blame_cache_result *result)
+{
+	int i;
+
+	for (i = 0; i < result->suspect_nr; i++) {
+		blame_cache_origin_release(&result->suspect[i].origin);
+		blame_cache_origin_release(&result->suspect[i].previous);
+	}
+	FREE_AND_NULL(result->suspect);
+	FREE_AND_NULL(result->entry);
+	result->suspect_nr = result->suspect_alloc = 0;
+	result->entry_nr = result->entry_alloc = 0;
+}
+
+/*
+ * The file for a key lives at "blame-cache/xx/yyyy..." where "xxyyyy..."
+ * is the hash of the commit, the path and the options.
+ */
+static void blame_cache_path(struct blame_cache *cache, struct strbuf *out,
+			     const struct object_id *commit, const char *path)
+{
+	const struct git_hash_algo *algo = cache->repo->hash_algo;
+	unsigned char hash[GIT_MAX_RAWSZ];
+	const char *hex;
+	git_hash_ctx ctx;
+
+	algo->init_fn(&ctx);
+	algo->update_fn(&ctx, commit->hash, algo->rawsz);
+	algo->update_fn(&ctx, path, strlen(path) + 1);
+	algo->update_fn(&ctx, cache->options.buf, cache->options.len);
+	algo->final_fn(hash, &ctx);
+
+	hex = hash_to_hex_algop(hash, algo);
+	strbuf_repo_git_path(out, cache->repo, "blame-cache/%.2s/%s",
+			     hex, hex + 2);
+}
+
+static int parse_origin(const char *p, struct blame_cache_origin *o,
+			const struct git_hash_algo *algo)
+{
+	struct strbuf path = STRBUF_INIT;
+	char *end;
+
+	if (parse_oid_hex_algop(p, &o->commit, &p, algo) || *p++ != ' ' ||
+	    parse_oid_hex_algop(p, &o->blob, &p, algo) || *p++ != ' ')
+		return -1;
+	o->mode = strtoul(p, &end, 8);
+	if (end == p || *end++ != ' ')
+		return -1;
+	if (*end == '"') {
+		if (unquote_c_style(&path, end, &p) || *p) {
+			strbuf_release(&path);
+			return -1;
+		}
+		o->path = strbuf_detach(&path, NULL);
+	} else {
+		o->path = xstrdup(end);
+	}
+	return 0;
+}
+
+static int parse_int(const char *p, const char **endp, int *v)
+{
+	char *end;
+	long l = strtol(p, &end, 10);
+
+	if (end == p || l < 0 || l > INT_MAX)
+		return -1;
+	*v = l;
+	*endp = end;
+	return 0;
+}
+
+static int parse_entry(const char *p, struct blame_cache_entry *e)
+{
+	if (parse_int(p, &p, &e->lno) || *p++ != ' ' ||
+	    parse_int(p, &p, &e->num_lines) || *p++ != ' ' ||
+	    parse_int(p, &p, &e->s_lno) || *p++ != ' ' ||
+	    parse_int(p, &p, &e->suspect) || *p)
+		return -1;
+	return 0;
+}
+
+/*
+ * Make sure that the entries are consistent, and stay within the blobs
+ * they refer to, so that callers can use them without checking.
+ */
+static int verify_result(const struct blame_cache_result *result)
+{
+	int i, lno = 0;
+
+	for (i = 0; i < result->entry_nr; i++) {
+		const struct blame_cache_entry *e = &result->entry[i];
+		int suspect_lines;
+
+		if (e->lno != lno || !e->num_lines ||
+		    e->num_lines > result->num_lines - lno ||
+		    e->suspect >= result->suspect_nr)
+			return -1;
+		suspect_lines = result->suspect[e->suspect].num_lines;
+		if (e->s_lno > suspect_lines ||
+		    e->num_lines > suspect_lines - e->s_lno)
+			return -1;
+		lno += e->num_lines;
+	}
+	return lno == result->num_lines ? 0 : -1;
+}
+
+int blame_cache_read(struct blame_cache *cache,
+		     const struct object_id *commit, const char *path,
+		     struct blame_cache_result *result)
+{
+	const struct git_hash_algo *algo = cache->repo->hash_algo;
+	struct strbuf file = STRBUF_INIT;
+	struct strbuf line = STRBUF_INIT;
+	const char *p;
+	FILE *fp;
+	int ret = -1;
+
+	blame_cache_path(cache, &file, commit, path);
+	fp = fopen(file.buf, "r");
+	if (!fp)
+		goto out;
+
+	if (strbuf_getline_lf(&line, fp) ||
+	    strcmp(line.buf, BLAME_CACHE_SIGNATURE) ||
+	    strbuf_getline_lf(&line, fp) ||
+	    !skip_prefix(line.buf, "blob ", &p) ||
+	    parse_oid_hex_algop(p, &result->blob, &p, algo) ||
+	    *p++ != ' ' || parse_int(p, &p, &result->num_lines) || *p)
+		goto out;
+
+	while (!strbuf_getline_lf(&line, fp)) {
+		if (skip_prefix(line.buf, "suspect ", &p)) {
+			struct blame_cache_suspect *s;
+
+			ALLOC_GROW(result->suspect, result->suspect_nr + 1,
+				   result->suspect_alloc);
+			s = &result->suspect[result->suspect_nr++];
+			memset(s, 0, sizeof(*s));
+			if (parse_int(p, &p, &s->num_lines) || *p++ != ' ' ||
+			    parse_origin(p, &s->origin, algo))
+				goto out;
+		} else if (skip_prefix(line.buf, "previous ", &p)) {
+			struct blame_cache_suspect *s;
+
+			if (!result->suspect_nr)
+				goto out;
+			s = &result->suspect[result->suspect_nr - 1];
+			if (s->previous.path || parse_origin(p, &s->previous, algo))
+				goto out;
+		} else if (skip_prefix(line.buf, "entry ", &p)) {
+			ALLOC_GROW(result->entry, result->entry_nr + 1,
+				   result->entry_alloc);
+			if (parse_entry(p, &result->entry[result->entry_nr++]))
+				goto out;
+		} else {
+			goto out;
+		}
+	}
+	ret = verify_result(result);
+	/* keep the results that are in use from being pruned */
+	if (!ret)
+		utime(file.buf, NULL);
+
+out:
+	if (fp)
+		fclose(fp);
+	if (ret)
+		blame_cache_result_release(result);
+	strbuf_release(&file);
+	strbuf_release(&line);
+	return ret;
+}
+
+static void add_origin(struct strbuf *out,
+		       const struct blame_cache_origin *o)
+{
+	strbuf_addf(out, "%s %s %06o ", oid_to_hex(&o->commit),
+		    oid_to_hex(&o->blob), o->mode);
+	quote_c_style(o->path, out, NULL, 0);
+	strbuf_addch(out, '\n');
+}
+
+void blame_cache_write(struct blame_cache *cache,
+		       const struct object_id *commit, const char *path,
+		       const struct blame_cache_result *result)
+{
+	struct lock_file lk = LOCK_INIT;
+	struct strbuf file = STRBUF_INIT;
+	struct strbuf buf = STRBUF_INIT;
+	int i, fd;
+
+	blame_cache_path(cache, &file, commit, path);
+	if (safe_create_leading_directories(file.buf))
+		goto out;
+	/* somebody else is storing the same result */
+	fd = hold_lock_file_for_update(&lk, file.buf, 0);
+	if (fd < 0)
+		goto out;
+
+	strbuf_addf(&buf, "%s\nblob %s %d\n", BLAME_CACHE_SIGNATURE,
+		    oid_to_hex(&result->blob), result->num_lines);
+	for (i = 0; i < result->suspect_nr; i++) {
+		const struct blame_cache_suspect *s = &result->suspect[i];
+
+		strbuf_addf(&buf, "suspect %d ", s->num_lines);
+		add_origin(&buf, &s->origin);
+		if (s->previous.path) {
+			strbuf_addstr(&buf, "previous ");
+			add_origin(&buf, &s->previous);
+		}
+	}
+	for (i = 0; i < result->entry_nr; i++) {
+		const struct blame_cache_entry *e = &result->entry[i];
+
+		strbuf_addf(&buf, "entry %d %d %d %d\n",
+			    e->lno, e->num_lines, e->s_lno, e->suspect);
+	}
+
+	if (write_in_full(fd, buf.buf, buf.len) < 0 || commit_lock_file(&lk))
+		rollback_lock_file(&lk);
+
+out:
+	strbuf_release(&file);
+	strbuf_release(&buf);
+}
+
+void blame_cache_prune(struct repository *repo, timestamp_t expire)
+{
+	struct strbuf path = STRBUF_INIT;
+	size_t baselen, dirlen;
+	DIR *dir, *subdir;
+	struct dirent *e, *f;
+	struct stat st;
+
+	strbuf_repo_git_path(&path, repo, "blame-cache");
+	dir = opendir(path.buf);
+	if (!dir)
+		goto out;
+	strbuf_addch(&path, '/');
+	baselen = path.len;
+	while ((e = readdir_skip_dot_and_dotdot(dir))) {
+		strbuf_setlen(&path, baselen);
+		strbuf_addstr(&path, e->d_name);
+		subdir = opendir(path.buf);
+		if (!subdir)
+			continue;
+		strbuf_addch(&path, '/');
+		dirlen = path.len;
+		while ((f = readdir_skip_dot_and_dotdot(subdir))) {
+			strbuf_setlen(&path, dirlen);
+			strbuf_addstr(&path, f->d_name);
+			if (!lstat(path.buf, &st) && st.st_mtime <= expire)
+				unlink_or_warn(path.buf);
+		}
+		closedir(subdir);
+		strbuf_setlen(&path, dirlen - 1);
+		rmdir(path.buf);
+	}
+	closedir(dir);
+
+out:
+	strbuf_release(&path);
+}
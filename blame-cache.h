@@ -0,0 +1,103 @@
+#ifndef BLAME_CACHE_H
+#define BLAME_CACHE_H
+
+#include "hash.h"
+#include "strbuf.h"
+
+struct repository;
+
+/*
+ * An on-disk cache of final blame results, kept in "$GIT_DIR/blame-cache".
+ *
+ * A result is stored under a key made of a commit, a path and the options
+ * that influence how blame is assigned, and describes which commit is to
+ * blame for each line of the blob at that path in that commit. As commits
+ * are immutable, a result never goes stale; the cache can be removed at any
+ * time to reclaim disk space, and blame_cache_prune() drops the results that
+ * have not been used for a while.
+ */
+struct blame_cache {
+	struct repository *repo;
+	/* mixed into every key, see blame_cache_init() */
+	struct strbuf options;
+};
+
+/*
+ * An origin referred to by a cached result: the blob at "path" in
+ * "commit".
+ */
+struct blame_cache_origin {
+	struct object_id commit;
+	struct object_id blob;
+	unsigned mode;
+	char *path;
+};
+
+struct blame_cache_suspect {
+	struct blame_cache_origin origin;
+	/* the number of lines in the blob of "origin" */
+	int num_lines;
+	/* where the lines came from before "origin"; a null commit if none */
+	struct blame_cache_origin previous;
+};
+
+/*
+ * Lines [lno, lno + num_lines) of the blob are to be blamed on the
+ * lines starting at s_lno in the blob of suspect number "suspect".
+ */
+struct blame_cache_entry {
+	int lno;
+	int num_lines;
+	int s_lno;
+	int suspect;
+};
+
+struct blame_cache_result {
+	struct object_id blob;
+	int num_lines;
+
+	struct blame_cache_suspect *suspect;
+	int suspect_nr, suspect_alloc;
+
+	/* sorted by lno, and covering all of the lines of the blob */
+	struct blame_cache_entry *entry;
+	int entry_nr, entry_alloc;
+};
+
+#define BLAME_CACHE_RESULT_INIT { 0 }
+
+/*
+ * Prepare to look up and store results in the cache of "repo". Results are
+ * only shared between invocations that pass the same "options", which must
+ * therefore describe everything other than the history itself that affects
+ * the outcome of blame.
+ */
+void blame_cache_init(struct blame_cache *cache, struct repository *repo,
+		      const char *options);
+void blame_cache_clear(struct blame_cache *cache);
+
+/*
+ * Read the result for "path" in "commit" into "result". Returns 0 on
+ * success, and -1 if there is no usable result in the cache.
+ */
+int blame_cache_read(struct blame_cache *cache,
+		     const struct object_id *commit, const char *path,
+		     struct blame_cache_result *result);
+
+/*
+ * Store "result" as the result for "path" in "commit". Failing to do
+ * so is not an error, and is silently ignored.
+ */
+void blame_cache_write(struct blame_cache *cache,
+		       const struct object_id *commit, const char *path,
+		       const struct blame_cache_result *result);
+
+void blame_cache_result_release(struct blame_cache_result *result);
+
+/*
+ * Remove the results of "repo" that have been neither stored nor read
+ * since "expire".
+ */
+void blame_cache_prune(struct repository *repo, timestamp_t expire);
+
+#endif /* BLAME_CACHE_H */
@@ -11,6 +11,12 @@
 #include "commit-slab.h"
 #include "bloom.h"
 #include "commit-graph.h"
+#include "thread-utils.h"
+#include "list.h"
+#include "blame-cache.h"
+#include "replace-object.h"
+#include "shallow.h"
+#include "userdiff.h"
 
 define_commit_slab(blame_suspects, struct blame_origin *);
 static struct blame_suspects blame_suspects;
@@ -29,10 +35,13 @@ static void set_blame_suspects(struct commit *commit, struct blame_origin *origi
 	*blame_suspects_at(&blame_suspects, commit) = origin;
 }
 
+static void free_prefetch(struct blame_origin *o);
+
 void blame_origin_decref(struct blame_origin *o)
 {
 	if (o && --o->refcnt <= 0) {
 		struct blame_origin *p, *l = NULL;
+		free_prefetch(o);
 		if (o->previous)
 			blame_origin_decref(o->previous);
 		free(o->file.ptr);
@@ -313,6 +322,266 @@ static int diff_hunks(mmfile_t *file_a, mmfile_t *file_b,
 	return xdi_diff(file_a, file_b, &xpp, &xecfg, &ecb);
 }
 
+/*
+ * With sb->num_threads > 1, the diffs between the suspects near the
+ * head of the queue and their parents are run ahead of time by worker
+ * threads (see prefetch_ahead()). Only the diff itself runs in the
+ * workers; finding the parents' origins, reading the blobs and
+ * splitting the blame entries all still happen on the main thread, in
+ * the usual order, so the result does not depend on the number of
+ * threads.
+ */
+struct blame_hunk {
+	long start_a, count_a;
+	long start_b, count_b;
+};
+
+struct blame_diff_job {
+	struct blame_diff_job *next;
+	/* holds a reference; the parent this diff is against */
+	struct blame_origin *parent;
+	/* private copies, as the origins may drop their blobs meanwhile */
+	mmfile_t file_p, file_o;
+	int xdl_opts;
+
+	/* protected by the workers' mutex */
+	int started;
+
+	/* filled by the worker */
+	struct blame_hunk *hunks;
+	size_t hunks_nr, hunks_alloc;
+	int ret;
+	int done;
+};
+
+struct blame_prefetch {
+	struct list_head list;
+	struct blame_workers *workers;
+	struct blame_origin *owner;
+
+	/*
+	 * What find_origin() returned for the first "looked_up"
+	 * scapegoats (holding a reference), and the diff jobs against
+	 * them.
+	 */
+	int looked_up;
+	struct blame_origin **sg_origin;
+	struct blame_diff_job **jobs;
+};
+
+struct blame_workers {
+	int nr;
+	pthread_t *threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	struct blame_diff_job *queue, **queue_tail;
+	int quit;
+
+	/* all live blame_prefetch structures */
+	struct list_head prefetches;
+};
+
+static int prefetch_count_queued;
+static int prefetch_count_used;
+
+static int record_hunk(long start_a, long count_a,
+		       long start_b, long count_b, void *data)
+{
+	struct blame_diff_job *job = data;
+	struct blame_hunk *h;
+
+	ALLOC_GROW(job->hunks, job->hunks_nr + 1, job->hunks_alloc);
+	h = &job->hunks[job->hunks_nr++];
+	h->start_a = start_a;
+	h->count_a = count_a;
+	h->start_b = start_b;
+	h->count_b = count_b;
+	return 0;
+}
+
+static void *blame_worker(void *data)
+{
+	struct blame_workers *w = data;
+
+	pthread_mutex_lock(&w->mutex);
+	for (;;) {
+		struct blame_diff_job *job;
+
+		while (!w->queue && !w->quit)
+			pthread_cond_wait(&w->work_cond, &w->mutex);
+		if (!w->queue)
+			break;
+		job = w->queue;
+		w->queue = job->next;
+		if (!w->queue)
+			w->queue_tail = &w->queue;
+		job->started = 1;
+		pthread_mutex_unlock(&w->mutex);
+
+		job->ret = diff_hunks(&job->file_p, &job->file_o,
+				      record_hunk, job, job->xdl_opts);
+
+		pthread_mutex_lock(&w->mutex);
+		job->done = 1;
+		pthread_cond_broadcast(&w->done_cond);
+	}
+	pthread_mutex_unlock(&w->mutex);
+	return NULL;
+}
+
+static struct blame_workers *start_workers(int nr)
+{
+	struct blame_workers *w;
+	int i;
+
+	CALLOC_ARRAY(w, 1);
+	pthread_mutex_init(&w->mutex, NULL);
+	pthread_cond_init(&w->work_cond, NULL);
+	pthread_cond_init(&w->done_cond, NULL);
+	w->queue_tail = &w->queue;
+	INIT_LIST_HEAD(&w->prefetches);
+
+	CALLOC_ARRAY(w->threads, nr);
+	for (i = 0; i < nr; i++) {
+		int err = pthread_create(&w->threads[i], NULL, blame_worker, w);
+
+		if (err) {
+			warning(_("unable to create blame thread: %s"),
+				strerror(err));
+			break;
+		}
+	}
+	w->nr = i;
+	if (!w->nr) {
+		pthread_mutex_destroy(&w->mutex);
+		pthread_cond_destroy(&w->work_cond);
+		pthread_cond_destroy(&w->done_cond);
+		free(w->threads);
+		FREE_AND_NULL(w);
+	}
+	return w;
+}
+
+static void queue_diff_job(struct blame_workers *w, struct blame_diff_job *job)
+{
+	prefetch_count_queued++;
+	pthread_mutex_lock(&w->mutex);
+	*w->queue_tail = job;
+	w->queue_tail = &job->next;
+	pthread_cond_signal(&w->work_cond);
+	pthread_mutex_unlock(&w->mutex);
+}
+
+static void wait_diff_job(struct blame_workers *w, struct blame_diff_job *job)
+{
+	pthread_mutex_lock(&w->mutex);
+	while (!job->done)
+		pthread_cond_wait(&w->done_cond, &w->mutex);
+	pthread_mutex_unlock(&w->mutex);
+}
+
+static void free_diff_job(struct blame_workers *w, struct blame_diff_job *job)
+{
+	if (!job)
+		return;
+
+	/* Nobody needs it anymore; do not bother running it. */
+	pthread_mutex_lock(&w->mutex);
+	if (!job->started) {
+		struct blame_diff_job **p = &w->queue;
+
+		while (*p != job)
+			p = &(*p)->next;
+		*p = job->next;
+		if (w->queue_tail == &job->next)
+			w->queue_tail = p;
+		job->done = 1;
+	}
+	while (!job->done)
+		pthread_cond_wait(&w->done_cond, &w->mutex);
+	pthread_mutex_unlock(&w->mutex);
+
+	free(job->file_p.ptr);
+	free(job->file_o.ptr);
+	free(job->hunks);
+	blame_origin_decref(job->parent);
+	free(job);
+}
+
+static void free_prefetch(struct blame_origin *o)
+{
+	struct blame_prefetch *pf = o->prefetch;
+	int i;
+
+	if (!pf)
+		return;
+	o->prefetch = NULL;
+	list_del(&pf->list);
+	for (i = 0; i < pf->looked_up; i++) {
+		free_diff_job(pf->workers, pf->jobs[i]);
+		blame_origin_decref(pf->sg_origin[i]);
+	}
+	free(pf->sg_origin);
+	free(pf->jobs);
+	free(pf);
+}
+
+static void stop_workers(struct blame_scoreboard *sb, struct blame_workers *w)
+{
+	int i;
+
+	pthread_mutex_lock(&w->mutex);
+	w->quit = 1;
+	pthread_cond_broadcast(&w->work_cond);
+	pthread_mutex_unlock(&w->mutex);
+
+	for (i = 0; i < w->nr; i++)
+		pthread_join(w->threads[i], NULL);
+
+	while (!list_empty(&w->prefetches)) {
+		struct blame_prefetch *pf =
+			list_first_entry(&w->prefetches, struct blame_prefetch, list);
+		free_prefetch(pf->owner);
+	}
+
+	pthread_mutex_destroy(&w->mutex);
+	pthread_cond_destroy(&w->work_cond);
+	pthread_cond_destroy(&w->done_cond);
+	free(w->threads);
+	free(w);
+
+	trace2_data_intmax("blame", sb->repo,
+			   "prefetch/diffs-queued", prefetch_count_queued);
+	trace2_data_intmax("blame", sb->repo,
+			   "prefetch/diffs-used", prefetch_count_used);
+}
+
+/*
+ * Take the diff between "parent" and "target" computed ahead of time,
+ * if there is one.
+ */
+static struct blame_diff_job *take_diff_job(struct blame_origin *target,
+					    struct blame_origin *parent)
+{
+	struct blame_prefetch *pf = target->prefetch;
+	int i;
+
+	if (!pf)
+		return NULL;
+	for (i = 0; i < pf->looked_up; i++) {
+		struct blame_diff_job *job = pf->jobs[i];
+
+		if (job && job->parent == parent) {
+			prefetch_count_used++;
+			pf->jobs[i] = NULL;
+			wait_diff_job(pf->workers, job);
+			return job;
+		}
+	}
+	return NULL;
+}
+
 static const char *get_next_line(const char *start, const char *end)
 {
 	const char *nl = memchr(start, '\n', end - start);
@@ -1010,9 +1279,20 @@ static void drop_origin_fingerprints(struct blame_origin *o)
 	}
 }
 
+/* Count the blob of "o" as read, now that blame uses it. */
+static void use_prefetched_blob(struct blame_origin *o, int *num_read_blob)
+{
+	if (o->file_prefetched) {
+		(*num_read_blob)++;
+		o->file_prefetched = 0;
+	}
+}
+
 /*
  * Given an origin, prepare mmfile_t structure to be used by the
- * diff machinery
+ * diff machinery. A prefetch passes a NULL "num_read_blob"; the blob
+ * is then only counted once blame uses it, so that the count does not
+ * depend on how far ahead the prefetch got.
  */
 static void fill_origin_blob(struct diff_options *opt,
 			     struct blame_origin *o, mmfile_t *file,
@@ -1022,7 +1302,10 @@ static void fill_origin_blob(struct diff_options *opt,
 		enum object_type type;
 		unsigned long file_size;
 
-		(*num_read_blob)++;
+		if (num_read_blob)
+			(*num_read_blob)++;
+		else
+			o->file_prefetched = 1;
 		if (opt->flags.allow_textconv &&
 		    textconv_object(opt->repo, o->path, o->mode,
 				    &o->blob_oid, 1, &file->ptr, &file_size))
@@ -1038,15 +1321,36 @@ static void fill_origin_blob(struct diff_options *opt,
 			    o->path);
 		o->file = *file;
 	}
-	else
+	else {
 		*file = o->file;
+		if (num_read_blob)
+			use_prefetched_blob(o, num_read_blob);
+	}
 	if (fill_fingerprints)
 		fill_origin_fingerprints(o);
 }
 
+/*
+ * Blame uses the blob of "o" through the copy in a diff job. If the
+ * blob was dropped since the job was queued, blame would have read it
+ * again; count it, and keep the copy for later uses, as that would.
+ */
+static void use_job_blob(struct blame_origin *o, mmfile_t *file,
+			 int *num_read_blob)
+{
+	if (o->file.ptr) {
+		use_prefetched_blob(o, num_read_blob);
+		return;
+	}
+	o->file = *file;
+	file->ptr = NULL;
+	(*num_read_blob)++;
+}
+
 static void drop_origin_blob(struct blame_origin *o)
 {
 	FREE_AND_NULL(o->file.ptr);
+	o->file_prefetched = 0;
 	drop_origin_fingerprints(o);
 }
 
@@ -1941,6 +2245,8 @@ static void pass_blame_to_parent(struct blame_scoreboard *sb,
 	mmfile_t file_p, file_o;
 	struct blame_chunk_cb_data d;
 	struct blame_entry *newdest = NULL;
+	struct blame_diff_job *job = NULL;
+	int ret;
 
 	if (!target->suspects)
 		return; /* nothing remains for this target */
@@ -1951,13 +2257,32 @@ static void pass_blame_to_parent(struct blame_scoreboard *sb,
 	d.ignore_diffs = ignore_diffs;
 	d.dstq = &newdest; d.srcq = &target->suspects;
 
-	fill_origin_blob(&sb->revs->diffopt, parent, &file_p,
-			 &sb->num_read_blob, ignore_diffs);
-	fill_origin_blob(&sb->revs->diffopt, target, &file_o,
-			 &sb->num_read_blob, ignore_diffs);
+	if (!ignore_diffs)
+		job = take_diff_job(target, parent);
+	if (job) {
+		size_t i;
+
+		for (i = 0; i < job->hunks_nr; i++) {
+			struct blame_hunk *h = &job->hunks[i];
+
+			blame_chunk_cb(h->start_a, h->count_a,
+				       h->start_b, h->count_b, &d);
+		}
+		ret = job->ret;
+		use_job_blob(parent, &job->file_p, &sb->num_read_blob);
+		use_job_blob(target, &job->file_o, &sb->num_read_blob);
+		free_diff_job(target->prefetch->workers, job);
+	} else {
+		fill_origin_blob(&sb->revs->diffopt, parent, &file_p,
+				 &sb->num_read_blob, ignore_diffs);
+		fill_origin_blob(&sb->revs->diffopt, target, &file_o,
+				 &sb->num_read_blob, ignore_diffs);
+		ret = diff_hunks(&file_p, &file_o, blame_chunk_cb, &d,
+				 sb->xdl_opts);
+	}
 	sb->num_get_patch++;
 
-	if (diff_hunks(&file_p, &file_o, blame_chunk_cb, &d, sb->xdl_opts))
+	if (ret)
 		die("unable to generate diff (%s -> %s)",
 		    oid_to_hex(&parent->commit->object.oid),
 		    oid_to_hex(&target->commit->object.oid));
@@ -2343,7 +2668,9 @@ static void pass_whole_blame(struct blame_scoreboard *sb,
 	if (!porigin->file.ptr && origin->file.ptr) {
 		/* Steal its file */
 		porigin->file = origin->file;
+		porigin->file_prefetched = origin->file_prefetched;
 		origin->file.ptr = NULL;
+		origin->file_prefetched = 0;
 	}
 	suspects = origin->suspects;
 	origin->suspects = NULL;
@@ -2381,6 +2708,121 @@ static int num_scapegoats(struct rev_info *revs, struct commit *commit, int reve
 	return commit_list_count(l);
 }
 
+/*
+ * Look up the parents that "origin" will pass blame to, and start
+ * diffing against them in the background, so that pass_blame() finds
+ * the work done when it gets to "origin".
+ *
+ * This must not change the outcome: find_origin() returns the same
+ * origin whenever it is called, and the diffs only depend on the blobs.
+ * In particular, this leaves the commit's parents alone, which
+ * first_scapegoat() would trim with --first-parent.
+ */
+static void prefetch_origin(struct blame_scoreboard *sb,
+			    struct blame_workers *w, struct blame_origin *origin)
+{
+	struct rev_info *revs = sb->revs;
+	struct commit *commit = origin->commit;
+	struct blame_prefetch *pf;
+	struct commit_list *sg;
+	int i, num_sg;
+
+	if (origin->prefetch)
+		return;
+	if (parse_commit(commit) ||
+	    commit->object.flags & UNINTERESTING ||
+	    (revs->max_age != -1 && commit->date < revs->max_age))
+		return;
+	num_sg = commit_list_count(commit->parents);
+	if (revs->first_parent_only && num_sg > 1)
+		num_sg = 1;
+	if (!num_sg)
+		return;
+
+	CALLOC_ARRAY(pf, 1);
+	pf->workers = w;
+	pf->owner = origin;
+	CALLOC_ARRAY(pf->sg_origin, num_sg);
+	CALLOC_ARRAY(pf->jobs, num_sg);
+	list_add_tail(&pf->list, &w->prefetches);
+	origin->prefetch = pf;
+
+	for (i = 0, sg = commit->parents;
+	     i < num_sg && sg;
+	     sg = sg->next, i++) {
+		struct blame_origin *porigin;
+		struct blame_diff_job *job;
+		mmfile_t file;
+		int j;
+
+		pf->looked_up = i + 1;
+		if (parse_commit(sg->item))
+			continue;
+		porigin = find_origin(sb->repo, sg->item, origin, sb->bloom_data);
+		pf->sg_origin[i] = porigin;
+		if (!porigin)
+			continue;
+		/* pass_blame() will pass the whole blame, without a diff */
+		if (oideq(&porigin->blob_oid, &origin->blob_oid))
+			break;
+		for (j = 0; j < i; j++)
+			if (pf->sg_origin[j] &&
+			    oideq(&pf->sg_origin[j]->blob_oid, &porigin->blob_oid))
+				break;
+		if (j < i)
+			continue;
+
+		CALLOC_ARRAY(job, 1);
+		job->parent = blame_origin_incref(porigin);
+		job->xdl_opts = sb->xdl_opts;
+		fill_origin_blob(&revs->diffopt, porigin, &file, NULL, 0);
+		job->file_p.ptr = xmemdupz(file.ptr, file.size);
+		job->file_p.size = file.size;
+		fill_origin_blob(&revs->diffopt, origin, &file, NULL, 0);
+		job->file_o.ptr = xmemdupz(file.ptr, file.size);
+		job->file_o.size = file.size;
+		pf->jobs[i] = job;
+		queue_diff_job(w, job);
+	}
+}
+
+/*
+ * Prefetch the origins that are likely to be processed soon: those
+ * of the commits at the head of the queue, and their ancestors as far
+ * as we already know them. With a linear history, the queue holds a
+ * single commit, and it is only the latter that keeps the workers busy.
+ */
+static void prefetch_ahead(struct blame_scoreboard *sb,
+			   struct blame_workers *w, struct blame_origin *origin)
+{
+	struct blame_origin **todo;
+	int nr = 0, pos, i, window = 4 * w->nr;
+
+	ALLOC_ARRAY(todo, window);
+	todo[nr++] = origin;
+	for (i = 0; i < sb->commits.nr && nr < window; i++) {
+		struct blame_origin *o = get_blame_suspects(sb->commits.array[i].data);
+
+		while (o && !o->suspects)
+			o = o->next;
+		if (o)
+			todo[nr++] = o;
+	}
+
+	for (pos = 0; pos < nr; pos++) {
+		struct blame_prefetch *pf;
+
+		prefetch_origin(sb, w, todo[pos]);
+		pf = todo[pos]->prefetch;
+		if (!pf)
+			continue;
+		for (i = 0; i < pf->looked_up && nr < window; i++)
+			if (pf->sg_origin[i])
+				todo[nr++] = pf->sg_origin[i];
+	}
+	free(todo);
+}
+
 /* Distribute collected unsorted blames to the respected sorted lists
  * in the various origins.
  */
@@ -2444,9 +2886,15 @@ static void pass_blame(struct blame_scoreboard *sb, struct blame_origin *origin,
 
 			if (sg_origin[i])
 				continue;
-			if (parse_commit(p))
+			if (!pass && origin->prefetch &&
+			    i < origin->prefetch->looked_up) {
+				/* find_origin() was called ahead of time */
+				porigin = origin->prefetch->sg_origin[i];
+				origin->prefetch->sg_origin[i] = NULL;
+			} else if (parse_commit(p))
 				continue;
-			porigin = find(sb->repo, p, origin, sb->bloom_data);
+			else
+				porigin = find(sb->repo, p, origin, sb->bloom_data);
 			if (!porigin)
 				continue;
 			if (oideq(&porigin->blob_oid, &origin->blob_oid)) {
@@ -2574,10 +3022,287 @@ static void pass_blame(struct blame_scoreboard *sb, struct blame_origin *origin,
 		}
 	}
 	drop_origin_blob(origin);
+	free_prefetch(origin);
 	if (sg_buf != sg_origin)
 		free(sg_origin);
 }
 
+static int has_textconv(struct userdiff_driver *driver,
+			enum userdiff_driver_type type, void *data)
+{
+	return !!driver->textconv;
+}
+
+/*
+ * Open the blame cache if it was asked for, and if cached results can
+ * stand in for walking the history.  That is not the case when the
+ * walk is limited, when lines may come from other paths, or when the
+ * lines being compared are not those of the blobs.
+ */
+static struct blame_cache *open_blame_cache(struct blame_scoreboard *sb,
+					    int opt)
+{
+	struct rev_info *revs = sb->revs;
+	struct repository *r = sb->repo;
+	struct blame_cache *cache;
+	struct strbuf options = STRBUF_INIT;
+	int i;
+
+	if (!sb->use_cache || sb->reverse || opt ||
+	    oidset_size(&sb->ignore_list) || revs->max_age != -1)
+		return NULL;
+	for (i = 0; i < revs->cmdline.nr; i++)
+		if (revs->cmdline.rev[i].flags & UNINTERESTING)
+			return NULL;
+	if (read_replace_refs) {
+		prepare_replace_object(r);
+		if (hashmap_get_size(&r->objects->replace_map->map))
+			return NULL;
+	}
+	prepare_commit_graft(r);
+	if ((r->parsed_objects && r->parsed_objects->grafts_nr) ||
+	    is_repository_shallow(r))
+		return NULL;
+	if (revs->diffopt.flags.allow_textconv &&
+	    for_each_userdiff_driver(has_textconv, NULL))
+		return NULL;
+
+	strbuf_addf(&options, "xdl_opts=%d first_parent=%d no_follow=%d",
+		    sb->xdl_opts, revs->first_parent_only,
+		    sb->no_whole_file_rename);
+	CALLOC_ARRAY(cache, 1);
+	blame_cache_init(cache, r, options.buf);
+	strbuf_release(&options);
+	return cache;
+}
+
+static struct blame_origin *get_cached_origin(struct blame_scoreboard *sb,
+					      const struct blame_cache_origin *c)
+{
+	struct commit *commit = lookup_commit(sb->repo, &c->commit);
+	struct blame_origin *o;
+
+	if (!commit || repo_parse_commit_gently(sb->repo, commit, 1))
+		return NULL;
+	o = get_origin(commit, c->path);
+	if (is_null_oid(&o->blob_oid)) {
+		oidcpy(&o->blob_oid, &c->blob);
+		o->mode = c->mode;
+	}
+	return o;
+}
+
+static const struct blame_cache_entry *find_cached_entry(
+		const struct blame_cache_result *result, int lno)
+{
+	int lo = 0, hi = result->entry_nr;
+
+	while (lo + 1 < hi) {
+		int mi = lo + (hi - lo) / 2;
+		if (result->entry[mi].lno <= lno)
+			lo = mi;
+		else
+			hi = mi;
+	}
+	return &result->entry[lo];
+}
+
+/*
+ * If the cache knows who is to blame for the lines of "origin", hand
+ * its suspects over to them and return 1. Otherwise leave everything
+ * alone and return 0.
+ */
+static int blame_from_cache(struct blame_scoreboard *sb,
+			    struct blame_cache *cache,
+			    struct blame_origin *origin)
+{
+	struct blame_cache_result result = BLAME_CACHE_RESULT_INIT;
+	struct blame_origin **suspect = NULL;
+	struct blame_entry *e, *next;
+	int i, ret = 0;
+
+	if (is_null_oid(&origin->commit->object.oid) ||
+	    blame_cache_read(cache, &origin->commit->object.oid, origin->path,
+			     &result))
+		return 0;
+	if (!oideq(&result.blob, &origin->blob_oid))
+		goto out;
+	for (e = origin->suspects; e; e = e->next)
+		if (e->s_lno + e->num_lines > result.num_lines)
+			goto out;
+
+	/*
+	 * The commits named in the result may have been pruned since it
+	 * was recorded, in which case we have to dig for ourselves.
+	 */
+	CALLOC_ARRAY(suspect, result.suspect_nr);
+	for (i = 0; i < result.suspect_nr; i++) {
+		struct blame_cache_suspect *s = &result.suspect[i];
+
+		suspect[i] = get_cached_origin(sb, &s->origin);
+		if (!suspect[i])
+			goto out;
+		suspect[i]->cache_lines = s->num_lines;
+		if (s->previous.path && !suspect[i]->previous) {
+			suspect[i]->previous = get_cached_origin(sb, &s->previous);
+			if (!suspect[i]->previous)
+				goto out;
+		}
+	}
+
+	for (i = 0; i < result.suspect_nr; i++) {
+		struct commit *commit = suspect[i]->commit;
+
+		/* treat root commit as boundary */
+		if (!commit->parents && !sb->show_root)
+			commit->object.flags |= UNINTERESTING;
+	}
+
+	for (e = origin->suspects; e; e = next) {
+		int lno = e->lno, s_lno = e->s_lno;
+		int end = e->s_lno + e->num_lines;
+
+		next = e->next;
+		while (s_lno < end) {
+			const struct blame_cache_entry *c =
+				find_cached_entry(&result, s_lno);
+			struct blame_entry *ent;
+			int len = c->lno + c->num_lines - s_lno;
+
+			if (end - s_lno < len)
+				len = end - s_lno;
+			CALLOC_ARRAY(ent, 1);
+			ent->lno = lno;
+			ent->num_lines = len;
+			ent->s_lno = c->s_lno + s_lno - c->lno;
+			ent->suspect = blame_origin_incref(suspect[c->suspect]);
+			ent->suspect->guilty = 1;
+			if (sb->found_guilty_entry)
+				sb->found_guilty_entry(ent, sb->found_guilty_entry_data);
+			ent->next = sb->ent;
+			sb->ent = ent;
+			lno += len;
+			s_lno += len;
+		}
+		blame_origin_decref(e->suspect);
+		free(e);
+	}
+	origin->suspects = NULL;
+	ret = 1;
+
+out:
+	for (i = 0; suspect && i < result.suspect_nr; i++)
+		blame_origin_decref(suspect[i]);
+	free(suspect);
+	blame_cache_result_release(&result);
+	return ret;
+}
+
+static void set_cache_origin(struct blame_cache_origin *c,
+			     struct blame_origin *o)
+{
+	oidcpy(&c->commit, &o->commit->object.oid);
+	oidcpy(&c->blob, &o->blob_oid);
+	c->mode = o->mode;
+	c->path = xstrdup(o->path);
+}
+
+/*
+ * Count the lines of the blob of "o", unless a cached result already
+ * told us. Unlike the lines of the final blob, those are not known by
+ * the time the result is stored, as the blob may have been dropped.
+ */
+static int count_cache_lines(struct blame_origin *o)
+{
+	const char *p, *end;
+	unsigned long size;
+	enum object_type type;
+	char *buf = NULL;
+
+	if (o->cache_lines)
+		return o->cache_lines;
+	if (o->file.ptr) {
+		p = o->file.ptr;
+		size = o->file.size;
+	} else {
+		p = buf = read_object_file(&o->blob_oid, &type, &size);
+		if (!buf)
+			return -1;
+	}
+	for (end = p + size; p < end; p = get_next_line(p, end))
+		o->cache_lines++;
+	free(buf);
+	return o->cache_lines;
+}
+
+static int compare_cache_entry(const void *a_, const void *b_)
+{
+	const struct blame_cache_entry *a = a_, *b = b_;
+
+	return a->lno < b->lno ? -1 : a->lno > b->lno;
+}
+
+/*
+ * Record the final result, unless it only covers some of the lines.
+ */
+static void store_blame_cache(struct blame_scoreboard *sb,
+			      struct blame_cache *cache)
+{
+	struct blame_cache_result result = BLAME_CACHE_RESULT_INIT;
+	struct blame_origin *last = NULL;
+	struct blame_entry *e;
+	unsigned short mode;
+	int i, lno = 0;
+
+	if (is_null_oid(&sb->final->object.oid) ||
+	    get_tree_entry(sb->repo, get_commit_tree_oid(sb->final),
+			   sb->path, &result.blob, &mode))
+		return;
+	result.num_lines = sb->num_lines;
+
+	sb->ent = llist_mergesort(sb->ent, get_next_blame, set_next_blame,
+				  compare_blame_suspect);
+	for (e = sb->ent; e; e = e->next) {
+		struct blame_cache_entry *c;
+
+		if (e->suspect != last) {
+			struct blame_cache_suspect *s;
+
+			ALLOC_GROW(result.suspect, result.suspect_nr + 1,
+				   result.suspect_alloc);
+			s = &result.suspect[result.suspect_nr++];
+			memset(s, 0, sizeof(*s));
+			s->num_lines = count_cache_lines(e->suspect);
+			if (s->num_lines < 0)
+				goto out;
+			set_cache_origin(&s->origin, e->suspect);
+			if (e->suspect->previous)
+				set_cache_origin(&s->previous,
+						 e->suspect->previous);
+			last = e->suspect;
+		}
+		ALLOC_GROW(result.entry, result.entry_nr + 1,
+			   result.entry_alloc);
+		c = &result.entry[result.entry_nr++];
+		c->lno = e->lno;
+		c->num_lines = e->num_lines;
+		c->s_lno = e->s_lno;
+		c->suspect = result.suspect_nr - 1;
+	}
+
+	QSORT(result.entry, result.entry_nr, compare_cache_entry);
+	for (i = 0; i < result.entry_nr; i++) {
+		if (result.entry[i].lno != lno)
+			break;
+		lno += result.entry[i].num_lines;
+	}
+	if (i == result.entry_nr && lno == result.num_lines)
+		blame_cache_write(cache, &sb->final->object.oid, sb->path,
+				  &result);
+out:
+	blame_cache_result_release(&result);
+}
+
 /*
  * The main loop -- while we have blobs with lines whose true origin
  * is still unknown, pick one blob, and allow its lines to pass blames
@@ -2586,6 +3311,18 @@ void assign_blame(struct blame_scoreboard *sb, int opt)
 {
 	struct rev_info *revs = sb->revs;
 	struct commit *commit = prio_queue_get(&sb->commits);
+	struct blame_workers *workers = NULL;
+	struct blame_cache *cache = open_blame_cache(sb, opt);
+	int cache_hits = 0, final_cached = 0;
+
+	/*
+	 * Copy and move detection look at other paths of the same
+	 * commits, and so depend on the order in which their origins
+	 * are created; leave those alone.
+	 */
+	if (HAVE_THREADS && sb->num_threads > 1 && !sb->reverse &&
+	    !(opt & (PICKAXE_BLAME_MOVE | PICKAXE_BLAME_COPY)))
+		workers = start_workers(sb->num_threads);
 
 	while (commit) {
 		struct blame_entry *ent;
@@ -2608,11 +3345,18 @@ void assign_blame(struct blame_scoreboard *sb, int opt)
 		 */
 		blame_origin_incref(suspect);
 		parse_commit(commit);
-		if (sb->reverse ||
-		    (!(commit->object.flags & UNINTERESTING) &&
-		     !(revs->max_age != -1 && commit->date < revs->max_age)))
+		if (cache && blame_from_cache(sb, cache, suspect)) {
+			cache_hits++;
+			if (commit == sb->final)
+				final_cached = 1;
+		}
+		else if (sb->reverse ||
+			 (!(commit->object.flags & UNINTERESTING) &&
+			  !(revs->max_age != -1 && commit->date < revs->max_age))) {
+			if (workers)
+				prefetch_ahead(sb, workers, suspect);
 			pass_blame(sb, suspect, opt);
-		else {
+		} else {
 			commit->object.flags |= UNINTERESTING;
 			if (commit->object.parsed)
 				mark_parents_uninteresting(commit);
@@ -2644,6 +3388,16 @@ void assign_blame(struct blame_scoreboard *sb, int opt)
 		if (sb->debug) /* sanity */
 			sanity_check_refcnt(sb);
 	}
+
+	if (workers)
+		stop_workers(sb, workers);
+	if (cache) {
+		trace2_data_intmax("blame", sb->repo, "cache/hits", cache_hits);
+		if (!final_cached)
+			store_blame_cache(sb, cache);
+		blame_cache_clear(cache);
+		free(cache);
+	}
 }
 
 /*
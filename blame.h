@@ -17,6 +17,7 @@
 #define BLAME_DEFAULT_COPY_SCORE	40
 
 struct fingerprint;
+struct blame_prefetch;
 
 /*
  * One blob in a commit that is being suspected
@@ -55,12 +56,18 @@ struct blame_origin {
 	mmfile_t file;
 	int num_lines;
 	struct fingerprint *fingerprints;
+	/* the number of lines of the blob for the blame cache; 0 if unknown */
+	int cache_lines;
+	/* work for this origin started ahead of time, if any */
+	struct blame_prefetch *prefetch;
 	struct object_id blob_oid;
 	unsigned short mode;
 	/* guilty gets set when shipping any suspects to the final
 	 * blame list instead of other commits
 	 */
 	char guilty;
+	/* "file" was read ahead by a prefetch and not counted yet */
+	char file_prefetched;
 	char path[FLEX_ARRAY];
 };
 
@@ -153,6 +160,12 @@ struct blame_scoreboard {
 	int no_whole_file_rename;
 	int debug;
 
+	/* diff the next suspects in this many threads, if more than one */
+	int num_threads;
+
+	/* reuse and record results in the on-disk blame cache */
+	int use_cache;
+
 	/* callbacks */
 	void(*on_sanity_fail)(struct blame_scoreboard *, int);
 	void(*found_guilty_entry)(struct blame_entry *, void *);
@@ -11,6 +11,18 @@ define_commit_slab(bloom_filter_slab, struct bloom_filter);
 
 static struct bloom_filter_slab bloom_filters;
 
+/*
+ * The filters of a merge commit against its second and later parents.
+ */
+struct parent_bloom_filters {
+	int nr;
+	struct bloom_filter *filter;
+};
+
+define_commit_slab(parent_bloom_filter_slab, struct parent_bloom_filters);
+
+static struct parent_bloom_filter_slab parent_bloom_filters;
+
 struct pathmap_hash_entry {
     struct hashmap_entry entry;
     const char path[FLEX_ARRAY];
@@ -59,6 +71,54 @@ static int load_bloom_filter_from_graph(struct commit_graph *g,
 	return 1;
 }
 
+/*
+ * The BMIX and BMDA chunks hold, for each commit, a sequence of filters
+ * against its parents but the first, each preceded by its length as a
+ * 4-byte big-endian integer.
+ */
+static int load_parent_bloom_filters_from_graph(struct commit_graph *g,
+						struct bloom_filter *filters,
+						int nr, struct commit *c)
+{
+	uint32_t lex_pos, start_index, end_index;
+	uint32_t graph_pos = commit_graph_position(c);
+	const unsigned char *p, *end;
+	int i;
+
+	while (graph_pos < g->num_commits_in_base)
+		g = g->base_graph;
+
+	if (!g->chunk_bloom_merge_indexes)
+		return 0;
+
+	lex_pos = graph_pos - g->num_commits_in_base;
+
+	end_index = get_be32(g->chunk_bloom_merge_indexes + 4 * lex_pos);
+
+	if (lex_pos > 0)
+		start_index = get_be32(g->chunk_bloom_merge_indexes + 4 * (lex_pos - 1));
+	else
+		start_index = 0;
+	if (start_index > end_index ||
+	    end_index > g->chunk_bloom_merge_data_size)
+		return 0;
+
+	p = g->chunk_bloom_merge_data + start_index;
+	end = g->chunk_bloom_merge_data + end_index;
+	for (i = 0; i < nr && end - p >= 4; i++) {
+		size_t len = get_be32(p);
+
+		p += 4;
+		if (len > end - p)
+			break;
+		filters[i].len = len;
+		filters[i].data = (unsigned char *)p;
+		p += len;
+	}
+
+	return 1;
+}
+
 /*
  * Calculate the murmur3 32-bit hash value for the given data
  * using the given seed.
@@ -144,6 +204,41 @@ void clear_bloom_key(struct bloom_key *key)
 	FREE_AND_NULL(key->hashes);
 }
 
+struct bloom_keyvec *bloom_keyvec_new(const char *path, size_t len,
+				      const struct bloom_filter_settings *settings)
+{
+	struct bloom_keyvec *vec;
+	size_t i, count = 1;
+
+	for (i = 0; i < len; i++)
+		if (path[i] == '/')
+			count++;
+
+	vec = xcalloc(1, st_add(sizeof(*vec),
+				st_mult(sizeof(struct bloom_key), count)));
+	vec->count = count;
+
+	/* the full path first, as it is the most likely to be missing */
+	fill_bloom_key(path, len, &vec->key[0], settings);
+	count = 1;
+	for (i = len; i > 0; i--)
+		if (path[i - 1] == '/')
+			fill_bloom_key(path, i - 1, &vec->key[count++], settings);
+
+	return vec;
+}
+
+void bloom_keyvec_free(struct bloom_keyvec *vec)
+{
+	size_t i;
+
+	if (!vec)
+		return;
+	for (i = 0; i < vec->count; i++)
+		clear_bloom_key(&vec->key[i]);
+	free(vec);
+}
+
 void add_key_to_filter(const struct bloom_key *key,
 		       struct bloom_filter *filter,
 		       const struct bloom_filter_settings *settings)
@@ -162,6 +257,7 @@ void add_key_to_filter(const struct bloom_key *key,
 void init_bloom_filters(void)
 {
 	init_bloom_filter_slab(&bloom_filters);
+	init_parent_bloom_filter_slab(&parent_bloom_filters);
 }
 
 static int pathmap_cmp(const void *hashmap_cmp_fn_data,
@@ -184,34 +280,19 @@ static void init_truncated_large_filter(struct bloom_filter *filter)
 	filter->len = 1;
 }
 
-struct bloom_filter *get_or_compute_bloom_filter(struct repository *r,
-						 struct commit *c,
-						 int compute_if_not_present,
-						 const struct bloom_filter_settings *settings,
-						 enum bloom_filter_computed *computed)
+/*
+ * Fill "filter" with the paths that differ between the trees of "old_oid"
+ * (NULL for the empty tree) and "new_oid".
+ */
+static void compute_bloom_filter(struct repository *r,
+				 const struct object_id *old_oid,
+				 const struct object_id *new_oid,
+				 const struct bloom_filter_settings *settings,
+				 struct bloom_filter *filter,
+				 enum bloom_filter_computed *computed)
 {
-	struct bloom_filter *filter;
-	int i;
 	struct diff_options diffopt;
-
-	if (computed)
-		*computed = BLOOM_NOT_COMPUTED;
-
-	if (!bloom_filters.slab_size)
-		return NULL;
-
-	filter = bloom_filter_slab_at(&bloom_filters, c);
-
-	if (!filter->data) {
-		load_commit_graph_info(r, c);
-		if (commit_graph_position(c) != COMMIT_NOT_FROM_GRAPH)
-			load_bloom_filter_from_graph(r->objects->commit_graph, filter, c);
-	}
-
-	if (filter->data && filter->len)
-		return filter;
-	if (!compute_if_not_present)
-		return NULL;
+	int i;
 
 	repo_diff_setup(r, &diffopt);
 	diffopt.flags.recursive = 1;
@@ -219,13 +300,7 @@ struct bloom_filter *get_or_compute_bloom_filter(struct repository *r,
 	diffopt.max_changes = settings->max_changed_paths;
 	diff_setup_done(&diffopt);
 
-	/* ensure commit is parsed so we have parent information */
-	repo_parse_commit(r, c);
-
-	if (c->parents)
-		diff_tree_oid(&c->parents->item->object.oid, &c->object.oid, "", &diffopt);
-	else
-		diff_tree_oid(NULL, &c->object.oid, "", &diffopt);
+	diff_tree_oid(old_oid, new_oid, "", &diffopt);
 	diffcore_std(&diffopt);
 
 	if (diff_queued_diff.nr <= settings->max_changed_paths) {
@@ -302,7 +377,93 @@ struct bloom_filter *get_or_compute_bloom_filter(struct repository *r,
 
 	free(diff_queued_diff.queue);
 	DIFF_QUEUE_CLEAR(&diff_queued_diff);
+}
+
+struct bloom_filter *get_or_compute_bloom_filter(struct repository *r,
+						 struct commit *c,
+						 int compute_if_not_present,
+						 const struct bloom_filter_settings *settings,
+						 enum bloom_filter_computed *computed)
+{
+	struct bloom_filter *filter;
+
+	if (computed)
+		*computed = BLOOM_NOT_COMPUTED;
+
+	if (!bloom_filters.slab_size)
+		return NULL;
+
+	filter = bloom_filter_slab_at(&bloom_filters, c);
+
+	if (!filter->data) {
+		load_commit_graph_info(r, c);
+		if (commit_graph_position(c) != COMMIT_NOT_FROM_GRAPH)
+			load_bloom_filter_from_graph(r->objects->commit_graph, filter, c);
+	}
+
+	if (filter->data && filter->len)
+		return filter;
+	if (!compute_if_not_present)
+		return NULL;
+
+	/* ensure commit is parsed so we have parent information */
+	repo_parse_commit(r, c);
+
+	compute_bloom_filter(r, c->parents ? &c->parents->item->object.oid : NULL,
+			     &c->object.oid, settings, filter, computed);
+	return filter;
+}
+
+struct bloom_filter *get_or_compute_parent_bloom_filter(struct repository *r,
+							struct commit *c,
+							int nth_parent,
+							int compute_if_not_present,
+							const struct bloom_filter_settings *settings,
+							enum bloom_filter_computed *computed)
+{
+	struct parent_bloom_filters *filters;
+	struct bloom_filter *filter;
+	struct commit_list *parent;
+
+	if (!nth_parent)
+		return get_or_compute_bloom_filter(r, c, compute_if_not_present,
+						   settings, computed);
+
+	if (computed)
+		*computed = BLOOM_NOT_COMPUTED;
+
+	if (!parent_bloom_filters.slab_size)
+		return NULL;
+
+	filters = parent_bloom_filter_slab_at(&parent_bloom_filters, c);
 
+	if (!filters->filter) {
+		repo_parse_commit(r, c);
+		filters->nr = commit_list_count(c->parents) - 1;
+		if (filters->nr <= 0)
+			return NULL;
+		CALLOC_ARRAY(filters->filter, filters->nr);
+
+		load_commit_graph_info(r, c);
+		if (commit_graph_position(c) != COMMIT_NOT_FROM_GRAPH)
+			load_parent_bloom_filters_from_graph(r->objects->commit_graph,
+							     filters->filter,
+							     filters->nr, c);
+	}
+
+	if (nth_parent > filters->nr)
+		return NULL;
+	filter = &filters->filter[nth_parent - 1];
+
+	if (filter->data && filter->len)
+		return filter;
+	if (!compute_if_not_present)
+		return NULL;
+
+	for (parent = c->parents; nth_parent; nth_parent--)
+		parent = parent->next;
+	compute_bloom_filter(r, &parent->item->object.oid, &c->object.oid,
+			     settings, filter, computed);
 	return filter;
 }
 
@@ -325,3 +486,16 @@ int bloom_filter_contains(const struct bloom_filter *filter,
 
 	return 1;
 }
+
+int bloom_filter_contains_vec(const struct bloom_filter *filter,
+			      const struct bloom_keyvec *v,
+			      const struct bloom_filter_settings *settings)
+{
+	int ret = 1;
+	size_t i;
+
+	for (i = 0; ret > 0 && i < v->count; i++)
+		ret = bloom_filter_contains(filter, &v->key[i], settings);
+
+	return ret;
+}
@@ -68,6 +68,16 @@ struct bloom_key {
 	uint32_t *hashes;
 };
 
+/*
+ * A bloom_keyvec holds the keys for a path and each of its leading
+ * directories. A filter can only contain the path if it contains all
+ * of these keys.
+ */
+struct bloom_keyvec {
+	size_t count;
+	struct bloom_key key[FLEX_ARRAY];
+};
+
 /*
  * Calculate the murmur3 32-bit hash value for the given data
  * using the given seed.
@@ -83,6 +93,14 @@ void fill_bloom_key(const char *data,
 		    const struct bloom_filter_settings *settings);
 void clear_bloom_key(struct bloom_key *key);
 
+/*
+ * Create the keys for the first "len" bytes of "path", which must not
+ * have a trailing slash.
+ */
+struct bloom_keyvec *bloom_keyvec_new(const char *path, size_t len,
+				      const struct bloom_filter_settings *settings);
+void bloom_keyvec_free(struct bloom_keyvec *vec);
+
 void add_key_to_filter(const struct bloom_key *key,
 		       struct bloom_filter *filter,
 		       const struct bloom_filter_settings *settings);
@@ -105,8 +123,32 @@ struct bloom_filter *get_or_compute_bloom_filter(struct repository *r,
 #define get_bloom_filter(r, c) get_or_compute_bloom_filter( \
 	(r), (c), 0, NULL, NULL)
 
+/*
+ * Like get_or_compute_bloom_filter(), but for the paths that differ
+ * between "c" and its nth parent (counting from 0). Filters for parents
+ * other than the first are only stored in the commit-graph when it was
+ * written with commitGraph.mergeChangedPaths.
+ */
+struct bloom_filter *get_or_compute_parent_bloom_filter(struct repository *r,
+							struct commit *c,
+							int nth_parent,
+							int compute_if_not_present,
+							const struct bloom_filter_settings *settings,
+							enum bloom_filter_computed *computed);
+
+#define get_parent_bloom_filter(r, c, n) get_or_compute_parent_bloom_filter( \
+	(r), (c), (n), 0, NULL, NULL)
+
 int bloom_filter_contains(const struct bloom_filter *filter,
 			  const struct bloom_key *key,
 			  const struct bloom_filter_settings *settings);
 
+/*
+ * Returns 1 if the filter may contain all of the keys in "v", 0 if it
+ * definitely does not, and -1 if the filter is empty.
+ */
+int bloom_filter_contains_vec(const struct bloom_filter *filter,
+			      const struct bloom_keyvec *v,
+			      const struct bloom_filter_settings *settings);
+
 #endif
@@ -165,6 +165,7 @@ static int reject_implicit = 0;
 static int do_implicit_deserialize = 0;
 static int do_explicit_deserialize = 0;
 static char *deserialize_path = NULL;
+static int use_status_daemon = 0;
 
 static enum wt_status_deserialize_wait implicit_deserialize_wait = DESERIALIZE_WAIT__UNSET;
 static enum wt_status_deserialize_wait explicit_deserialize_wait = DESERIALIZE_WAIT__UNSET;
@@ -215,6 +216,7 @@ static int opt_parse_deserialize(const struct option *opt, const char *arg, int
 	if (unset) {
 		do_implicit_deserialize = 0;
 		do_explicit_deserialize = 0;
+		use_status_daemon = 0;
 	} else {
 		if (do_serialize)
 			die("cannot mix --serialize and --deserialize");
@@ -1568,6 +1570,10 @@ static int git_status_config(const char *k, const char *v, void *cb)
 		}
 		return 0;
 	}
+	if (!strcmp(k, "status.usedaemon")) {
+		use_status_daemon = git_config_bool(k, v);
+		return 0;
+	}
 	if (!strcmp(k, "status.deserializewait")) {
 		if (!v || !*v)
 			implicit_deserialize_wait = DESERIALIZE_WAIT__UNSET;
@@ -1721,7 +1727,8 @@ int cmd_status(int argc, const char **argv, const char *prefix)
 	 * duplicate some code here to hopefully reduce conflicts.
 	 */
 	try_deserialize = (!do_serialize &&
-			   (do_implicit_deserialize || do_explicit_deserialize));
+			   (do_implicit_deserialize || do_explicit_deserialize ||
+			    use_status_daemon));
 
 	/*
 	 * Disable deserialize when verbose is set because it causes us to
@@ -1795,7 +1802,10 @@ int cmd_status(int argc, const char **argv, const char *prefix)
 			s.prefix = prefix;
 
 		trace2_cmd_mode("deserialize");
-		result = wt_status_deserialize(&s, deserialize_path, dw);
+		if (use_status_daemon && !do_explicit_deserialize)
+			result = wt_status_deserialize_from_daemon(&s);
+		else
+			result = wt_status_deserialize(&s, deserialize_path, dw);
 		if (result == DESERIALIZE_OK)
 			return 0;
 		if (dw == DESERIALIZE_WAIT__FAIL)
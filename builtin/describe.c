@@ -3,6 +3,7 @@
 #include "config.h"
 #include "lockfile.h"
 #include "commit.h"
+#include "commit-graph.h"
 #include "tag.h"
 #include "blob.h"
 #include "refs.h"
@@ -299,6 +300,50 @@ static void append_suffix(int depth, const struct object_id *oid, struct strbuf
 	strbuf_addf(dst, "-%d-g%s", depth, find_unique_abbrev(oid, abbrev));
 }
 
+/*
+ * With --first-parent, the best candidate is the nearest name on the
+ * first-parent chain of "cmit", and its depth is how far down that chain
+ * it is. The commit-graph can tell both without walking the chain; this
+ * returns NULL if it cannot, or if there is no such name.
+ */
+static struct commit_name *find_first_parent_name(struct commit *cmit,
+						  uint32_t *depth)
+{
+	struct hashmap_iter iter;
+	struct commit_name *n, *best = NULL;
+	uint32_t distance;
+
+	if (commit_graph_first_parent_distance(the_repository, cmit, cmit,
+					       &distance) != 1)
+		return NULL;
+
+	hashmap_for_each_entry(&names, &iter, n, entry /* member name */) {
+		struct commit *c;
+
+		if (!tags && !all && n->prio < 2)
+			continue;
+		c = lookup_commit_reference_gently(the_repository,
+						   &n->peeled, 1);
+		/* a commit outside of the graph is no ancestor of one in it */
+		if (!c || commit_graph_position(c) == COMMIT_NOT_FROM_GRAPH)
+			continue;
+		switch (commit_graph_first_parent_distance(the_repository,
+							   cmit, c, &distance)) {
+		case 1:
+			if (!best || distance < *depth) {
+				best = n;
+				*depth = distance;
+			}
+			break;
+		case 0:
+			break;
+		default:
+			return NULL;
+		}
+	}
+	return best;
+}
+
 static void describe_commit(struct object_id *oid, struct strbuf *dst)
 {
 	struct commit *cmit, *gave_up_on = NULL;
@@ -345,6 +390,20 @@ static void describe_commit(struct object_id *oid, struct strbuf *dst)
 		have_util = 1;
 	}
 
+	if (first_parent && !debug) {
+		uint32_t depth;
+
+		n = find_first_parent_name(cmit, &depth);
+		if (n) {
+			append_name(n, dst);
+			if (n->misnamed || abbrev)
+				append_suffix(depth, &cmit->object.oid, dst);
+			if (suffix)
+				strbuf_addstr(dst, suffix);
+			return;
+		}
+	}
+
 	list = NULL;
 	cmit->object.flags = SEEN;
 	commit_list_insert(cmit, &list);
@@ -33,6 +33,7 @@
 #include "remote.h"
 #include "object-store.h"
 #include "exec-cmd.h"
+#include "blame-cache.h"
 
 #define FAILED_RUN "failed to run %s"
 
@@ -52,6 +53,7 @@ static timestamp_t gc_log_expire_time;
 static const char *gc_log_expire = "1.day.ago";
 static const char *prune_expire = "2.weeks.ago";
 static const char *prune_worktrees_expire = "3.months.ago";
+static const char *blame_cache_expire = "1.month.ago";
 static unsigned long big_pack_threshold;
 static unsigned long max_delta_cache_size = DEFAULT_DELTA_CACHE_SIZE;
 
@@ -155,6 +157,7 @@ static void gc_config(void)
 	git_config_get_bool("gc.autodetach", &detach_auto);
 	git_config_get_expiry("gc.pruneexpire", &prune_expire);
 	git_config_get_expiry("gc.worktreepruneexpire", &prune_worktrees_expire);
+	git_config_get_expiry("gc.blamecacheexpire", &blame_cache_expire);
 	git_config_get_expiry("gc.logexpiry", &gc_log_expire);
 
 	git_config_get_ulong("gc.bigpackthreshold", &big_pack_threshold);
@@ -544,7 +547,7 @@ int cmd_gc(int argc, const char **argv, const char *prefix)
 	pid_t pid;
 	int daemonized = 0;
 	int keep_largest_pack = -1;
-	timestamp_t dummy;
+	timestamp_t dummy, blame_cache_expire_time = 0;
 
 	struct option builtin_gc_options[] = {
 		OPT__QUIET(&quiet, N_("suppress progress reporting")),
@@ -586,6 +589,10 @@ int cmd_gc(int argc, const char **argv, const char *prefix)
 
 	if (prune_expire && parse_expiry_date(prune_expire, &dummy))
 		die(_("failed to parse prune expiry value %s"), prune_expire);
+	if (blame_cache_expire &&
+	    parse_expiry_date(blame_cache_expire, &blame_cache_expire_time))
+		die(_("failed to parse gc.blameCacheExpire value %s"),
+		    blame_cache_expire);
 
 	if (aggressive) {
 		strvec_push(&repack, "-f");
@@ -692,6 +699,9 @@ int cmd_gc(int argc, const char **argv, const char *prefix)
 	if (run_command_v_opt(rerere.v, RUN_GIT_CMD))
 		die(FAILED_RUN, rerere.v[0]);
 
+	if (blame_cache_expire)
+		blame_cache_prune(the_repository, blame_cache_expire_time);
+
 	report_garbage = report_pack_garbage;
 	reprepare_packed_git(the_repository);
 	if (pack_garbage.nr > 0) {
@@ -504,8 +504,6 @@ static int grep_cache(struct grep_opt *opt,
 	if (repo_read_index(repo) < 0)
 		die(_("index file corrupt"));
 
-	/* TODO: audit for interaction with sparse-index. */
-	ensure_full_index(repo->index);
 	for (nr = 0; nr < repo->index->cache_nr; nr++) {
 		const struct cache_entry *ce = repo->index->cache[nr];
 
@@ -515,7 +513,30 @@ static int grep_cache(struct grep_opt *opt,
 		strbuf_setlen(&name, name_base_len);
 		strbuf_addstr(&name, ce->name);
 
-		if (S_ISREG(ce->ce_mode) &&
+		if (S_ISSPARSEDIR(ce->ce_mode)) {
+			enum object_type type;
+			struct tree_desc tree;
+			void *data;
+			unsigned long size;
+
+			/*
+			 * Only --cached gets here, as sparse directories are
+			 * skip-worktree: look in the tree they point at,
+			 * if the pathspec can match anything in it.
+			 */
+			if (!submodule_path_match(repo->index, pathspec,
+						  name.buf, NULL))
+				continue;
+
+			data = read_object_file(&ce->oid, &type, &size);
+			if (!data)
+				die(_("unable to read tree (%s)"),
+				    oid_to_hex(&ce->oid));
+			init_tree_desc(&tree, data, size);
+			hit |= grep_tree(opt, pathspec, &tree, &name,
+					 name_base_len, 1);
+			free(data);
+		} else if (S_ISREG(ce->ce_mode) &&
 		    match_pathspec(repo->index, pathspec, name.buf, name.len, 0, NULL,
 				   S_ISDIR(ce->ce_mode) ||
 				   S_ISGITLINK(ce->ce_mode))) {
@@ -1168,6 +1189,8 @@ int cmd_grep(int argc, const char **argv, const char *prefix)
 		if (!cached)
 			setup_work_tree();
 
+		prepare_repo_settings(the_repository);
+		the_repository->settings.command_requires_full_index = 0;
 		hit = grep_cache(&opt, &pathspec, cached);
 	} else {
 		if (cached)
@@ -98,15 +98,24 @@ static int index_range_of_same_dir(const char *src, int length,
 	const char *src_w_slash = add_slash(src);
 	int first, last, len_w_slash = length + 1;
 
+redo:
 	first = cache_name_pos(src_w_slash, len_w_slash);
-	if (first >= 0)
+	if (first >= 0 && !S_ISSPARSEDIR(active_cache[first]->ce_mode))
 		die(_("%.*s is in index"), len_w_slash, src_w_slash);
 
-	first = -1 - first;
+	first = first >= 0 ? first : -1 - first;
 	for (last = first; last < active_nr; last++) {
 		const char *path = active_cache[last]->name;
 		if (strncmp(path, src_w_slash, len_w_slash))
 			break;
+		/*
+		 * The files hidden in a sparse directory move along with
+		 * the rest of the directory.
+		 */
+		if (S_ISSPARSEDIR(active_cache[last]->ce_mode)) {
+			ensure_full_index(&the_index);
+			goto redo;
+		}
 	}
 	if (src_w_slash != src)
 		free((char *)src_w_slash);
@@ -141,6 +150,9 @@ int cmd_mv(int argc, const char **argv, const char *prefix)
 	if (--argc < 1)
 		usage_with_options(builtin_mv_usage, builtin_mv_options);
 
+	prepare_repo_settings(the_repository);
+	the_repository->settings.command_requires_full_index = 0;
+
 	hold_locked_index(&lock_file, LOCK_DIE_ON_ERROR);
 	if (read_cache() < 0)
 		die(_("index file corrupt"));
@@ -3,6 +3,7 @@
 #include "repository.h"
 #include "config.h"
 #include "commit.h"
+#include "commit-graph.h"
 #include "tag.h"
 #include "refs.h"
 #include "parse-options.h"
@@ -27,6 +28,12 @@ struct rev_name {
 define_commit_slab(commit_rev_name, struct rev_name);
 
 static timestamp_t cutoff = TIME_MAX;
+/*
+ * Unlike the date cutoff, this one is exact: a commit with a lower
+ * generation number than all of those we are asked to name cannot
+ * lead to any of them.
+ */
+static timestamp_t generation_cutoff = GENERATION_NUMBER_ZERO;
 static struct commit_rev_name rev_names;
 
 /* How many generations are maximally preferred over _one_ merge traversal? */
@@ -142,7 +149,8 @@ static void name_rev(struct commit *start_commit,
 	struct rev_name *start_name;
 
 	parse_commit(start_commit);
-	if (start_commit->date < cutoff)
+	if (start_commit->date < cutoff ||
+	    commit_graph_generation(start_commit) < generation_cutoff)
 		return;
 
 	start_name = create_or_update_name(start_commit, taggerdate, 0, 0,
@@ -172,7 +180,8 @@ static void name_rev(struct commit *start_commit,
 			int generation, distance;
 
 			parse_commit(parent);
-			if (parent->date < cutoff)
+			if (parent->date < cutoff ||
+			    commit_graph_generation(parent) < generation_cutoff)
 				continue;
 
 			if (parent_number > 1) {
@@ -465,6 +474,7 @@ static char const * const name_rev_usage[] = {
 	N_("git name-rev [<options>] <commit>..."),
 	N_("git name-rev [<options>] --all"),
 	N_("git name-rev [<options>] --stdin"),
+	N_("git name-rev [<options>] --batch"),
 	NULL
 };
 
@@ -515,10 +525,56 @@ static void name_rev_line(char *p, struct name_ref_data *data)
 	strbuf_release(&buf);
 }
 
+static void add_rev(struct object_array *revs, const char *arg, int peel_tag)
+{
+	struct object_id oid;
+	struct object *object;
+	struct commit *commit;
+
+	if (get_oid(arg, &oid)) {
+		fprintf(stderr, "Could not get sha1 for %s. Skipping.\n",
+				arg);
+		return;
+	}
+
+	commit = NULL;
+	object = parse_object(the_repository, &oid);
+	if (object) {
+		struct object *peeled = deref_tag(the_repository,
+						  object, arg, 0);
+		if (peeled && peeled->type == OBJ_COMMIT)
+			commit = (struct commit *)peeled;
+	}
+
+	if (!object) {
+		fprintf(stderr, "Could not get object for %s. Skipping.\n",
+				arg);
+		return;
+	}
+
+	if (commit) {
+		if (cutoff > commit->date)
+			cutoff = commit->date;
+		if (generation_cutoff > commit_graph_generation(commit))
+			generation_cutoff = commit_graph_generation(commit);
+	}
+
+	if (peel_tag) {
+		if (!commit) {
+			fprintf(stderr, "Could not get commit for %s. Skipping.\n",
+					arg);
+			return;
+		}
+		object = (struct object *)commit;
+	}
+	add_object_array(object, arg, revs);
+}
+
 int cmd_name_rev(int argc, const char **argv, const char *prefix)
 {
 	struct object_array revs = OBJECT_ARRAY_INIT;
-	int all = 0, transform_stdin = 0, allow_undefined = 1, always = 0, peel_tag = 0;
+	int all = 0, transform_stdin = 0, batch = 0;
+	int allow_undefined = 1, always = 0, peel_tag = 0;
 	struct name_ref_data data = { 0, 0, STRING_LIST_INIT_NODUP, STRING_LIST_INIT_NODUP };
 	struct option opts[] = {
 		OPT_BOOL(0, "name-only", &data.name_only, N_("print only ref-based names (no object names)")),
@@ -530,6 +586,7 @@ int cmd_name_rev(int argc, const char **argv, const char *prefix)
 		OPT_GROUP(""),
 		OPT_BOOL(0, "all", &all, N_("list all commits reachable from all refs")),
 		OPT_BOOL(0, "stdin", &transform_stdin, N_("read from stdin")),
+		OPT_BOOL(0, "batch", &batch, N_("name the revisions read from stdin, one per line")),
 		OPT_BOOL(0, "undefined", &allow_undefined, N_("allow to print `undefined` names (default)")),
 		OPT_BOOL(0, "always",     &always,
 			   N_("show abbreviated commit object as fallback")),
@@ -545,53 +602,29 @@ int cmd_name_rev(int argc, const char **argv, const char *prefix)
 	init_commit_rev_name(&rev_names);
 	git_config(git_default_config, NULL);
 	argc = parse_options(argc, argv, prefix, opts, name_rev_usage, 0);
-	if (all + transform_stdin + !!argc > 1) {
+	if (all + transform_stdin + batch + !!argc > 1) {
 		error("Specify either a list, or --all, not both!");
 		usage_with_options(name_rev_usage, opts);
 	}
 	if (all || transform_stdin)
 		cutoff = 0;
+	else
+		generation_cutoff = GENERATION_NUMBER_INFINITY;
 
-	for (; argc; argc--, argv++) {
-		struct object_id oid;
-		struct object *object;
-		struct commit *commit;
-
-		if (get_oid(*argv, &oid)) {
-			fprintf(stderr, "Could not get sha1 for %s. Skipping.\n",
-					*argv);
-			continue;
-		}
-
-		commit = NULL;
-		object = parse_object(the_repository, &oid);
-		if (object) {
-			struct object *peeled = deref_tag(the_repository,
-							  object, *argv, 0);
-			if (peeled && peeled->type == OBJ_COMMIT)
-				commit = (struct commit *)peeled;
-		}
-
-		if (!object) {
-			fprintf(stderr, "Could not get object for %s. Skipping.\n",
-					*argv);
-			continue;
-		}
-
-		if (commit) {
-			if (cutoff > commit->date)
-				cutoff = commit->date;
-		}
+	for (; argc; argc--, argv++)
+		add_rev(&revs, *argv, peel_tag);
+	if (batch) {
+		struct strbuf line = STRBUF_INIT;
 
-		if (peel_tag) {
-			if (!commit) {
-				fprintf(stderr, "Could not get commit for %s. Skipping.\n",
-					*argv);
-				continue;
-			}
-			object = (struct object *)commit;
+		/*
+		 * Read all of them first, so that one walk, limited by
+		 * the oldest of them, names them all.
+		 */
+		while (strbuf_getline(&line, stdin) != EOF) {
+			if (line.len)
+				add_rev(&revs, line.buf, peel_tag);
 		}
-		add_object_array(object, *argv, &revs);
+		strbuf_release(&line);
 	}
 
 	if (cutoff) {
@@ -213,13 +213,18 @@ static int thin;
 static int num_preferred_base;
 static struct progress *progress_state;
 
-static struct packed_git *reuse_packfile;
+static struct reused_packfile *reuse_packfiles;
+static size_t reuse_packfiles_nr;
 static uint32_t reuse_packfile_objects;
 static struct bitmap *reuse_packfile_bitmap;
 
 static int use_bitmap_index_default = 1;
 static int use_bitmap_index = -1;
-static int allow_pack_reuse = 1;
+static enum {
+	NO_PACK_REUSE = 0,
+	SINGLE_PACK_REUSE,
+	MULTI_PACK_REUSE,
+} allow_pack_reuse = SINGLE_PACK_REUSE;
 static enum {
 	WRITE_BITMAP_FALSE = 0,
 	WRITE_BITMAP_QUIET,
@@ -1001,7 +1006,8 @@ static off_t find_reused_offset(off_t where)
 	return reused_chunks[lo-1].difference;
 }
 
-static void write_reused_pack_one(size_t pos, struct hashfile *out,
+static void write_reused_pack_one(struct packed_git *reuse_packfile,
+				  size_t pos, struct hashfile *out,
 				  struct pack_window **w_curs)
 {
 	off_t offset, next, cur;
@@ -1079,44 +1085,55 @@ static void write_reused_pack_one(size_t pos, struct hashfile *out,
 	copy_pack_data(out, reuse_packfile, w_curs, offset, next - offset);
 }
 
-static size_t write_reused_pack_verbatim(struct hashfile *out,
+static size_t write_reused_pack_verbatim(struct reused_packfile *reuse,
+					 struct hashfile *out,
 					 struct pack_window **w_curs)
 {
+	struct bitmap *objects = reuse->objects;
 	size_t pos = 0;
 
-	while (pos < reuse_packfile_bitmap->word_alloc &&
-			reuse_packfile_bitmap->words[pos] == (eword_t)~0)
+	while (pos < objects->word_alloc &&
+			objects->words[pos] == (eword_t)~0)
 		pos++;
 
 	if (pos) {
+		uint32_t nr = pos * BITS_IN_EWORD;
 		off_t to_write;
 
-		written = (pos * BITS_IN_EWORD);
-		to_write = pack_pos_to_offset(reuse_packfile, written)
+		to_write = pack_pos_to_offset(reuse->p, nr)
 			- sizeof(struct pack_header);
 
 		/* We're recording one chunk, not one object. */
-		record_reused_object(sizeof(struct pack_header), 0);
+		record_reused_object(sizeof(struct pack_header),
+				     sizeof(struct pack_header) - hashfile_total(out));
 		hashflush(out);
-		copy_pack_data(out, reuse_packfile, w_curs,
+		copy_pack_data(out, reuse->p, w_curs,
 			sizeof(struct pack_header), to_write);
 
+		written += nr;
 		display_progress(progress_state, written);
 	}
 	return pos;
 }
 
-static void write_reused_pack(struct hashfile *f)
+static void write_reused_pack(struct reused_packfile *reuse,
+			      struct hashfile *f)
 {
 	size_t i = 0;
 	uint32_t offset;
 	struct pack_window *w_curs = NULL;
 
+	/*
+	 * Offsets in the chunk list are relative to a single source pack;
+	 * deltas never cross packs, so start afresh for each one.
+	 */
+	reused_chunks_nr = 0;
+
 	if (allow_ofs_delta)
-		i = write_reused_pack_verbatim(f, &w_curs);
+		i = write_reused_pack_verbatim(reuse, f, &w_curs);
 
-	for (; i < reuse_packfile_bitmap->word_alloc; ++i) {
-		eword_t word = reuse_packfile_bitmap->words[i];
+	for (; i < reuse->objects->word_alloc; ++i) {
+		eword_t word = reuse->objects->words[i];
 		size_t pos = (i * BITS_IN_EWORD);
 
 		for (offset = 0; offset < BITS_IN_EWORD; ++offset) {
@@ -1124,7 +1141,7 @@ static void write_reused_pack(struct hashfile *f)
 				break;
 
 			offset += ewah_bit_ctz64(word >> offset);
-			write_reused_pack_one(pos + offset, f, &w_curs);
+			write_reused_pack_one(reuse->p, pos + offset, f, &w_curs);
 			display_progress(progress_state, ++written);
 		}
 	}
@@ -1132,6 +1149,14 @@ static void write_reused_pack(struct hashfile *f)
 	unuse_pack(&w_curs);
 }
 
+static void write_reused_packs(struct hashfile *f)
+{
+	size_t i;
+
+	for (i = 0; i < reuse_packfiles_nr; i++)
+		write_reused_pack(&reuse_packfiles[i], f);
+}
+
 static void write_excluded_by_configs(void)
 {
 	struct oidset_iter iter;
@@ -1180,9 +1205,9 @@ static void write_pack_file(void)
 
 		offset = write_pack_header(f, nr_remaining);
 
-		if (reuse_packfile) {
+		if (reuse_packfiles_nr) {
 			assert(pack_to_stdout);
-			write_reused_pack(f);
+			write_reused_packs(f);
 			offset = hashfile_total(f);
 		}
 
@@ -3117,7 +3142,19 @@ static int git_pack_config(const char *k, const char *v, void *cb)
 		return 0;
 	}
 	if (!strcmp(k, "pack.allowpackreuse")) {
-		allow_pack_reuse = git_config_bool(k, v);
+		int res = git_parse_maybe_bool(v);
+		if (res < 0) {
+			if (!strcasecmp(v, "single"))
+				allow_pack_reuse = SINGLE_PACK_REUSE;
+			else if (!strcasecmp(v, "multi"))
+				allow_pack_reuse = MULTI_PACK_REUSE;
+			else
+				die(_("invalid pack.allowPackReuse value: '%s'"), v);
+		} else if (res) {
+			allow_pack_reuse = SINGLE_PACK_REUSE;
+		} else {
+			allow_pack_reuse = NO_PACK_REUSE;
+		}
 		return 0;
 	}
 	if (!strcmp(k, "pack.threads")) {
@@ -3688,7 +3725,9 @@ static int get_object_list_from_bitmap(struct rev_info *revs)
 	if (pack_options_allow_reuse() &&
 	    !reuse_partial_packfile_from_bitmap(
 			bitmap_git,
-			&reuse_packfile,
+			allow_pack_reuse == MULTI_PACK_REUSE,
+			&reuse_packfiles,
+			&reuse_packfiles_nr,
 			&reuse_packfile_objects,
 			&reuse_packfile_bitmap)) {
 		assert(reuse_packfile_objects);
@@ -1,6 +1,7 @@
 #include "cache.h"
 #include "config.h"
 #include "commit.h"
+#include "commit-graph.h"
 #include "diff.h"
 #include "revision.h"
 #include "list-objects.h"
@@ -18,6 +19,7 @@
 #include "reflog-walk.h"
 #include "oidset.h"
 #include "packfile.h"
+#include "tag.h"
 
 static const char rev_list_usage[] =
 "git rev-list [OPTION] <commit-id>... [ -- paths... ]\n"
@@ -452,6 +454,153 @@ static int try_bitmap_count(struct rev_info *revs,
 	return 0;
 }
 
+/*
+ * "--count --first-parent A..B" counts the commits on the first-parent
+ * chain of B above A when A is on that chain, which the commit-graph
+ * can tell without walking them.
+ */
+static int try_first_parent_count(struct rev_info *revs)
+{
+	struct commit *tip = NULL, *bottom = NULL;
+	uint32_t distance;
+	int i;
+
+	if (!revs->count || !revs->first_parent_only)
+		return -1;
+
+	/* Anything that filters the commits needs to look at them. */
+	if (revs->left_right || revs->cherry_mark || revs->cherry_pick ||
+	    revs->tag_objects || revs->tree_objects || revs->blob_objects ||
+	    revs->prune || revs->max_age != -1 || revs->min_age != -1 ||
+	    revs->min_parents || revs->max_parents != -1 ||
+	    revs->skip_count > 0 || revs->ancestry_path || revs->boundary ||
+	    revs->grep_filter.pattern_list || revs->grep_filter.header_list ||
+	    revs->reflog_info || revs->no_walk || revs->include_check ||
+	    revs->unpacked || revs->no_kept_objects ||
+	    revs->exclude_promisor_objects || revs->simplify_by_decoration ||
+	    revs->line_level_traverse)
+		return -1;
+
+	for (i = 0; i < revs->pending.nr; i++) {
+		struct object *o = revs->pending.objects[i].item;
+		struct commit *c =
+			lookup_commit_reference_gently(revs->repo, &o->oid, 1);
+
+		if (!c)
+			return -1;
+		if (o->flags & UNINTERESTING) {
+			if (bottom)
+				return -1;
+			bottom = c;
+		} else {
+			if (tip)
+				return -1;
+			tip = c;
+		}
+	}
+	if (!tip || !bottom ||
+	    commit_graph_first_parent_distance(revs->repo, tip, bottom,
+					       &distance) != 1)
+		return -1;
+
+	if (revs->max_count >= 0 && (uint32_t)revs->max_count < distance)
+		distance = revs->max_count;
+	printf("%"PRIu32"\n", distance);
+	return 0;
+}
+
+static int show_graph_commit(const struct object_id *oid, timestamp_t date,
+			     unsigned int nr_parents, void *data)
+{
+	struct rev_list_info *info = data;
+	struct rev_info *revs = info->revs;
+
+	if (revs->max_age != -1 && date < revs->max_age)
+		return 1;
+	if (revs->min_age != -1 && date > revs->min_age)
+		return 0;
+	if (nr_parents < revs->min_parents ||
+	    (revs->max_parents >= 0 && nr_parents > revs->max_parents))
+		return 0;
+	if (revs->skip_count > 0) {
+		revs->skip_count--;
+		return 0;
+	}
+	if (!revs->max_count)
+		return -1;
+	if (revs->max_count > 0)
+		revs->max_count--;
+
+	if (info->flags & REV_LIST_QUIET)
+		return 0;
+	if (revs->count)
+		revs->count_right++;
+	else
+		printf("%s\n", oid_to_hex(oid));
+	return 0;
+}
+
+/*
+ * A plain listing (or count) of everything reachable from some tips
+ * does not need anything but the commit-graph: walk it without
+ * allocating a "struct commit" for each commit we go through.
+ */
+static int try_commit_graph_walk(struct rev_list_info *info)
+{
+	struct rev_info *revs = info->revs;
+	struct commit **tips;
+	size_t nr = 0;
+	int i, ret;
+
+	/* Anything but the object name needs to look at the commit. */
+	if (revs->commit_format != CMIT_FMT_UNSPECIFIED ||
+	    revs->verbose_header || info->show_timestamp ||
+	    revs->abbrev_commit || revs->print_parents ||
+	    revs->children.name || revs->show_decorations || revs->graph ||
+	    revs->left_right || revs->cherry_mark || revs->cherry_pick ||
+	    revs->sources || revs->track_linear || !revs->include_header ||
+	    show_disk_usage || progress || arg_print_omitted ||
+	    arg_missing_action || filter_options.choice)
+		return -1;
+
+	/* So does anything that limits or reorders the walk. */
+	if (revs->limited || revs->topo_order || revs->reverse ||
+	    revs->no_walk || revs->reflog_info || revs->prune ||
+	    revs->boundary || revs->unpacked || revs->no_kept_objects ||
+	    revs->tag_objects || revs->tree_objects || revs->blob_objects ||
+	    revs->ancestry_path || revs->simplify_merges ||
+	    revs->simplify_by_decoration || revs->line_level_traverse ||
+	    revs->grep_filter.pattern_list || revs->grep_filter.header_list ||
+	    revs->include_check || revs->exclude_promisor_objects)
+		return -1;
+
+	ALLOC_ARRAY(tips, revs->pending.nr);
+	for (i = 0; i < revs->pending.nr; i++) {
+		struct object *o = revs->pending.objects[i].item;
+
+		if (o->flags & UNINTERESTING)
+			break;
+		o = deref_tag(revs->repo, o, NULL, 0);
+		if (!o)
+			break;
+		if (o->type == OBJ_COMMIT)
+			tips[nr++] = (struct commit *)o;
+	}
+	if (i < revs->pending.nr)
+		ret = -1;
+	else
+		ret = commit_graph_walk(revs->repo, tips, nr,
+					revs->first_parent_only,
+					show_graph_commit, info);
+	free(tips);
+	if (ret)
+		return ret;
+
+	if (revs->count)
+		printf("%d\n", revs->count_right);
+	return 0;
+}
+
 static int try_bitmap_traversal(struct rev_info *revs,
 				struct list_objects_filter_options *filter,
 				int filter_provided_objects)
@@ -687,6 +836,9 @@ int cmd_rev_list(int argc, const char **argv, const char *prefix)
 	if (show_progress)
 		progress = start_delayed_progress(show_progress, 0);
 
+	if (!bisect_list && !try_first_parent_count(&revs))
+		return 0;
+
 	if (use_bitmap_index) {
 		if (!try_bitmap_count(&revs, &filter_options, filter_provided_objects))
 			return 0;
@@ -696,6 +848,9 @@ int cmd_rev_list(int argc, const char **argv, const char *prefix)
 			return 0;
 	}
 
+	if (!bisect_list && !try_commit_graph_walk(&info))
+		return 0;
+
 	if (prepare_revision_walk(&revs))
 		die("revision walk setup failed");
 	if (revs.tree_objects)
@@ -252,6 +252,21 @@ static struct option builtin_rm_options[] = {
 	OPT_END(),
 };
 
+/*
+ * Like matches_skip_worktree(), but expand a sparse index first, so that
+ * a pathspec inside a sparse directory is matched against the
+ * skip-worktree entries below it.
+ */
+static int matches_skip_worktree_expanded(const struct pathspec *pathspec,
+					  int item, char **seen_ptr)
+{
+	if (the_index.sparse_index) {
+		ensure_full_index(&the_index);
+		FREE_AND_NULL(*seen_ptr);
+	}
+	return matches_skip_worktree(pathspec, item, seen_ptr);
+}
+
 int cmd_rm(int argc, const char **argv, const char *prefix)
 {
 	struct lock_file lock_file = LOCK_INIT;
@@ -285,6 +300,8 @@ int cmd_rm(int argc, const char **argv, const char *prefix)
 	if (!index_only)
 		setup_work_tree();
 
+	prepare_repo_settings(the_repository);
+	the_repository->settings.command_requires_full_index = 0;
 	hold_locked_index(&lock_file, LOCK_DIE_ON_ERROR);
 
 	if (read_cache() < 0)
@@ -294,8 +311,13 @@ int cmd_rm(int argc, const char **argv, const char *prefix)
 
 	seen = xcalloc(pathspec.nr, 1);
 
-	/* TODO: audit for interaction with sparse-index. */
-	ensure_full_index(&the_index);
+	/*
+	 * Sparse directory entries are skip-worktree, so they are never
+	 * removed by the loop below; only the virtual filesystem, which
+	 * does look at skip-worktree entries, needs a full index.
+	 */
+	if (core_virtualfilesystem)
+		ensure_full_index(&the_index);
 	for (i = 0; i < active_nr; i++) {
 		const struct cache_entry *ce = active_cache[i];
 		if (!core_virtualfilesystem && ce_skip_worktree(ce))
@@ -322,7 +344,8 @@ int cmd_rm(int argc, const char **argv, const char *prefix)
 				seen_any = 1;
 			else if (ignore_unmatch)
 				continue;
-			else if (matches_skip_worktree(&pathspec, i, &skip_worktree_seen))
+			else if (matches_skip_worktree_expanded(&pathspec, i,
+								&skip_worktree_seen))
 				string_list_append(&only_match_skip_worktree, original);
 			else
 				die(_("pathspec '%s' did not match any files"), original);
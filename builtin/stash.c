@@ -1412,12 +1412,32 @@ static int do_push_stash(const struct pathspec *ps, const char *stash_msg, int q
 		int i;
 		char *ps_matched = xcalloc(ps->nr, 1);
 
-		/* TODO: audit for interaction with sparse-index. */
-		ensure_full_index(&the_index);
 		for (i = 0; i < active_nr; i++)
 			ce_path_match(&the_index, active_cache[i], ps,
 				      ps_matched);
 
+		/*
+		 * A pathspec may name a path hidden in a sparse directory;
+		 * expand the index to look for it only when something is
+		 * left unmatched and a sparse directory could hold it.
+		 */
+		if (the_index.sparse_index && memchr(ps_matched, 0, ps->nr)) {
+			for (i = 0; i < active_nr; i++) {
+				const struct cache_entry *ce = active_cache[i];
+
+				if (S_ISSPARSEDIR(ce->ce_mode) &&
+				    submodule_path_match(&the_index, ps,
+							 ce->name, NULL))
+					break;
+			}
+			if (i < active_nr) {
+				ensure_full_index(&the_index);
+				for (i = 0; i < active_nr; i++)
+					ce_path_match(&the_index, active_cache[i],
+						      ps, ps_matched);
+			}
+		}
+
 		if (report_path_error(ps_matched, ps)) {
 			fprintf_ln(stderr, _("Did you forget to 'git add'?"));
 			ret = -1;
@@ -1695,6 +1715,9 @@ int cmd_stash(int argc, const char **argv, const char *prefix)
 
 	git_config(git_stash_config, NULL);
 
+	prepare_repo_settings(the_repository);
+	the_repository->settings.command_requires_full_index = 0;
+
 	if (use_legacy_stash ||
 	    !git_env_bool("GIT_TEST_STASH_USE_BUILTIN", -1))
 		warning(_("the stash.useBuiltin support has been removed!\n"
@@ -0,0 +1,458 @@
+#include "builtin.h"
+#include "config.h"
+#include "parse-options.h"
+#include "fsmonitor.h"
+#include "run-command.h"
+#include "simple-ipc.h"
+#include "wt-status.h"
+
+static const char * const builtin_status__daemon_usage[] = {
+	N_("git status--daemon start [<options>]"),
+	N_("git status--daemon run [<options>]"),
+	N_("git status--daemon stop"),
+	N_("git status--daemon status"),
+	NULL
+};
+
+#ifdef SUPPORTS_SIMPLE_IPC
+static int status_daemon__ipc_threads = 4;
+static int status_daemon__start_timeout_sec = 60;
+
+static struct trace_key trace_status_daemon = TRACE_KEY_INIT(STATUS_DAEMON);
+
+/*
+ * The daemon keeps the serialized results of the last status scan,
+ * together with what is needed to tell whether they are still current:
+ * the request they were computed for (untracked and ignored modes and
+ * the client's HEAD), the mtime of the index, the state of the excludes
+ * files that are not in the worktree and the fsmonitor token taken just
+ * before the scan.
+ */
+struct status_daemon_state {
+	pthread_mutex_t mutex;
+
+	char *request;
+	struct strbuf blob;
+	struct strbuf excludes;
+	struct cache_time index_mtime;
+	struct strbuf token;
+	int have_token;
+};
+
+/*
+ * Acting as a CLIENT.
+ *
+ * Send a "quit" command to the `git-status--daemon` (if running)
+ * and wait for it to shutdown.
+ */
+static int do_as_client__send_stop(void)
+{
+	struct strbuf answer = STRBUF_INIT;
+	struct ipc_client_connect_options options
+		= IPC_CLIENT_CONNECT_OPTIONS_INIT;
+	int ret;
+
+	options.wait_if_busy = 1;
+	ret = ipc_client_send_command(wt_status_daemon_ipc_path(), &options,
+				      "quit", 4, &answer);
+
+	/* The quit command does not return any response data. */
+	strbuf_release(&answer);
+
+	if (ret)
+		return ret;
+
+	while (ipc_get_active_state(wt_status_daemon_ipc_path()) ==
+	       IPC_STATE__LISTENING)
+		sleep_millisec(50);
+
+	return 0;
+}
+
+static int do_as_client__status(void)
+{
+	switch (ipc_get_active_state(wt_status_daemon_ipc_path())) {
+	case IPC_STATE__LISTENING:
+		printf(_("status-daemon is serving '%s'\n"),
+		       the_repository->worktree);
+		return 0;
+
+	default:
+		printf(_("status-daemon is not serving '%s'\n"),
+		       the_repository->worktree);
+		return 1;
+	}
+}
+
+static void get_excludes_state(struct strbuf *sb)
+{
+	struct strbuf one = STRBUF_INIT;
+	char *path;
+
+	strbuf_reset(sb);
+
+	/* See my_parse_core_excludes() in wt-status-deserialize.c */
+	if (excludes_file) {
+		wt_serialize_compute_exclude_header(&one, "core_excludes",
+						    excludes_file);
+	} else {
+		path = xdg_config_home("ignore");
+		wt_serialize_compute_exclude_header(&one, "core_excludes",
+						    path);
+		free(path);
+	}
+	strbuf_addbuf(sb, &one);
+	strbuf_addch(sb, '\n');
+
+	path = git_pathdup("info/exclude");
+	wt_serialize_compute_exclude_header(&one, "repo_excludes", path);
+	free(path);
+	strbuf_addbuf(sb, &one);
+
+	strbuf_release(&one);
+}
+
+static void get_index_mtime(struct cache_time *mtime)
+{
+	struct stat st;
+
+	if (lstat(get_index_file(), &st)) {
+		mtime->sec = 0;
+		mtime->nsec = 0;
+		return;
+	}
+	mtime->sec = st.st_mtime;
+	mtime->nsec = ST_MTIME_NSEC(st);
+}
+
+/*
+ * Changes to files inside the repository's ".git" directory (such as
+ * the index we just wrote ourselves) are reported by some fsmonitors,
+ * but the index and HEAD are checked separately.
+ */
+static int has_worktree_changes(const struct strbuf *changes)
+{
+	const char *p = changes->buf;
+	const char *end = changes->buf + changes->len;
+
+	while (p < end) {
+		size_t len = strlen(p);
+
+		if (len && strcmp(p, ".git") && !starts_with(p, ".git/"))
+			return 1;
+		p += len + 1;
+	}
+	return 0;
+}
+
+/*
+ * Is the cached blob still an answer to `request`?  This also moves the
+ * fsmonitor token forward, so that the next query only has to report
+ * what changed since now.
+ */
+static int with_lock__cache_is_current(struct status_daemon_state *state,
+				       const char *request)
+{
+	struct strbuf token = STRBUF_INIT;
+	struct strbuf changes = STRBUF_INIT;
+	struct strbuf excludes = STRBUF_INIT;
+	struct cache_time mtime;
+	const char *reason = NULL;
+	int r;
+
+	if (!state->request || strcmp(state->request, request))
+		reason = "request";
+	else if (!state->have_token)
+		reason = "no-token";
+
+	if (!reason) {
+		get_index_mtime(&mtime);
+		if (mtime.sec != state->index_mtime.sec ||
+		    mtime.nsec != state->index_mtime.nsec)
+			reason = "index";
+	}
+
+	if (!reason) {
+		get_excludes_state(&excludes);
+		if (strcmp(excludes.buf, state->excludes.buf))
+			reason = "excludes";
+	}
+
+	if (!reason) {
+		r = fsmonitor_query_changes(the_repository, state->token.buf,
+					    &token, &changes);
+		if (r < 0) {
+			reason = "fsmonitor-failed";
+			state->have_token = 0;
+		} else {
+			strbuf_swap(&state->token, &token);
+			if (r > 0)
+				reason = "fsmonitor-trivial";
+			else if (has_worktree_changes(&changes))
+				reason = "worktree";
+		}
+	}
+
+	if (reason)
+		trace_printf_key(&trace_status_daemon, "stale: %s", reason);
+	trace2_data_string("status-daemon", the_repository, "cache",
+			   reason ? reason : "current");
+
+	strbuf_release(&token);
+	strbuf_release(&changes);
+	strbuf_release(&excludes);
+	return !reason;
+}
+
+static const char *untracked_arg(int mode)
+{
+	switch (mode) {
+	case SHOW_NO_UNTRACKED_FILES:
+		return "no";
+	case SHOW_NORMAL_UNTRACKED_FILES:
+		return "normal";
+	case SHOW_ALL_UNTRACKED_FILES:
+		return "all";
+	case SHOW_COMPLETE_UNTRACKED_FILES:
+		return "complete";
+	default:
+		return NULL;
+	}
+}
+
+static const char *ignored_arg(int mode)
+{
+	switch (mode) {
+	case SHOW_NO_IGNORED:
+		return "no";
+	case SHOW_TRADITIONAL_IGNORED:
+		return "traditional";
+	case SHOW_MATCHING_IGNORED:
+		return "matching";
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Run a full `git status --serialize` for `request` and keep its output.
+ *
+ * The fsmonitor token is taken before the scan, so that anything that
+ * changes while it runs is reported by the next query and makes us
+ * scan again rather than serve results that may have missed it.
+ */
+static void with_lock__recompute(struct status_daemon_state *state,
+				 const char *request)
+{
+	struct child_process cp = CHILD_PROCESS_INIT;
+	struct strbuf token = STRBUF_INIT;
+	struct strbuf changes = STRBUF_INIT;
+	const char *u, *i;
+	int untracked, ignored;
+
+	strbuf_reset(&state->blob);
+	FREE_AND_NULL(state->request);
+
+	if (sscanf(request, "%d %d", &untracked, &ignored) != 2 ||
+	    !(u = untracked_arg(untracked)) || !(i = ignored_arg(ignored))) {
+		trace_printf_key(&trace_status_daemon,
+				 "invalid request '%s'", request);
+		return;
+	}
+
+	if (!state->have_token) {
+		strbuf_reset(&state->token);
+		strbuf_addf(&state->token, "%"PRIu64"", getnanotime());
+	}
+	state->have_token = fsmonitor_query_changes(the_repository,
+						    state->token.buf,
+						    &token, &changes) >= 0;
+	strbuf_swap(&state->token, &token);
+	strbuf_release(&token);
+	strbuf_release(&changes);
+
+	get_excludes_state(&state->excludes);
+
+	trace2_region_enter("status-daemon", "scan", the_repository);
+
+	cp.git_cmd = 1;
+	strvec_pushl(&cp.args, "status", "--serialize", NULL);
+	strvec_pushf(&cp.args, "--untracked-files=%s", u);
+	strvec_pushf(&cp.args, "--ignored=%s", i);
+	if (capture_command(&cp, &state->blob, 0)) {
+		trace_printf_key(&trace_status_daemon, "status scan failed");
+		strbuf_reset(&state->blob);
+	}
+
+	trace2_region_leave("status-daemon", "scan", the_repository);
+
+	get_index_mtime(&state->index_mtime);
+	if (state->blob.len)
+		state->request = xstrdup(request);
+}
+
+static ipc_server_application_cb handle_client;
+
+static int handle_client(void *data,
+			 const char *command, size_t command_len,
+			 ipc_server_reply_cb *reply,
+			 struct ipc_server_reply_data *reply_data)
+{
+	struct status_daemon_state *state = data;
+	const char *request;
+
+	if (command_len != strlen(command))
+		BUG("status--daemon assumes text messages");
+
+	if (!strcmp(command, "quit"))
+		return SIMPLE_IPC_QUIT;
+
+	if (!skip_prefix(command, "status ", &request)) {
+		trace_printf_key(&trace_status_daemon,
+				 "unknown command '%s'", command);
+		return 0;
+	}
+
+	trace2_region_enter("status-daemon", "handle_client", the_repository);
+	pthread_mutex_lock(&state->mutex);
+
+	if (!with_lock__cache_is_current(state, request))
+		with_lock__recompute(state, request);
+
+	if (state->blob.len)
+		reply(reply_data, state->blob.buf, state->blob.len);
+
+	pthread_mutex_unlock(&state->mutex);
+	trace2_region_leave("status-daemon", "handle_client", the_repository);
+
+	return 0;
+}
+
+static int status_daemon_run(void)
+{
+	struct status_daemon_state state;
+	struct ipc_server_opts ipc_opts = {
+		.nr_threads = status_daemon__ipc_threads,
+		.uds_disallow_chdir = 0
+	};
+	int ret;
+
+	memset(&state, 0, sizeof(state));
+	pthread_mutex_init(&state.mutex, NULL);
+	strbuf_init(&state.blob, 0);
+	strbuf_init(&state.excludes, 0);
+	strbuf_init(&state.token, 0);
+
+	/*
+	 * Settle the fsmonitor settings while we are the only thread.
+	 */
+	fsm_settings__get_mode(the_repository);
+
+	ret = ipc_server_run(wt_status_daemon_ipc_path(), &ipc_opts,
+			     handle_client, &state);
+	if (ret == -2)
+		ret = error(_("status--daemon is already running '%s'"),
+			    the_repository->worktree);
+
+	pthread_mutex_destroy(&state.mutex);
+	free(state.request);
+	strbuf_release(&state.blob);
+	strbuf_release(&state.excludes);
+	strbuf_release(&state.token);
+	return ret;
+}
+
+/*
+ * Start `git status--daemon run` in the background and wait (with
+ * timeout) until it listens on the socket.  We do not wait for the
+ * child itself; it lives on after we exit.
+ */
+static int try_to_start_background_daemon(void)
+{
+	struct child_process cp = CHILD_PROCESS_INIT;
+	time_t time_limit;
+
+	if (ipc_get_active_state(wt_status_daemon_ipc_path()) ==
+	    IPC_STATE__LISTENING)
+		die(_("status--daemon is already running '%s'"),
+		    the_repository->worktree);
+
+	cp.git_cmd = 1;
+	cp.no_stdin = 1;
+	cp.no_stdout = 1;
+	cp.no_stderr = 1;
+	strvec_pushl(&cp.args, "status--daemon", "run", NULL);
+	strvec_pushf(&cp.args, "--ipc-threads=%d", status_daemon__ipc_threads);
+	if (start_command(&cp))
+		return error(_("could not spawn status--daemon in the background"));
+
+	time(&time_limit);
+	time_limit += status_daemon__start_timeout_sec;
+	while (ipc_get_active_state(wt_status_daemon_ipc_path()) !=
+	       IPC_STATE__LISTENING) {
+		if (time(NULL) > time_limit)
+			return error(_("status--daemon not online yet"));
+		sleep_millisec(50);
+	}
+	return 0;
+}
+
+int cmd_status__daemon(int argc, const char **argv, const char *prefix)
+{
+	const char *subcmd;
+
+	struct option options[] = {
+		OPT_INTEGER(0, "ipc-threads",
+			    &status_daemon__ipc_threads,
+			    N_("use <n> ipc worker threads")),
+		OPT_INTEGER(0, "start-timeout",
+			    &status_daemon__start_timeout_sec,
+			    N_("Max seconds to wait for background daemon startup")),
+		OPT_END()
+	};
+
+	if (argc < 2 || (argc == 2 && !strcmp(argv[1], "-h")))
+		usage_with_options(builtin_status__daemon_usage, options);
+
+	git_config(git_default_config, NULL);
+
+	subcmd = argv[1];
+	argv++;
+	argc--;
+
+	argc = parse_options(argc, argv, prefix, options,
+			     builtin_status__daemon_usage, 0);
+	if (status_daemon__ipc_threads < 1)
+		die(_("invalid 'ipc-threads' value (%d)"),
+		    status_daemon__ipc_threads);
+
+	prepare_repo_settings(the_repository);
+
+	if (!strcmp(subcmd, "start"))
+		return !!try_to_start_background_daemon();
+
+	if (!strcmp(subcmd, "run"))
+		return !!status_daemon_run();
+
+	if (!strcmp(subcmd, "stop"))
+		return !!do_as_client__send_stop();
+
+	if (!strcmp(subcmd, "status"))
+		return !!do_as_client__status();
+
+	die(_("Unhandled subcommand '%s'"), subcmd);
+}
+
+#else
+int cmd_status__daemon(int argc, const char **argv, const char *prefix)
+{
+	struct option options[] = {
+		OPT_END()
+	};
+
+	if (argc == 2 && !strcmp(argv[1], "-h"))
+		usage_with_options(builtin_status__daemon_usage, options);
+
+	die(_("status--daemon not supported on this platform"));
+}
+#endif
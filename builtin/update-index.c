@@ -746,14 +746,32 @@ static int do_reupdate(int ac, const char **av,
 		 */
 		has_head = 0;
  redo:
-	/* TODO: audit for interaction with sparse-index. */
-	ensure_full_index(&the_index);
 	for (pos = 0; pos < active_nr; pos++) {
 		const struct cache_entry *ce = active_cache[pos];
 		struct cache_entry *old = NULL;
 		int save_nr;
 		char *path;
 
+		if (S_ISSPARSEDIR(ce->ce_mode)) {
+			struct object_id oid;
+			unsigned short mode;
+
+			/*
+			 * Only look at the files of a sparse directory
+			 * that the pathspec reaches into and that differs
+			 * from HEAD; an unchanged one has nothing to update.
+			 */
+			if (!submodule_path_match(&the_index, &pathspec,
+						  ce->name, NULL))
+				continue;
+			if (has_head &&
+			    !get_tree_entry(the_repository, &head_oid, ce->name,
+					    &oid, &mode) &&
+			    S_ISDIR(mode) && oideq(&ce->oid, &oid))
+				continue;
+			ensure_full_index(&the_index);
+			goto redo;
+		}
 		if (ce_stage(ce) || !ce_path_match(&the_index, ce, &pathspec, NULL))
 			continue;
 		if (has_head)
@@ -1085,6 +1103,9 @@ int cmd_update_index(int argc, const char **argv, const char *prefix)
 	if (newfd < 0)
 		lock_error = errno;
 
+	prepare_repo_settings(r);
+	r->settings.command_requires_full_index = 0;
+
 	entries = read_cache();
 	if (entries < 0)
 		die("cache corrupted");
@@ -8,6 +8,8 @@
 #include "replace-object.h"
 #include "promisor-remote.h"
 #include "sparse-index.h"
+#include "config.h"
+#include "thread-utils.h"
 
 #ifndef DEBUG_CACHE_TREE
 #define DEBUG_CACHE_TREE 0
@@ -178,56 +180,114 @@ void cache_tree_invalidate_path(struct index_state *istate, const char *path)
 		istate->cache_changed |= CACHE_TREE_CHANGED;
 }
 
-static int verify_cache(struct index_state *istate, int flags)
+struct verify_cache_data {
+	struct cache_entry **cache;
+	int cache_nr;
+	int silent;
+	int funny;
+	int pass;
+};
+
+static void verify_entry(struct verify_cache_data *d, int i)
 {
-	unsigned i, funny;
-	int silent = flags & WRITE_TREE_SILENT;
+	const struct cache_entry *ce = d->cache[i];
 
-	/* Verify that the tree is merged */
-	funny = 0;
-	for (i = 0; i < istate->cache_nr; i++) {
-		const struct cache_entry *ce = istate->cache[i];
-		if (ce_stage(ce)) {
-			if (silent)
-				return -1;
-			if (10 < ++funny) {
+	if (d->funny > 10)
+		return;
+
+	if (!d->pass) {
+		/* Verify that the tree is merged */
+		if (!ce_stage(ce))
+			return;
+		if (d->silent || 10 < ++d->funny) {
+			d->funny = 11;
+			if (!d->silent)
 				fprintf(stderr, "...\n");
-				break;
-			}
-			fprintf(stderr, "%s: unmerged (%s)\n",
-				ce->name, oid_to_hex(&ce->oid));
+			return;
 		}
-	}
-	if (funny)
-		return -1;
-
-	/* Also verify that the cache does not have path and path/file
-	 * at the same time.  At this point we know the cache has only
-	 * stage 0 entries.
-	 */
-	funny = 0;
-	for (i = 0; i + 1 < istate->cache_nr; i++) {
-		/* path/file always comes after path because of the way
-		 * the cache is sorted.  Also path can appear only once,
-		 * which means conflicting one would immediately follow.
+		fprintf(stderr, "%s: unmerged (%s)\n",
+			ce->name, oid_to_hex(&ce->oid));
+	} else if (i + 1 < d->cache_nr) {
+		/*
+		 * Also verify that the cache does not have path and
+		 * path/file at the same time. path/file always comes
+		 * after path because of the way the cache is sorted.
+		 * Also path can appear only once, which means conflicting
+		 * one would immediately follow.
 		 */
-		const struct cache_entry *this_ce = istate->cache[i];
-		const struct cache_entry *next_ce = istate->cache[i + 1];
-		const char *this_name = this_ce->name;
-		const char *next_name = next_ce->name;
-		int this_len = ce_namelen(this_ce);
+		const struct cache_entry *next_ce = d->cache[i + 1];
+		int this_len = ce_namelen(ce);
+
 		if (this_len < ce_namelen(next_ce) &&
-		    next_name[this_len] == '/' &&
-		    strncmp(this_name, next_name, this_len) == 0) {
-			if (10 < ++funny) {
+		    next_ce->name[this_len] == '/' &&
+		    strncmp(ce->name, next_ce->name, this_len) == 0) {
+			if (10 < ++d->funny) {
 				fprintf(stderr, "...\n");
-				break;
+				return;
 			}
 			fprintf(stderr, "You have both %s and %s\n",
-				this_name, next_name);
+				ce->name, next_ce->name);
 		}
 	}
-	if (funny)
+}
+
+/*
+ * Check the entries from "pos" on that are below "base", skipping the
+ * directories that have a valid cache-tree: any change below them
+ * would have invalidated them, so they can hold neither unmerged
+ * entries nor path and path/file at the same time. Returns the number
+ * of entries below "base".
+ */
+static int verify_cache_range(struct verify_cache_data *d,
+			      struct cache_tree *it, int pos,
+			      const char *base, int baselen)
+{
+	int i = pos;
+
+	while (i < d->cache_nr && d->funny <= 10) {
+		const struct cache_entry *ce = d->cache[i];
+		struct cache_tree_sub *sub;
+		const char *path = ce->name, *slash;
+		int pathlen = ce_namelen(ce), sublen, nr;
+
+		if (pathlen <= baselen || memcmp(base, path, baselen))
+			break; /* at the end of this level */
+
+		slash = strchr(path + baselen, '/');
+		if (!slash || S_ISSPARSEDIR(ce->ce_mode)) {
+			verify_entry(d, i++);
+			continue;
+		}
+
+		sublen = slash - (path + baselen);
+		sub = it ? find_subtree(it, path + baselen, sublen, 0) : NULL;
+		if (sub && sub->cache_tree && sub->cache_tree->entry_count > 0 &&
+		    i + sub->cache_tree->entry_count <= d->cache_nr) {
+			i += sub->cache_tree->entry_count;
+			continue;
+		}
+		nr = verify_cache_range(d, sub ? sub->cache_tree : NULL, i,
+					path, baselen + sublen + 1);
+		i += nr ? nr : 1;
+	}
+	return i - pos;
+}
+
+static int verify_cache(struct index_state *istate, int flags)
+{
+	struct verify_cache_data d = {
+		.cache = istate->cache,
+		.cache_nr = istate->cache_nr,
+		.silent = flags & WRITE_TREE_SILENT,
+	};
+
+	verify_cache_range(&d, istate->cache_tree, 0, "", 0);
+	if (d.funny)
+		return -1;
+
+	d.pass = 1;
+	verify_cache_range(&d, istate->cache_tree, 0, "", 0);
+	if (d.funny)
 		return -1;
 	return 0;
 }
@@ -268,6 +328,12 @@ static int must_check_existence(const struct cache_entry *ce)
 	return !(has_promisor_remote() && ce_skip_worktree(ce));
 }
 
+/*
+ * Used within this file only: the objects that the entries and the valid
+ * cache-trees given to update_one() refer to have been looked up already.
+ */
+#define WRITE_TREE_EXISTENCE_CHECKED (1 << 8)
+
 int cache_tree_fully_valid(struct cache_tree *it)
 {
 	int result;
@@ -279,6 +345,19 @@ int cache_tree_fully_valid(struct cache_tree *it)
 	return result;
 }
 
+/*
+ * Write the tree object for "it" from "buffer". The tree is hashed
+ * without holding the object read lock, so that the subtrees can be
+ * hashed and written by several threads at once.
+ */
+static int write_tree_object(struct cache_tree *it, struct strbuf *buffer)
+{
+	hash_object_file(the_hash_algo, buffer->buf, buffer->len,
+			 tree_type, &it->oid);
+	return write_object_file_hashed(buffer->buf, buffer->len, tree_type,
+					&it->oid);
+}
+
 static int update_one(struct cache_tree *it,
 		      struct cache_entry **cache,
 		      int entries,
@@ -317,7 +396,8 @@ static int update_one(struct cache_tree *it,
 		}
 	}
 
-	if (0 <= it->entry_count && has_object_file(&it->oid))
+	if (0 <= it->entry_count &&
+	    ((flags & WRITE_TREE_EXISTENCE_CHECKED) || has_object_file(&it->oid)))
 		return it->entry_count;
 
 	/*
@@ -421,7 +501,8 @@ static int update_one(struct cache_tree *it,
 		}
 
 		ce_missing_ok = mode == S_IFGITLINK || missing_ok ||
-			!must_check_existence(ce);
+			!must_check_existence(ce) ||
+			((flags & WRITE_TREE_EXISTENCE_CHECKED) && !contains_ita);
 		if (is_null_oid(oid) ||
 		    (!ce_missing_ok && !has_object_file(oid))) {
 			strbuf_release(&buffer);
@@ -500,8 +581,7 @@ static int update_one(struct cache_tree *it,
 	} else if (dryrun) {
 		hash_object_file(the_hash_algo, buffer.buf, buffer.len,
 				 tree_type, &it->oid);
-	} else if (write_object_file(buffer.buf, buffer.len, tree_type,
-				     &it->oid)) {
+	} else if (write_tree_object(it, &buffer)) {
 		strbuf_release(&buffer);
 		return -1;
 	}
@@ -516,6 +596,278 @@ static int update_one(struct cache_tree *it,
 	return i;
 }
 
+/*
+ * The invalid subtrees are updated by threads when there are at least
+ * this many entries below them per thread, and handed out in pieces
+ * of at most a quarter of the entries per thread, so that a thread
+ * that got a large directory does not hold up the others.
+ */
+#define THREAD_COST (10000)
+#define MAX_PARALLEL (32)
+
+struct update_job {
+	struct cache_tree *it;
+	int pos, nr;
+	const char *base;
+	int baselen;
+};
+
+struct update_queue {
+	struct cache_entry **cache;
+	int flags;
+	pthread_mutex_t mutex;
+	int next, ret;
+	struct update_job *job;
+	int nr, alloc;
+};
+
+/*
+ * Return the end of the entries from "pos" on that are below "base".
+ */
+static int subtree_end(struct cache_entry **cache, int pos, int end,
+		       const char *base, int baselen)
+{
+	int lo = pos + 1, hi = end;
+
+	while (lo < hi) {
+		int mi = lo + (hi - lo) / 2;
+		const struct cache_entry *ce = cache[mi];
+
+		if (ce_namelen(ce) > baselen && !memcmp(ce->name, base, baselen))
+			lo = mi + 1;
+		else
+			hi = mi;
+	}
+	return lo;
+}
+
+/*
+ * A subtree that update_one() makes valid reports its entry_count to the
+ * update of its parent, but that does not count the CE_REMOVE entries it
+ * skipped over; leave the subtrees with such entries to the final
+ * update_one() from the top, which walks over them itself.
+ */
+static int has_removed_entries(struct cache_entry **cache, int pos, int end)
+{
+	for (; pos < end; pos++)
+		if (cache[pos]->ce_flags & CE_REMOVE)
+			return 1;
+	return 0;
+}
+
+/*
+ * Queue the invalid subtrees of "it" that can be updated on their own,
+ * going down into those with more than "max_job" entries unless nothing
+ * below them needs an update. The subtrees above the queued ones are left
+ * to the final update_one() from the top. Returns the number of entries
+ * in the queued subtrees.
+ */
+static int queue_invalid_subtrees(struct update_queue *q,
+				  struct cache_tree *it, int pos, int end,
+				  const char *base, int baselen, int max_job)
+{
+	int i = pos, nr = 0;
+
+	while (i < end) {
+		const struct cache_entry *ce = q->cache[i];
+		const char *path = ce->name, *slash;
+		struct cache_tree_sub *sub;
+		int sublen, subbaselen, subend, subnr;
+
+		slash = strchr(path + baselen, '/');
+		if (!slash) {
+			i++;
+			continue;
+		}
+		sublen = slash - (path + baselen);
+		subbaselen = baselen + sublen + 1;
+		subend = subtree_end(q->cache, i, end, path, subbaselen);
+
+		if (!S_ISSPARSEDIR(ce->ce_mode)) {
+			sub = find_subtree(it, path + baselen, sublen, 1);
+			if (!sub->cache_tree)
+				sub->cache_tree = cache_tree();
+			if (sub->cache_tree->entry_count >= 0)
+				; /* valid, update_one() takes it as it is */
+			else if (subend - i > max_job &&
+				 (subnr = queue_invalid_subtrees(q, sub->cache_tree,
+								 i, subend, path,
+								 subbaselen, max_job)))
+				nr += subnr;
+			else if (!has_removed_entries(q->cache, i, subend)) {
+				ALLOC_GROW(q->job, q->nr + 1, q->alloc);
+				q->job[q->nr].it = sub->cache_tree;
+				q->job[q->nr].pos = i;
+				q->job[q->nr].nr = subend - i;
+				q->job[q->nr].base = path;
+				q->job[q->nr].baselen = subbaselen;
+				q->nr++;
+				nr += subend - i;
+			}
+		}
+		i = subend;
+	}
+	return nr;
+}
+
+/*
+ * Look up the objects of the valid cache-trees below "it"; one whose
+ * object has gone missing is made invalid, so that update_one() writes
+ * it again instead of trusting it.
+ */
+static void check_valid_subtrees(struct cache_tree *it)
+{
+	int i;
+
+	for (i = 0; i < it->subtree_nr; i++) {
+		struct cache_tree *sub = it->down[i]->cache_tree;
+
+		if (!sub)
+			continue;
+		if (sub->entry_count >= 0) {
+			if (has_object_file(&sub->oid))
+				continue;
+			sub->entry_count = -1;
+		}
+		check_valid_subtrees(sub);
+	}
+}
+
+/*
+ * Look up the objects the entries of "job" refer to before the threads
+ * start, so that update_one() in the threads does not go through the
+ * object read lock for each of them. Returns -1 if one is missing; the
+ * job is then left to the final update_one() from the top to report.
+ * Missing entries are fine with WRITE_TREE_MISSING_OK, but the valid
+ * subtrees are still looked up, as update_one() would.
+ */
+static int check_job_objects(struct update_queue *q, struct update_job *job)
+{
+	int i;
+
+	if (!gvfs_config_is_set(GVFS_MISSING_OK) &&
+	    !(q->flags & WRITE_TREE_MISSING_OK)) {
+		for (i = job->pos; i < job->pos + job->nr; i++) {
+			const struct cache_entry *ce = q->cache[i];
+
+			if (S_ISGITLINK(ce->ce_mode) ||
+			    !must_check_existence(ce))
+				continue;
+			if (!has_object_file(&ce->oid))
+				return -1;
+		}
+	}
+	check_valid_subtrees(job->it);
+	return 0;
+}
+
+static void *update_thread(void *data)
+{
+	struct update_queue *q = data;
+
+	for (;;) {
+		struct update_job *job;
+		int skip;
+
+		pthread_mutex_lock(&q->mutex);
+		job = q->ret || q->next >= q->nr ? NULL : &q->job[q->next++];
+		pthread_mutex_unlock(&q->mutex);
+		if (!job)
+			break;
+
+		if (update_one(job->it, q->cache + job->pos, job->nr,
+			       job->base, job->baselen, &skip,
+			       q->flags | WRITE_TREE_EXISTENCE_CHECKED) < 0) {
+			pthread_mutex_lock(&q->mutex);
+			q->ret = -1;
+			pthread_mutex_unlock(&q->mutex);
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Update the invalid subtrees of the index in parallel; the trees of
+ * different directories do not depend on each other. Returns -1 if one
+ * of them could not be written, like update_one() would.
+ */
+static int update_subtrees_in_parallel(struct index_state *istate, int flags)
+{
+	struct update_queue q = { .cache = istate->cache, .flags = flags };
+	pthread_t threads[MAX_PARALLEL];
+	int nr_threads, cpus, dirty, had_lock, i, j;
+
+	if (!HAVE_THREADS || (flags & WRITE_TREE_DRY_RUN) ||
+	    istate->cache_tree->entry_count >= 0)
+		return 0;
+	if (git_config_get_index_threads(&nr_threads))
+		nr_threads = 0;
+
+	dirty = queue_invalid_subtrees(&q, istate->cache_tree, 0,
+				       istate->cache_nr, "", 0, INT_MAX);
+	if (!nr_threads) {
+		nr_threads = dirty / THREAD_COST;
+		cpus = online_cpus();
+		if (nr_threads > cpus)
+			nr_threads = cpus;
+	}
+	if (nr_threads > MAX_PARALLEL)
+		nr_threads = MAX_PARALLEL;
+
+	/* Cut the work into smaller pieces to spread it evenly */
+	q.nr = 0;
+	if (nr_threads > 1)
+		queue_invalid_subtrees(&q, istate->cache_tree, 0,
+				       istate->cache_nr, "", 0,
+				       dirty / (4 * nr_threads) + 1);
+
+	/* Load the settings update_one() and the threads look at lazily */
+	gvfs_config_is_set(GVFS_MISSING_OK);
+	has_promisor_remote();
+	get_shared_repository();
+
+	/* Leave the jobs with missing objects to the final update_one() */
+	for (i = j = dirty = 0; i < q.nr; i++) {
+		if (check_job_objects(&q, &q.job[i]))
+			continue;
+		dirty += q.job[i].nr;
+		q.job[j++] = q.job[i];
+	}
+	q.nr = j;
+	if (nr_threads > q.nr)
+		nr_threads = q.nr;
+	if (nr_threads < 2) {
+		free(q.job);
+		return 0;
+	}
+
+	trace2_region_enter("cache_tree", "update_subtrees", the_repository);
+	trace2_data_intmax("cache_tree", the_repository,
+			   "update_subtrees/threads", nr_threads);
+	trace2_data_intmax("cache_tree", the_repository,
+			   "update_subtrees/entries", dirty);
+
+	had_lock = obj_read_use_lock;
+	enable_obj_read_lock();
+	pthread_mutex_init(&q.mutex, NULL);
+	for (i = 0; i < nr_threads; i++) {
+		int err = pthread_create(&threads[i], NULL, update_thread, &q);
+		if (err)
+			die(_("unable to create cache-tree thread: %s"),
+			    strerror(err));
+	}
+	for (i = 0; i < nr_threads; i++)
+		if (pthread_join(threads[i], NULL))
+			die(_("unable to join cache-tree thread"));
+	pthread_mutex_destroy(&q.mutex);
+	if (!had_lock)
+		disable_obj_read_lock();
+
+	trace2_region_leave("cache_tree", "update_subtrees", the_repository);
+	free(q.job);
+	return q.ret;
+}
+
 int cache_tree_update(struct index_state *istate, int flags)
 {
 	int skip, i;
@@ -533,8 +885,10 @@ int cache_tree_update(struct index_state *istate, int flags)
 
 	trace_performance_enter();
 	trace2_region_enter("cache_tree", "update", the_repository);
-	i = update_one(istate->cache_tree, istate->cache, istate->cache_nr,
-		       "", 0, &skip, flags);
+	i = update_subtrees_in_parallel(istate, flags);
+	if (!i)
+		i = update_one(istate->cache_tree, istate->cache,
+			       istate->cache_nr, "", 0, &skip, flags);
 	trace2_region_leave("cache_tree", "update", the_repository);
 	trace_performance_leave("cache_tree_update");
 	if (i < 0)
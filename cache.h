@@ -366,6 +366,13 @@ void add_name_hash(struct index_state *istate, struct cache_entry *ce);
 void remove_name_hash(struct index_state *istate, struct cache_entry *ce);
 void free_name_hash(struct index_state *istate);
 
+/*
+ * Build the name hash of an index now instead of on first use. Once
+ * built, several threads may look up names in it at the same time, as
+ * long as nothing adds or removes names meanwhile.
+ */
+void prepare_name_hash(struct index_state *istate);
+
 void ensure_full_index(struct index_state *istate);
 
 /* Cache entry creation and cleanup */
@@ -435,6 +442,14 @@ typedef int (*must_prefetch_predicate)(const struct cache_entry *);
 void prefetch_cache_entries(const struct index_state *istate,
 			    must_prefetch_predicate must_prefetch);
 
+/*
+ * Like prefetch_cache_entries(), but only queue the missing entries with
+ * promisor_remote_prefetch() and return right away. The caller must call
+ * promisor_remote_prefetch_finish() when done.
+ */
+void prefetch_cache_entries_async(const struct index_state *istate,
+				  must_prefetch_predicate must_prefetch);
+
 #ifdef USE_THE_INDEX_COMPATIBILITY_MACROS
 extern struct index_state the_index;
 
@@ -1683,8 +1698,9 @@ struct cache_def {
 	int flags;
 	int track_flags;
 	int prefix_len_stat_func;
+	int nr_lstat; /* number of lstat() and stat() calls made */
 };
-#define CACHE_DEF_INIT { STRBUF_INIT, 0, 0, 0 }
+#define CACHE_DEF_INIT { STRBUF_INIT, 0, 0, 0, 0 }
 static inline void cache_def_clear(struct cache_def *cache)
 {
 	strbuf_release(&cache->path);
@@ -1694,6 +1710,7 @@ int has_symlink_leading_path(const char *name, int len);
 int threaded_has_symlink_leading_path(struct cache_def *, const char *, int);
 int check_leading_path(const char *name, int len, int warn_on_lstat_err);
 int has_dirs_only_path(const char *name, int len, int prefix_len);
+int threaded_has_dirs_only_path(struct cache_def *, const char *, int, int);
 void invalidate_lstat_cache(void);
 void schedule_dir_for_removal(const char *name, int len);
 void remove_scheduled_dirs(void);
@@ -20,6 +20,7 @@
 #include "json-writer.h"
 #include "trace2.h"
 #include "chunk-format.h"
+#include "ewah/ewok.h"
 
 void git_test_write_commit_graph_or_die(void)
 {
@@ -44,6 +45,9 @@ void git_test_write_commit_graph_or_die(void)
 #define GRAPH_CHUNKID_EXTRAEDGES 0x45444745 /* "EDGE" */
 #define GRAPH_CHUNKID_BLOOMINDEXES 0x42494458 /* "BIDX" */
 #define GRAPH_CHUNKID_BLOOMDATA 0x42444154 /* "BDAT" */
+#define GRAPH_CHUNKID_BLOOMMERGEINDEXES 0x424d4958 /* "BMIX" */
+#define GRAPH_CHUNKID_BLOOMMERGEDATA 0x424d4441 /* "BMDA" */
+#define GRAPH_CHUNKID_FIRSTPARENTJUMPS 0x46504a50 /* "FPJP" */
 #define GRAPH_CHUNKID_BASE 0x42415345 /* "BASE" */
 
 #define GRAPH_DATA_WIDTH (the_hash_algo->rawsz + 16)
@@ -69,6 +73,17 @@ void git_test_write_commit_graph_or_die(void)
 
 define_commit_slab(topo_level_slab, uint32_t);
 
+/*
+ * The first-parent jump of a commit that is being written: see
+ * first_parent_skip_height().
+ */
+struct first_parent_jump {
+	uint32_t height;
+	struct commit *jump;
+	unsigned computed:1;
+};
+define_commit_slab(first_parent_jump_slab, struct first_parent_jump);
+
 /* Keep track of the order in which commits are added to our list. */
 define_commit_slab(commit_pos, int);
 static struct commit_pos commit_pos = COMMIT_SLAB_INIT(1, commit_pos);
@@ -333,6 +348,28 @@ static int graph_read_bloom_data(const unsigned char *chunk_start,
 	return 0;
 }
 
+static int graph_read_bloom_merge_indexes(const unsigned char *chunk_start,
+					  size_t chunk_size, void *data)
+{
+	struct commit_graph *g = data;
+
+	if (chunk_size != st_mult(g->num_commits, 4)) {
+		warning(_("commit-graph merge filter index chunk is the wrong size"));
+		return 0;
+	}
+	g->chunk_bloom_merge_indexes = chunk_start;
+	return 0;
+}
+
+static int graph_read_bloom_merge_data(const unsigned char *chunk_start,
+				       size_t chunk_size, void *data)
+{
+	struct commit_graph *g = data;
+	g->chunk_bloom_merge_data = chunk_start;
+	g->chunk_bloom_merge_data_size = chunk_size;
+	return 0;
+}
+
 struct commit_graph *parse_commit_graph(struct repository *r,
 					void *graph_map, size_t graph_size)
 {
@@ -401,6 +438,8 @@ struct commit_graph *parse_commit_graph(struct repository *r,
 	pair_chunk(cf, GRAPH_CHUNKID_DATA, &graph->chunk_commit_data);
 	pair_chunk(cf, GRAPH_CHUNKID_EXTRAEDGES, &graph->chunk_extra_edges);
 	pair_chunk(cf, GRAPH_CHUNKID_BASE, &graph->chunk_base_graphs);
+	pair_chunk(cf, GRAPH_CHUNKID_FIRSTPARENTJUMPS,
+		   &graph->chunk_first_parent_jumps);
 
 	if (get_configured_generation_version(r) >= 2) {
 		pair_chunk(cf, GRAPH_CHUNKID_GENERATION_DATA,
@@ -414,6 +453,10 @@ struct commit_graph *parse_commit_graph(struct repository *r,
 			   &graph->chunk_bloom_indexes);
 		read_chunk(cf, GRAPH_CHUNKID_BLOOMDATA,
 			   graph_read_bloom_data, graph);
+		read_chunk(cf, GRAPH_CHUNKID_BLOOMMERGEINDEXES,
+			   graph_read_bloom_merge_indexes, graph);
+		read_chunk(cf, GRAPH_CHUNKID_BLOOMMERGEDATA,
+			   graph_read_bloom_merge_data, graph);
 	}
 
 	if (graph->chunk_bloom_indexes && graph->chunk_bloom_data) {
@@ -425,6 +468,14 @@ struct commit_graph *parse_commit_graph(struct repository *r,
 		FREE_AND_NULL(graph->bloom_filter_settings);
 	}
 
+	/* The filters for merges use the settings of the ones above. */
+	if (!graph->chunk_bloom_data || !graph->chunk_bloom_merge_indexes ||
+	    !graph->chunk_bloom_merge_data) {
+		graph->chunk_bloom_merge_indexes = NULL;
+		graph->chunk_bloom_merge_data = NULL;
+		graph->chunk_bloom_merge_data_size = 0;
+	}
+
 	oidread(&graph->oid, graph->data + graph->data_len - graph->hash_len);
 
 	if (verify_commit_graph_lite(graph))
@@ -962,6 +1013,304 @@ struct tree *get_commit_tree_in_graph(struct repository *r, const struct commit
 	return get_commit_tree_in_graph_one(r, r->objects->commit_graph, c);
 }
 
+/*
+ * The "height" of a commit is the number of commits on its first-parent
+ * chain, not counting itself, so that a root commit has height 0.
+ *
+ * Besides its first parent, each commit records a jump to the ancestor
+ * on that chain at the height given below. The jumps are arranged in a
+ * skew-binary fashion, so that the ancestor at any height can be reached
+ * in O(log n) steps by taking each jump that does not overshoot, and
+ * the first parent otherwise.
+ */
+static uint32_t invert_lowest_one(uint32_t n)
+{
+	return n & (n - 1);
+}
+
+static uint32_t first_parent_skip_height(uint32_t height)
+{
+	if (height < 2)
+		return 0;
+	if (height & 1)
+		return invert_lowest_one(invert_lowest_one(height - 1)) + 1;
+	return invert_lowest_one(height);
+}
+
+/*
+ * Whether to take the jump from "height" when looking for the ancestor
+ * at "target"; it is only skipped if the jump from the first parent
+ * gets closer to it.
+ */
+static int take_first_parent_jump(uint32_t height, uint32_t target)
+{
+	uint32_t skip = first_parent_skip_height(height);
+	uint32_t skip_prev = first_parent_skip_height(height - 1);
+
+	return skip == target ||
+	       (skip > target && !(skip_prev + 2 < skip && skip_prev >= target));
+}
+
+static int read_first_parent_jump(struct commit_graph *g, uint32_t pos,
+				  uint32_t *height, uint32_t *jump,
+				  uint32_t *parent)
+{
+	const unsigned char *data;
+	uint32_t lex_index;
+
+	while (g && pos < g->num_commits_in_base)
+		g = g->base_graph;
+	if (!g || pos >= g->num_commits + g->num_commits_in_base ||
+	    !g->chunk_first_parent_jumps)
+		return -1;
+
+	lex_index = pos - g->num_commits_in_base;
+	data = g->chunk_first_parent_jumps + 8 * (size_t)lex_index;
+	*height = get_be32(data);
+	*jump = get_be32(data + 4);
+	*parent = get_be32(g->chunk_commit_data +
+			   GRAPH_DATA_WIDTH * lex_index + g->hash_len);
+	return 0;
+}
+
+int commit_graph_first_parent_distance(struct repository *r,
+				       struct commit *c,
+				       struct commit *ancestor,
+				       uint32_t *distance)
+{
+	struct commit_graph *g;
+	uint32_t pos, target_pos, height, target, jump, parent;
+	uint32_t dummy_jump, dummy_parent;
+
+	if (!prepare_commit_graph(r))
+		return -1;
+	g = r->objects->commit_graph;
+
+	if (!find_commit_in_graph(c, g, &pos) ||
+	    !find_commit_in_graph(ancestor, g, &target_pos) ||
+	    read_first_parent_jump(g, pos, &height, &jump, &parent) ||
+	    read_first_parent_jump(g, target_pos, &target,
+				   &dummy_jump, &dummy_parent))
+		return -1;
+
+	if (target > height)
+		return 0;
+	*distance = height - target;
+
+	while (height > target) {
+		uint32_t expect;
+
+		if (jump != GRAPH_PARENT_NONE &&
+		    take_first_parent_jump(height, target)) {
+			pos = jump;
+			expect = first_parent_skip_height(height);
+		} else {
+			pos = parent;
+			expect = height - 1;
+		}
+		if (pos == GRAPH_PARENT_NONE ||
+		    read_first_parent_jump(g, pos, &height, &jump, &parent))
+			return -1;
+		if (height != expect)
+			return error(_("commit-graph has inconsistent first-parent jumps"));
+	}
+
+	return pos == target_pos;
+}
+
+/*
+ * The queue of a commit_graph_walk(), ordered like the list of commits
+ * in a plain revision walk: the most recent commit date first, and
+ * among commits with the same date, the one queued first.
+ */
+struct graph_walk_entry {
+	timestamp_t date;
+	uint32_t ctr;
+	uint32_t pos;
+};
+
+struct graph_walk_queue {
+	struct graph_walk_entry *array;
+	size_t nr, alloc;
+	uint32_t ctr;
+};
+
+static int graph_walk_entry_before(const struct graph_walk_entry *a,
+				   const struct graph_walk_entry *b)
+{
+	if (a->date != b->date)
+		return a->date > b->date;
+	return a->ctr < b->ctr;
+}
+
+static void graph_walk_queue_put(struct graph_walk_queue *queue,
+				 uint32_t pos, timestamp_t date)
+{
+	struct graph_walk_entry *array;
+	size_t ix, parent;
+
+	ALLOC_GROW(queue->array, queue->nr + 1, queue->alloc);
+	array = queue->array;
+	ix = queue->nr++;
+	array[ix].date = date;
+	array[ix].ctr = queue->ctr++;
+	array[ix].pos = pos;
+
+	for (; ix; ix = parent) {
+		parent = (ix - 1) / 2;
+		if (!graph_walk_entry_before(&array[ix], &array[parent]))
+			break;
+		SWAP(array[ix], array[parent]);
+	}
+}
+
+static struct graph_walk_entry graph_walk_queue_get(struct graph_walk_queue *queue)
+{
+	struct graph_walk_entry *array = queue->array;
+	struct graph_walk_entry top = array[0];
+	size_t ix, child;
+
+	array[0] = array[--queue->nr];
+	for (ix = 0; ix * 2 + 1 < queue->nr; ix = child) {
+		child = ix * 2 + 1;
+		if (child + 1 < queue->nr &&
+		    graph_walk_entry_before(&array[child + 1], &array[child]))
+			child++;
+		if (!graph_walk_entry_before(&array[child], &array[ix]))
+			break;
+		SWAP(array[ix], array[child]);
+	}
+	return top;
+}
+
+static const unsigned char *graph_commit_data(struct commit_graph *g,
+					      uint32_t pos,
+					      struct commit_graph **layer)
+{
+	while (g && pos < g->num_commits_in_base)
+		g = g->base_graph;
+	if (!g || pos >= g->num_commits + g->num_commits_in_base)
+		die(_("invalid commit position. commit-graph is likely corrupt"));
+	*layer = g;
+	return g->chunk_commit_data +
+		GRAPH_DATA_WIDTH * (size_t)(pos - g->num_commits_in_base);
+}
+
+static timestamp_t graph_commit_date(struct commit_graph *g, uint32_t pos)
+{
+	struct commit_graph *layer;
+	const unsigned char *data = graph_commit_data(g, pos, &layer);
+	uint64_t date_high = get_be32(data + layer->hash_len + 8) & 0x3;
+	uint64_t date_low = get_be32(data + layer->hash_len + 12);
+
+	return (timestamp_t)((date_high << 32) | date_low);
+}
+
+static void graph_walk_queue_parent(struct graph_walk_queue *queue,
+				    struct bitmap *seen,
+				    struct commit_graph *g, uint32_t pos)
+{
+	if (pos >= g->num_commits + g->num_commits_in_base)
+		die("invalid parent position %"PRIu32, pos);
+	if (bitmap_get(seen, pos))
+		return;
+	bitmap_set(seen, pos);
+	graph_walk_queue_put(queue, pos, graph_commit_date(g, pos));
+}
+
+int commit_graph_walk(struct repository *r,
+		      struct commit **tips, size_t nr,
+		      int first_parent_only,
+		      commit_graph_walk_fn fn, void *data)
+{
+	struct commit_graph *g;
+	struct graph_walk_queue queue = { 0 };
+	struct bitmap *seen;
+	uint32_t *tip_pos;
+	size_t i;
+	intmax_t visited = 0;
+
+	if (!prepare_commit_graph(r))
+		return -1;
+	g = r->objects->commit_graph;
+
+	ALLOC_ARRAY(tip_pos, nr);
+	for (i = 0; i < nr; i++) {
+		if (!find_commit_in_graph(tips[i], g, &tip_pos[i])) {
+			free(tip_pos);
+			return -1;
+		}
+	}
+
+	seen = bitmap_word_alloc(DIV_ROUND_UP(g->num_commits +
+					      g->num_commits_in_base,
+					      BITS_IN_EWORD));
+	for (i = 0; i < nr; i++)
+		graph_walk_queue_parent(&queue, seen, g, tip_pos[i]);
+	free(tip_pos);
+
+	while (queue.nr) {
+		struct graph_walk_entry e = graph_walk_queue_get(&queue);
+		struct commit_graph *layer;
+		const unsigned char *commit_data =
+			graph_commit_data(g, e.pos, &layer);
+		const unsigned char *edges = NULL;
+		uint32_t parent1, parent2;
+		unsigned int nr_parents;
+		struct object_id oid;
+		int ret;
+
+		parent1 = get_be32(commit_data + layer->hash_len);
+		parent2 = get_be32(commit_data + layer->hash_len + 4);
+		if (parent1 == GRAPH_PARENT_NONE)
+			nr_parents = 0;
+		else if (parent2 == GRAPH_PARENT_NONE)
+			nr_parents = 1;
+		else if (!(parent2 & GRAPH_EXTRA_EDGES_NEEDED))
+			nr_parents = 2;
+		else {
+			const unsigned char *p;
+
+			edges = layer->chunk_extra_edges +
+				4 * (uint64_t)(parent2 & GRAPH_EDGE_LAST_MASK);
+			nr_parents = 1;
+			for (p = edges; ; p += 4) {
+				nr_parents++;
+				if (get_be32(p) & GRAPH_LAST_EDGE)
+					break;
+			}
+		}
+
+		visited++;
+		load_oid_from_graph(layer, e.pos, &oid);
+		ret = fn(&oid, e.date, nr_parents, data);
+		if (ret < 0)
+			break;
+		if (ret > 0 || !nr_parents)
+			continue;
+
+		graph_walk_queue_parent(&queue, seen, g, parent1);
+		if (first_parent_only || nr_parents == 1)
+			continue;
+		if (!edges) {
+			graph_walk_queue_parent(&queue, seen, g, parent2);
+			continue;
+		}
+		for (;; edges += 4) {
+			uint32_t edge = get_be32(edges);
+			graph_walk_queue_parent(&queue, seen, g,
+						edge & GRAPH_EDGE_LAST_MASK);
+			if (edge & GRAPH_LAST_EDGE)
+				break;
+		}
+	}
+
+	trace2_data_intmax("commit-graph", r, "walk-visited", visited);
+	bitmap_free(seen);
+	free(queue.array);
+	return 0;
+}
+
 struct packed_commit_list {
 	struct commit **list;
 	size_t nr;
@@ -994,19 +1343,24 @@ struct write_commit_graph_context {
 		 report_progress:1,
 		 split:1,
 		 changed_paths:1,
+		 merge_changed_paths:1,
+		 first_parent_jumps:1,
 		 order_by_pack:1,
 		 write_generation_data:1,
 		 trust_generation_numbers:1;
 
 	struct topo_level_slab *topo_levels;
+	struct first_parent_jump_slab first_parent_jumps_slab;
 	const struct commit_graph_opts *opts;
 	size_t total_bloom_filter_data_size;
+	size_t total_bloom_merge_data_size;
 	const struct bloom_filter_settings *bloom_settings;
 
 	int count_bloom_filter_computed;
 	int count_bloom_filter_not_computed;
 	int count_bloom_filter_trunc_empty;
 	int count_bloom_filter_trunc_large;
+	int count_bloom_merge_filter_computed;
 };
 
 static int write_graph_chunk_fanout(struct hashfile *f,
@@ -1319,6 +1673,108 @@ static int write_graph_chunk_bloom_data(struct hashfile *f,
 	return 0;
 }
 
+/*
+ * The number of bytes the filters of "c" against its parents other than
+ * the first take up in the BMDA chunk.
+ */
+static size_t merge_bloom_data_size(struct write_commit_graph_context *ctx,
+				    struct commit *c)
+{
+	size_t size = 0;
+	int i, nr = commit_list_count(c->parents);
+
+	for (i = 1; i < nr; i++) {
+		struct bloom_filter *filter =
+			get_parent_bloom_filter(ctx->r, c, i);
+		size += sizeof(uint32_t) + (filter ? filter->len : 0);
+	}
+	return size;
+}
+
+static int write_graph_chunk_bloom_merge_indexes(struct hashfile *f,
+						 void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	struct commit **list = ctx->commits.list;
+	struct commit **last = ctx->commits.list + ctx->commits.nr;
+	uint32_t cur_pos = 0;
+
+	while (list < last) {
+		cur_pos += merge_bloom_data_size(ctx, *list);
+		display_progress(ctx->progress, ++ctx->progress_cnt);
+		hashwrite_be32(f, cur_pos);
+		list++;
+	}
+
+	return 0;
+}
+
+static int write_graph_chunk_bloom_merge_data(struct hashfile *f,
+					      void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	struct commit **list = ctx->commits.list;
+	struct commit **last = ctx->commits.list + ctx->commits.nr;
+
+	while (list < last) {
+		int i, nr = commit_list_count((*list)->parents);
+
+		for (i = 1; i < nr; i++) {
+			struct bloom_filter *filter =
+				get_parent_bloom_filter(ctx->r, *list, i);
+			size_t len = filter ? filter->len : 0;
+
+			hashwrite_be32(f, len);
+			if (len)
+				hashwrite(f, filter->data, len);
+		}
+		display_progress(ctx->progress, ++ctx->progress_cnt);
+		list++;
+	}
+
+	return 0;
+}
+
+static int write_graph_chunk_first_parent_jumps(struct hashfile *f,
+						void *data)
+{
+	struct write_commit_graph_context *ctx = data;
+	struct commit **list = ctx->commits.list;
+	struct commit **last = ctx->commits.list + ctx->commits.nr;
+
+	while (list < last) {
+		struct first_parent_jump *e =
+			first_parent_jump_slab_at(&ctx->first_parent_jumps_slab,
+						  *list);
+		int pos = GRAPH_PARENT_NONE;
+
+		if (e->jump) {
+			pos = oid_pos(&e->jump->object.oid, ctx->commits.list,
+				      ctx->commits.nr, commit_to_oid);
+			if (pos >= 0)
+				pos += ctx->new_num_commits_in_base;
+			else if (ctx->new_base_graph) {
+				uint32_t base_pos;
+				if (find_commit_in_graph(e->jump,
+							 ctx->new_base_graph,
+							 &base_pos))
+					pos = base_pos;
+			}
+			if (pos < 0)
+				BUG("missing first-parent jump %s for commit %s",
+				    oid_to_hex(&e->jump->object.oid),
+				    oid_to_hex(&(*list)->object.oid));
+		}
+
+		hashwrite_be32(f, e->height);
+		hashwrite_be32(f, pos);
+		display_progress(ctx->progress, ++ctx->progress_cnt);
+		list++;
+	}
+
+	return 0;
+}
+
 static int add_packed_commits(const struct object_id *oid,
 			      struct packed_git *pack,
 			      uint32_t pos,
@@ -1542,6 +1998,123 @@ static void trace2_bloom_filter_write_statistics(struct write_commit_graph_conte
 			   ctx->count_bloom_filter_trunc_empty);
 	trace2_data_intmax("commit-graph", ctx->r, "filter-trunc-large",
 			   ctx->count_bloom_filter_trunc_large);
+	if (ctx->merge_changed_paths)
+		trace2_data_intmax("commit-graph", ctx->r, "merge-filter-computed",
+				   ctx->count_bloom_merge_filter_computed);
+}
+
+/*
+ * Use the first-parent jump of a commit in the base graph we are
+ * writing on top of, if it has them.
+ */
+static int load_first_parent_jump(struct write_commit_graph_context *ctx,
+				  struct commit *c,
+				  struct first_parent_jump *e)
+{
+	uint32_t pos, jump, parent;
+	struct object_id oid;
+
+	if (!ctx->new_base_graph ||
+	    !find_commit_in_graph(c, ctx->new_base_graph, &pos) ||
+	    read_first_parent_jump(ctx->new_base_graph, pos,
+				   &e->height, &jump, &parent))
+		return -1;
+
+	if (jump == GRAPH_PARENT_NONE) {
+		e->jump = NULL;
+	} else {
+		load_oid_from_graph(ctx->new_base_graph, jump, &oid);
+		e->jump = lookup_commit(ctx->r, &oid);
+	}
+	e->computed = 1;
+	return 0;
+}
+
+static struct first_parent_jump *compute_first_parent_jump(
+		struct write_commit_graph_context *ctx, struct commit *c);
+
+/*
+ * Find the ancestor at "height" on the first-parent chain of "c", whose
+ * own ancestors must all have their jumps computed already.
+ */
+static struct commit *first_parent_ancestor(struct write_commit_graph_context *ctx,
+					    struct commit *c, uint32_t height)
+{
+	struct first_parent_jump *e = compute_first_parent_jump(ctx, c);
+
+	while (e->height > height) {
+		if (e->jump && take_first_parent_jump(e->height, height))
+			c = e->jump;
+		else if (!repo_parse_commit(ctx->r, c) && c->parents)
+			c = c->parents->item;
+		else
+			die(_("commit-graph has inconsistent first-parent jumps"));
+		e = compute_first_parent_jump(ctx, c);
+	}
+	return c;
+}
+
+static struct first_parent_jump *compute_first_parent_jump(
+		struct write_commit_graph_context *ctx, struct commit *c)
+{
+	struct first_parent_jump *e;
+	struct commit_list *stack = NULL;
+
+	commit_list_insert(c, &stack);
+	while (stack) {
+		struct commit *current = stack->item;
+		struct commit *parent;
+		struct first_parent_jump *p;
+
+		e = first_parent_jump_slab_at(&ctx->first_parent_jumps_slab,
+					      current);
+		if (e->computed || !load_first_parent_jump(ctx, current, e)) {
+			pop_commit(&stack);
+			continue;
+		}
+
+		if (repo_parse_commit(ctx->r, current))
+			die(_("unable to parse commit %s"),
+			    oid_to_hex(&current->object.oid));
+		if (!current->parents) {
+			e->height = 0;
+			e->jump = NULL;
+			e->computed = 1;
+			pop_commit(&stack);
+			continue;
+		}
+
+		parent = current->parents->item;
+		p = first_parent_jump_slab_at(&ctx->first_parent_jumps_slab,
+					      parent);
+		if (!p->computed && load_first_parent_jump(ctx, parent, p)) {
+			commit_list_insert(parent, &stack);
+			continue;
+		}
+
+		e->height = p->height + 1;
+		e->jump = first_parent_ancestor(ctx, parent,
+						first_parent_skip_height(e->height));
+		e->computed = 1;
+		pop_commit(&stack);
+	}
+
+	return first_parent_jump_slab_at(&ctx->first_parent_jumps_slab, c);
+}
+
+static void compute_first_parent_jumps(struct write_commit_graph_context *ctx)
+{
+	int i;
+
+	if (ctx->report_progress)
+		ctx->progress = start_delayed_progress(
+					_("Computing commit graph first-parent jumps"),
+					ctx->commits.nr);
+	for (i = 0; i < ctx->commits.nr; i++) {
+		compute_first_parent_jump(ctx, ctx->commits.list[i]);
+		display_progress(ctx->progress, i + 1);
+	}
+	stop_progress(&ctx->progress);
 }
 
 static void compute_bloom_filters(struct write_commit_graph_context *ctx)
@@ -1588,6 +2161,24 @@ static void compute_bloom_filters(struct write_commit_graph_context *ctx)
 			ctx->count_bloom_filter_not_computed++;
 		ctx->total_bloom_filter_data_size += filter
 			? sizeof(unsigned char) * filter->len : 0;
+
+		if (ctx->merge_changed_paths) {
+			int j, nr = commit_list_count(c->parents);
+
+			for (j = 1; j < nr; j++) {
+				computed = 0;
+				get_or_compute_parent_bloom_filter(
+					ctx->r, c, j,
+					ctx->count_bloom_filter_computed +
+					ctx->count_bloom_merge_filter_computed <
+						max_new_filters,
+					ctx->bloom_settings, &computed);
+				if (computed & BLOOM_COMPUTED)
+					ctx->count_bloom_merge_filter_computed++;
+			}
+			ctx->total_bloom_merge_data_size +=
+				merge_bloom_data_size(ctx, c);
+		}
 		display_progress(progress, i + 1);
 	}
 
@@ -1870,6 +2461,18 @@ static int write_commit_graph_file(struct write_commit_graph_context *ctx)
 				+ ctx->total_bloom_filter_data_size,
 			  write_graph_chunk_bloom_data);
 	}
+	if (ctx->merge_changed_paths) {
+		add_chunk(cf, GRAPH_CHUNKID_BLOOMMERGEINDEXES,
+			  sizeof(uint32_t) * ctx->commits.nr,
+			  write_graph_chunk_bloom_merge_indexes);
+		add_chunk(cf, GRAPH_CHUNKID_BLOOMMERGEDATA,
+			  ctx->total_bloom_merge_data_size,
+			  write_graph_chunk_bloom_merge_data);
+	}
+	if (ctx->first_parent_jumps)
+		add_chunk(cf, GRAPH_CHUNKID_FIRSTPARENTJUMPS,
+			  sizeof(uint32_t) * 2 * ctx->commits.nr,
+			  write_graph_chunk_first_parent_jumps);
 	if (ctx->num_commit_graphs_after > 1)
 		add_chunk(cf, GRAPH_CHUNKID_BASE,
 			  hashsz * (ctx->num_commit_graphs_after - 1),
@@ -2292,6 +2895,27 @@ int write_commit_graph(struct object_directory *odb,
 			ctx->bloom_settings = g->bloom_filter_settings;
 		}
 	}
+	if (ctx->changed_paths) {
+		struct commit_graph *g = ctx->r->objects->commit_graph;
+		int merge_changed_paths;
+
+		if (!repo_config_get_bool(r, "commitgraph.mergechangedpaths",
+					  &merge_changed_paths))
+			ctx->merge_changed_paths = merge_changed_paths;
+		else if (g && g->chunk_bloom_merge_data)
+			ctx->merge_changed_paths = 1;
+	}
+	{
+		struct commit_graph *g = ctx->r->objects->commit_graph;
+		int first_parent_jumps;
+
+		if (!repo_config_get_bool(r, "commitgraph.firstparentjumps",
+					  &first_parent_jumps))
+			ctx->first_parent_jumps = first_parent_jumps;
+		else if (g && g->chunk_first_parent_jumps)
+			ctx->first_parent_jumps = 1;
+	}
+	init_first_parent_jump_slab(&ctx->first_parent_jumps_slab);
 
 	if (ctx->split) {
 		struct commit_graph *g = ctx->r->objects->commit_graph;
@@ -2373,6 +2997,9 @@ int write_commit_graph(struct object_directory *odb,
 	if (ctx->changed_paths)
 		compute_bloom_filters(ctx);
 
+	if (ctx->first_parent_jumps)
+		compute_first_parent_jumps(ctx);
+
 	res = write_commit_graph_file(ctx);
 
 	if (ctx->split)
@@ -2385,6 +3012,7 @@ int write_commit_graph(struct object_directory *odb,
 	free(ctx->commits.list);
 	oid_array_clear(&ctx->oids);
 	clear_topo_level_slab(&topo_levels);
+	clear_first_parent_jump_slab(&ctx->first_parent_jumps_slab);
 
 	if (ctx->commit_graph_filenames_after) {
 		for (i = 0; i < ctx->num_commit_graphs_after; i++) {
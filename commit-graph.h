@@ -75,6 +75,10 @@ struct commit_graph {
 	const unsigned char *chunk_base_graphs;
 	const unsigned char *chunk_bloom_indexes;
 	const unsigned char *chunk_bloom_data;
+	const unsigned char *chunk_bloom_merge_indexes;
+	const unsigned char *chunk_bloom_merge_data;
+	size_t chunk_bloom_merge_data_size;
+	const unsigned char *chunk_first_parent_jumps;
 
 	struct topo_level_slab *topo_levels;
 	struct bloom_filter_settings *bloom_filter_settings;
@@ -102,6 +106,44 @@ int corrected_commit_dates_enabled(struct repository *r);
 
 struct bloom_filter_settings *get_bloom_filter_settings(struct repository *r);
 
+/*
+ * Return 1 if "ancestor" is reached from "c" by following first parents
+ * only, and store the number of steps it takes in "distance"; return 0
+ * if it is not. This takes O(log n) lookups in the first-parent jumps of
+ * the commit-graph. Return -1 if the commit-graph cannot tell, because
+ * either commit is not in it, or it was written without these jumps.
+ */
+int commit_graph_first_parent_distance(struct repository *r,
+				       struct commit *c,
+				       struct commit *ancestor,
+				       uint32_t *distance);
+
+/*
+ * Called by commit_graph_walk() for each commit it visits. Return 0 to
+ * go on with its parents, a positive value to not walk its parents,
+ * and a negative value to stop the walk.
+ */
+typedef int (*commit_graph_walk_fn)(const struct object_id *oid,
+				    timestamp_t date,
+				    unsigned int nr_parents,
+				    void *data);
+
+/*
+ * Walk the commits reachable from "tips" in the order a revision walk
+ * without any sorting or limiting options would show them, i.e. the
+ * most recent commit date first. The commits are read straight from the
+ * commit-graph and identified by their position in it, so that no
+ * "struct commit" or object hash table entry is allocated for them; a
+ * bit per commit in the graph records which ones have been seen.
+ *
+ * Return -1 without calling "fn" if the commit-graph cannot be used or
+ * any of the tips is not in it, and 0 after the walk.
+ */
+int commit_graph_walk(struct repository *r,
+		      struct commit **tips, size_t nr,
+		      int first_parent_only,
+		      commit_graph_walk_fn fn, void *data);
+
 enum commit_graph_write_flags {
 	COMMIT_GRAPH_WRITE_APPEND     = (1 << 0),
 	COMMIT_GRAPH_WRITE_PROGRESS   = (1 << 1),
@@ -8,6 +8,11 @@
 #include "revision.h"
 #include "tag.h"
 #include "commit-reach.h"
+#include "ewah/ewok.h"
+#include "object-store.h"
+#include "pack-bitmap.h"
+#include "replace-object.h"
+#include "shallow.h"
 
 /* Remember to update object flag allocation in object.h */
 #define PARENT1		(1u<<16)
@@ -17,6 +22,75 @@
 
 static const unsigned all_flags = (PARENT1 | PARENT2 | STALE | RESULT);
 
+/*
+ * The reachability bitmap index used to answer reachability queries,
+ * loaded on first use and kept for the rest of the process, or NULL
+ * if there is none (or it must not be used).
+ */
+static struct bitmap_index *reach_bitmap_git(struct repository *r)
+{
+	static struct repository *loaded_for;
+	static struct bitmap_index *bitmap_git;
+
+	if (loaded_for == r)
+		return bitmap_git;
+
+	free_bitmap_index(bitmap_git);
+	bitmap_git = NULL;
+	loaded_for = r;
+
+	prepare_repo_settings(r);
+	if (!r->settings.pack_use_bitmap_reachability)
+		return NULL;
+
+	/*
+	 * Bitmaps record the history as it is in the object store, and
+	 * know nothing of grafts, replace refs or shallow boundaries.
+	 */
+	if (read_replace_refs) {
+		prepare_replace_object(r);
+		if (hashmap_get_size(&r->objects->replace_map->map))
+			return NULL;
+	}
+	prepare_commit_graft(r);
+	if ((r->parsed_objects && r->parsed_objects->grafts_nr) ||
+	    is_repository_shallow(r))
+		return NULL;
+
+	bitmap_git = prepare_bitmap_git(r);
+	return bitmap_git;
+}
+
+/*
+ * Use the reachability bitmaps to find out whether "from" can reach
+ * any of the "to" commits. Returns 1 or 0 if the bitmaps can tell, and
+ * -1 if the caller needs to walk the history instead.
+ */
+static int bitmap_reaches_any(struct repository *r, struct commit *from,
+			      const struct commit_list *to)
+{
+	struct bitmap_index *bitmap_git = reach_bitmap_git(r);
+	struct bitmap *reach;
+	int ret = 0;
+
+	if (!bitmap_git)
+		return -1;
+	reach = bitmap_for_commit_reach(bitmap_git, from);
+	if (!reach)
+		return -1;
+
+	/*
+	 * Commits outside of the bitmapped pack cannot be reachable from
+	 * "from", as the pack is closed under reachability.
+	 */
+	for (; !ret && to; to = to->next)
+		ret = bitmap_walk_contains(bitmap_git, reach,
+					   &to->item->object.oid);
+
+	bitmap_free(reach);
+	return ret;
+}
+
 static int compare_commits_by_gen(const void *_a, const void *_b)
 {
 	const struct commit *a = *(const struct commit * const *)_a;
@@ -474,8 +548,8 @@ int repo_is_descendant_of(struct repository *r,
 int repo_in_merge_bases_many(struct repository *r, struct commit *commit,
 			     int nr_reference, struct commit **reference)
 {
-	struct commit_list *bases;
-	int ret = 0, i;
+	struct commit_list *bases, target;
+	int ret = 0, i, unknown = 0;
 	timestamp_t generation, max_generation = GENERATION_NUMBER_ZERO;
 
 	if (repo_parse_commit(r, commit))
@@ -493,6 +567,19 @@ int repo_in_merge_bases_many(struct repository *r, struct commit *commit,
 	if (generation > max_generation)
 		return ret;
 
+	target.item = commit;
+	target.next = NULL;
+	for (i = 0; i < nr_reference; i++) {
+		int reaches = bitmap_reaches_any(r, reference[i], &target);
+
+		if (reaches > 0)
+			return 1;
+		if (reaches < 0)
+			unknown = 1;
+	}
+	if (!unknown)
+		return 0;
+
 	bases = paint_down_to_common(r, commit,
 				     nr_reference, reference,
 				     generation);
@@ -823,6 +910,16 @@ int can_all_from_reach(struct commit_list *from, struct commit_list *to,
 	int result;
 	timestamp_t min_generation = GENERATION_NUMBER_INFINITY;
 
+	/*
+	 * Try the bitmaps first; give up on them as soon as they cannot
+	 * answer for one of the "from" commits.
+	 */
+	for (result = 1; result > 0 && from_iter; from_iter = from_iter->next)
+		result = bitmap_reaches_any(the_repository, from_iter->item, to);
+	if (result >= 0)
+		return result;
+	from_iter = from;
+
 	while (from_iter) {
 		add_object_array(&from_iter->item->object, NULL, &from_objs);
 
@@ -942,3 +1039,316 @@ struct commit_list *get_reachable_subset(struct commit **from, int nr_from,
 
 	return found_commits;
 }
+
+define_commit_slab(bit_arrays, struct bitmap *);
+define_commit_slab(ab_generations, timestamp_t);
+
+struct ahead_behind_walk {
+	struct repository *r;
+	struct bit_arrays bit_arrays;
+	struct ab_generations generations;
+	/*
+	 * Without generation numbers from a commit-graph, walk by commit
+	 * date instead of computing them for the whole history.
+	 */
+	int by_date;
+	/* every commit that got RESULT, PARENT2 or STALE, to clear them later */
+	struct commit **touched;
+	size_t touched_nr, touched_alloc;
+};
+
+/*
+ * Return a generation number for "c" that is strictly larger than the
+ * ones of its parents, computing it for commits that are not in the
+ * commit-graph. Without that, clock skew could make us pop a commit
+ * before one of its descendants and miss the bits that it carries.
+ */
+static timestamp_t ab_generation(struct ahead_behind_walk *w,
+				 struct commit *c)
+{
+	struct commit **stack = NULL;
+	size_t stack_nr = 0, stack_alloc = 0;
+	timestamp_t *gen = ab_generations_at(&w->generations, c);
+
+	if (*gen)
+		return *gen;
+
+	ALLOC_GROW(stack, stack_nr + 1, stack_alloc);
+	stack[stack_nr++] = c;
+	while (stack_nr) {
+		struct commit *top = stack[stack_nr - 1];
+		timestamp_t *top_gen = ab_generations_at(&w->generations, top);
+		timestamp_t max_gen = 0;
+		struct commit_list *p;
+		int all_known = 1;
+
+		if (*top_gen) {
+			stack_nr--;
+			continue;
+		}
+
+		repo_parse_commit(w->r, top);
+		if (commit_graph_generation(top) != GENERATION_NUMBER_INFINITY) {
+			*top_gen = commit_graph_generation(top) + 1;
+			stack_nr--;
+			continue;
+		}
+
+		for (p = top->parents; p; p = p->next) {
+			timestamp_t pgen = *ab_generations_at(&w->generations,
+							      p->item);
+			if (!pgen) {
+				all_known = 0;
+				ALLOC_GROW(stack, stack_nr + 1, stack_alloc);
+				stack[stack_nr++] = p->item;
+			} else if (pgen > max_gen) {
+				max_gen = pgen;
+			}
+		}
+		if (all_known) {
+			*top_gen = max_gen + 1;
+			stack_nr--;
+		}
+	}
+
+	free(stack);
+	return *gen;
+}
+
+static int compare_commits_by_ab_generation(const void *a_, const void *b_,
+					    void *data)
+{
+	struct ahead_behind_walk *w = data;
+	struct commit *a = (struct commit *)a_;
+	struct commit *b = (struct commit *)b_;
+	timestamp_t gen_a, gen_b;
+
+	if (w->by_date)
+		return compare_commits_by_commit_date(a_, b_, NULL);
+
+	gen_a = *ab_generations_at(&w->generations, a);
+	gen_b = *ab_generations_at(&w->generations, b);
+	if (gen_a < gen_b)
+		return 1;
+	if (gen_a > gen_b)
+		return -1;
+	return compare_commits_by_commit_date(a_, b_, NULL);
+}
+
+static struct bitmap *get_bit_array(struct ahead_behind_walk *w,
+				    struct commit *c, size_t width)
+{
+	struct bitmap **bitmap = bit_arrays_at(&w->bit_arrays, c);
+	if (!*bitmap)
+		*bitmap = bitmap_word_alloc(width);
+	return *bitmap;
+}
+
+/*
+ * Queue "c" unless it is queued already. RESULT marks the commits that
+ * were ever queued, PARENT2 those that are in the queue right now.
+ */
+static void ab_queue_put(struct ahead_behind_walk *w, struct prio_queue *queue,
+			 struct commit *c)
+{
+	if (c->object.flags & PARENT2)
+		return;
+	if (!(c->object.flags & RESULT)) {
+		if (!w->by_date)
+			ab_generation(w, c);
+		c->object.flags |= RESULT;
+		ALLOC_GROW(w->touched, w->touched_nr + 1, w->touched_alloc);
+		w->touched[w->touched_nr++] = c;
+	}
+	c->object.flags |= PARENT2;
+	prio_queue_put(queue, c);
+}
+
+/*
+ * Count a commit reached by the input commits set in "bitmap" for the
+ * counts those take part in. A commit that every input commit reaches
+ * counts for nobody; otherwise it is ahead (or behind) for each count
+ * where only the tip (or only the base) reaches it.
+ */
+static void ab_count_commit(struct bitmap *bitmap, size_t commits_nr,
+			    struct ahead_behind_count *counts,
+			    const size_t *by_commit, const size_t *by_commit_pos)
+{
+	size_t word;
+
+	for (word = 0; word < bitmap->word_alloc; word++) {
+		eword_t bits = bitmap->words[word];
+
+		while (bits) {
+			size_t idx = word * BITS_IN_EWORD + ewah_bit_ctz64(bits);
+			size_t k;
+
+			bits &= bits - 1;
+			if (idx >= commits_nr)
+				break;
+			for (k = by_commit_pos[idx]; k < by_commit_pos[idx + 1]; k++) {
+				struct ahead_behind_count *count = &counts[by_commit[k]];
+				int from_tip = bitmap_get(bitmap, count->tip_index);
+				int from_base = bitmap_get(bitmap, count->base_index);
+
+				if (from_tip && !from_base)
+					count->ahead++;
+				else if (from_base && !from_tip)
+					count->behind++;
+			}
+		}
+	}
+}
+
+void ahead_behind(struct repository *r,
+		  struct commit **commits, size_t commits_nr,
+		  struct ahead_behind_count *counts, size_t counts_nr)
+{
+	struct ahead_behind_walk w = { .r = r };
+	struct prio_queue queue = {
+		.compare = compare_commits_by_ab_generation,
+		.cb_data = &w,
+	};
+	size_t width = DIV_ROUND_UP(commits_nr, BITS_IN_EWORD);
+	size_t *by_commit, *by_commit_pos;
+	size_t i;
+
+	for (i = 0; i < counts_nr; i++) {
+		counts[i].ahead = 0;
+		counts[i].behind = 0;
+	}
+	if (!commits_nr || !counts_nr)
+		return;
+
+	/*
+	 * For each input commit, the counts it takes part in, so that
+	 * a walked commit only looks at the counts of the input commits
+	 * that reach it, instead of at all of them.
+	 */
+	CALLOC_ARRAY(by_commit_pos, commits_nr + 1);
+	for (i = 0; i < counts_nr; i++) {
+		by_commit_pos[counts[i].tip_index + 1]++;
+		if (counts[i].base_index != counts[i].tip_index)
+			by_commit_pos[counts[i].base_index + 1]++;
+	}
+	for (i = 0; i < commits_nr; i++)
+		by_commit_pos[i + 1] += by_commit_pos[i];
+	ALLOC_ARRAY(by_commit, by_commit_pos[commits_nr]);
+	{
+		size_t *fill;
+
+		ALLOC_ARRAY(fill, commits_nr);
+		COPY_ARRAY(fill, by_commit_pos, commits_nr);
+		for (i = 0; i < counts_nr; i++) {
+			by_commit[fill[counts[i].tip_index]++] = i;
+			if (counts[i].base_index != counts[i].tip_index)
+				by_commit[fill[counts[i].base_index]++] = i;
+		}
+		free(fill);
+	}
+
+	init_bit_arrays(&w.bit_arrays);
+	init_ab_generations(&w.generations);
+	w.by_date = !generation_numbers_enabled(r);
+
+	for (i = 0; i < commits_nr; i++) {
+		struct commit *c = commits[i];
+
+		repo_parse_commit(r, c);
+		bitmap_set(get_bit_array(&w, c, width), i);
+		ab_queue_put(&w, &queue, c);
+	}
+
+	/*
+	 * In date order, a commit that clock skew had us count too early
+	 * may turn out to be an ancestor of a STALE commit, and so count
+	 * for nobody; keep walking until the queue is empty to find out.
+	 */
+	while (w.by_date ? queue.nr : queue_has_nonstale(&queue)) {
+		struct commit *c = prio_queue_get(&queue);
+		struct bitmap *bitmap_c;
+		struct commit_list *p;
+
+		c->object.flags &= ~PARENT2;
+
+		/*
+		 * Every input commit reaches the ancestors of a STALE
+		 * commit, so marking them STALE is all that is left to do.
+		 */
+		if (w.by_date && (c->object.flags & STALE)) {
+			for (p = c->parents; p; p = p->next) {
+				if (p->item->object.flags & STALE)
+					continue;
+				repo_parse_commit(r, p->item);
+				p->item->object.flags |= STALE;
+				ab_queue_put(&w, &queue, p->item);
+			}
+			continue;
+		}
+
+		bitmap_c = get_bit_array(&w, c, width);
+
+		/*
+		 * In generation order, all the descendants of "c" among the
+		 * walked commits came before it, so its bits are final.
+		 */
+		if (!w.by_date && !(c->object.flags & STALE))
+			ab_count_commit(bitmap_c, commits_nr, counts,
+					by_commit, by_commit_pos);
+
+		for (p = c->parents; p; p = p->next) {
+			struct bitmap *bitmap_p;
+			size_t before;
+
+			repo_parse_commit(r, p->item);
+			bitmap_p = get_bit_array(&w, p->item, width);
+			before = bitmap_popcount(bitmap_p);
+			bitmap_or(bitmap_p, bitmap_c);
+
+			/*
+			 * Once every input commit reaches this parent, none
+			 * of its ancestors can change any count, so in
+			 * generation order the walk may stop when nothing
+			 * else is left in the queue.
+			 */
+			if (bitmap_popcount(bitmap_p) == commits_nr)
+				p->item->object.flags |= STALE;
+
+			/*
+			 * In date order, clock skew can show us a commit
+			 * before one of its descendants; walk it again with
+			 * the bits that arrived late.
+			 */
+			if (!(p->item->object.flags & RESULT) ||
+			    bitmap_popcount(bitmap_p) != before)
+				ab_queue_put(&w, &queue, p->item);
+		}
+
+		if (!w.by_date) {
+			bitmap_free(bitmap_c);
+			*bit_arrays_at(&w.bit_arrays, c) = NULL;
+		}
+	}
+
+	/*
+	 * In date order, the bits of a commit are only known to be final
+	 * once the walk is over; count the commits now.
+	 */
+	for (i = 0; i < w.touched_nr; i++) {
+		struct commit *c = w.touched[i];
+		struct bitmap **bitmap = bit_arrays_at(&w.bit_arrays, c);
+
+		if (w.by_date && *bitmap && !(c->object.flags & STALE))
+			ab_count_commit(*bitmap, commits_nr, counts,
+					by_commit, by_commit_pos);
+		bitmap_free(*bitmap);
+		c->object.flags &= ~(RESULT | PARENT2 | STALE);
+	}
+
+	free(w.touched);
+	free(by_commit);
+	free(by_commit_pos);
+	clear_bit_arrays(&w.bit_arrays);
+	clear_ab_generations(&w.generations);
+	clear_prio_queue(&queue);
+}
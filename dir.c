@@ -19,6 +19,8 @@
 #include "ewah/ewok.h"
 #include "fsmonitor.h"
 #include "submodule-config.h"
+#include "strmap.h"
+#include "thread-utils.h"
 
 /*
  * Tells read_directory_recursive how a file or directory should be treated.
@@ -46,6 +48,10 @@ struct cached_dir {
 	int d_type;
 	const char *file;
 	struct untracked_cache_dir *ucd;
+
+	/* entries read ahead of time by preload_directories() */
+	struct preloaded_dir *preloaded;
+	size_t preloaded_pos;
 };
 
 static enum path_treatment read_directory_recursive(struct dir_struct *dir,
@@ -873,6 +879,14 @@ int hashmap_contains_parent(struct hashmap *map,
 	return 0;
 }
 
+/*
+ * Lists with at least this many patterns are indexed, see
+ * struct pattern_index.
+ */
+#define PATTERN_INDEX_MIN 16
+
+static void update_pattern_index(struct pattern_list *pl);
+
 void add_pattern(const char *string, const char *base,
 		 int baselen, struct pattern_list *pl, int srcpos)
 {
@@ -899,6 +913,8 @@ void add_pattern(const char *string, const char *base,
 	pattern->pl = pl;
 
 	add_pattern_to_hashsets(pl, pattern);
+	if (pl->nr >= PATTERN_INDEX_MIN)
+		update_pattern_index(pl);
 }
 
 static int read_skip_worktree_file_from_index(struct index_state *istate,
@@ -918,6 +934,8 @@ static int read_skip_worktree_file_from_index(struct index_state *istate,
 	return do_read_blob(&istate->cache[pos]->oid, oid_stat, size_out, data_out);
 }
 
+static void free_pattern_index(struct pattern_index *index);
+
 /*
  * Frees memory within pl which was allocated for exclude patterns and
  * the file buffer.  Does not free pl itself.
@@ -932,6 +950,7 @@ void clear_pattern_list(struct pattern_list *pl)
 	free(pl->filebuf);
 	hashmap_clear_and_free(&pl->recursive_hashmap, struct pattern_entry, ent);
 	hashmap_clear_and_free(&pl->parent_hashmap, struct pattern_entry, ent);
+	free_pattern_index(pl->index);
 
 	memset(pl, 0, sizeof(*pl));
 }
@@ -1347,6 +1366,337 @@ int match_pathname(const char *pathname, int pathlen,
 				 WM_PATHNAME) == 0;
 }
 
+static int path_pattern_matches(const char *pathname, int pathlen,
+				const char *basename, int *dtype,
+				struct path_pattern *pattern,
+				struct index_state *istate)
+{
+	const char *exclude = pattern->pattern;
+	int prefix = pattern->nowildcardlen;
+
+	if (pattern->flags & PATTERN_FLAG_MUSTBEDIR) {
+		*dtype = resolve_dtype(*dtype, istate, pathname, pathlen);
+		if (*dtype != DT_DIR)
+			return 0;
+	}
+
+	if (pattern->flags & PATTERN_FLAG_NODIR)
+		return match_basename(basename,
+				      pathlen - (basename - pathname),
+				      exclude, prefix, pattern->patternlen,
+				      pattern->flags);
+
+	assert(pattern->baselen == 0 ||
+	       pattern->base[pattern->baselen - 1] == '/');
+	return match_pathname(pathname, pathlen,
+			      pattern->base,
+			      pattern->baselen ? pattern->baselen - 1 : 0,
+			      exclude, prefix, pattern->patternlen,
+			      pattern->flags);
+}
+
+/*
+ * Most patterns in long .gitignore files (and non-cone sparse-checkout
+ * files) either name a file or directory ("build", "Thumbs.db"), a
+ * suffix ("*.o"), or start with a literal directory ("/out/", "doc/man").
+ * These are put into hash tables by the name, the suffix or the first
+ * path component they want, so that for a path only the few that can
+ * match it, plus all other patterns, need to be tried. Each
+ * pattern_index_list holds positions in pl->patterns[] in ascending
+ * order; last_matching_pattern_from_list() merges those that apply to
+ * the path to try them from the last to the first, as before.
+ *
+ * The index is built as the patterns are added, so that matching does
+ * not modify the list and can be done by several threads at once.
+ */
+struct pattern_index_list {
+	int *pos;
+	int nr, alloc;
+};
+
+struct pattern_index_entry {
+	struct hashmap_entry ent;
+	const char *key;
+	int keylen;
+	struct pattern_index_list list;
+};
+
+struct pattern_index {
+	int nr;			/* number of patterns indexed */
+	int ignore_case;	/* value of ignore_case when indexed */
+	struct hashmap literal;
+	struct hashmap suffix;
+	struct hashmap first_component;
+	const char *base;	/* of the patterns in "first_component" */
+	int baselen;
+	int have_base;
+	int *suffix_len;	/* lengths in "suffix", ascending */
+	int suffix_len_nr, suffix_len_alloc;
+	struct pattern_index_list other;
+};
+
+static int pattern_index_entry_cmp(const void *unused_cmp_data,
+				   const struct hashmap_entry *a,
+				   const struct hashmap_entry *b,
+				   const void *unused_keydata)
+{
+	const struct pattern_index_entry *ea, *eb;
+
+	ea = container_of(a, struct pattern_index_entry, ent);
+	eb = container_of(b, struct pattern_index_entry, ent);
+	return ea->keylen != eb->keylen || memcmp(ea->key, eb->key, ea->keylen);
+}
+
+static void pattern_index_list_add(struct pattern_index_list *list, int pos)
+{
+	ALLOC_GROW(list->pos, list->nr + 1, list->alloc);
+	list->pos[list->nr++] = pos;
+}
+
+static struct pattern_index_list *pattern_index_get(struct hashmap *map,
+						    const char *key, int keylen,
+						    int create)
+{
+	struct pattern_index_entry k, *e;
+
+	hashmap_entry_init(&k.ent, memhash(key, keylen));
+	k.key = key;
+	k.keylen = keylen;
+	e = hashmap_get_entry(map, &k, ent, NULL);
+	if (!e && create) {
+		CALLOC_ARRAY(e, 1);
+		hashmap_entry_init(&e->ent, k.ent.hash);
+		e->key = key;
+		e->keylen = keylen;
+		hashmap_add(map, &e->ent);
+	}
+	return e ? &e->list : NULL;
+}
+
+static void clear_pattern_index_map(struct hashmap *map)
+{
+	struct hashmap_iter iter;
+	struct pattern_index_entry *e;
+
+	hashmap_for_each_entry(map, &iter, e, ent)
+		free(e->list.pos);
+	hashmap_clear_and_free(map, struct pattern_index_entry, ent);
+}
+
+static void free_pattern_index(struct pattern_index *index)
+{
+	if (!index)
+		return;
+	clear_pattern_index_map(&index->literal);
+	clear_pattern_index_map(&index->suffix);
+	clear_pattern_index_map(&index->first_component);
+	free(index->suffix_len);
+	free(index->other.pos);
+	free(index);
+}
+
+static void add_suffix_len(struct pattern_index *index, int len)
+{
+	int i;
+
+	for (i = 0; i < index->suffix_len_nr; i++)
+		if (index->suffix_len[i] >= len)
+			break;
+	if (i < index->suffix_len_nr && index->suffix_len[i] == len)
+		return;
+	ALLOC_GROW(index->suffix_len, index->suffix_len_nr + 1,
+		   index->suffix_len_alloc);
+	MOVE_ARRAY(index->suffix_len + i + 1, index->suffix_len + i,
+		   index->suffix_len_nr - i);
+	index->suffix_len[i] = len;
+	index->suffix_len_nr++;
+}
+
+/*
+ * Return the length of the first path component that all paths matched
+ * by the pattern (which has a slash) have in common, after the base, or
+ * 0 if the pattern starts with a wildcard.
+ */
+static int literal_first_component(const struct path_pattern *pattern,
+				   const char **component)
+{
+	const char *p = pattern->pattern;
+	int prefix = pattern->nowildcardlen;
+	const char *slash;
+
+	if (*p == '/') {
+		p++;
+		prefix--;
+	}
+	*component = p;
+	slash = memchr(p, '/', prefix);
+	if (slash)
+		return slash - p;
+	if (prefix == pattern->patternlen - (p - pattern->pattern))
+		return prefix;
+	return 0;
+}
+
+/* Bring pl->index up to date with the patterns added since it was built. */
+static void update_pattern_index(struct pattern_list *pl)
+{
+	struct pattern_index *index = pl->index;
+
+	if (index && index->ignore_case != ignore_case) {
+		free_pattern_index(index);
+		index = pl->index = NULL;
+	}
+	if (!index) {
+		CALLOC_ARRAY(index, 1);
+		hashmap_init(&index->literal, pattern_index_entry_cmp, NULL, 0);
+		hashmap_init(&index->suffix, pattern_index_entry_cmp, NULL, 0);
+		hashmap_init(&index->first_component, pattern_index_entry_cmp,
+			     NULL, 0);
+		index->ignore_case = ignore_case;
+		pl->index = index;
+	}
+
+	for (; index->nr < pl->nr; index->nr++) {
+		const struct path_pattern *pattern = pl->patterns[index->nr];
+		int pos = index->nr;
+
+		const char *component;
+		int len;
+
+		/* the hash tables compare byte for byte */
+		if (ignore_case)
+			pattern_index_list_add(&index->other, pos);
+		else if (!(pattern->flags & PATTERN_FLAG_NODIR)) {
+			/* all of them come from the same file, usually */
+			if (!index->have_base) {
+				index->base = pattern->base;
+				index->baselen = pattern->baselen;
+				index->have_base = 1;
+			}
+			len = literal_first_component(pattern, &component);
+			if (len && index->baselen == pattern->baselen &&
+			    (!pattern->baselen ||
+			     !memcmp(index->base, pattern->base, pattern->baselen)))
+				pattern_index_list_add(
+					pattern_index_get(&index->first_component,
+							  component, len, 1),
+					pos);
+			else
+				pattern_index_list_add(&index->other, pos);
+		} else if (pattern->nowildcardlen == pattern->patternlen)
+			pattern_index_list_add(
+				pattern_index_get(&index->literal,
+						  pattern->pattern,
+						  pattern->patternlen, 1),
+				pos);
+		else if (pattern->flags & PATTERN_FLAG_ENDSWITH) {
+			pattern_index_list_add(
+				pattern_index_get(&index->suffix,
+						  pattern->pattern + 1,
+						  pattern->patternlen - 1, 1),
+				pos);
+			add_suffix_len(index, pattern->patternlen - 1);
+		} else
+			pattern_index_list_add(&index->other, pos);
+	}
+}
+
+/*
+ * The lists of candidates for one lookup, and how far down each of them
+ * the lookup got.
+ */
+struct pattern_candidates {
+	const struct pattern_index_list **lists;
+	int *next;
+	int nr;
+};
+
+static void add_candidates(struct pattern_candidates *c,
+			   const struct pattern_index_list *list)
+{
+	if (!list || !list->nr)
+		return;
+	c->lists[c->nr] = list;
+	c->next[c->nr] = list->nr - 1;
+	c->nr++;
+}
+
+#define PATTERN_CANDIDATES_ON_STACK 16
+
+static struct path_pattern *last_matching_pattern_from_index(const char *pathname,
+							     int pathlen,
+							     const char *basename,
+							     int *dtype,
+							     struct pattern_list *pl,
+							     struct index_state *istate)
+{
+	struct pattern_index *index = pl->index;
+	int basenamelen = pathlen - (basename - pathname);
+	const struct pattern_index_list *lists[PATTERN_CANDIDATES_ON_STACK];
+	int next[PATTERN_CANDIDATES_ON_STACK];
+	struct pattern_candidates c = { lists, next, 0 };
+	struct path_pattern *res = NULL;
+	int i, max = 3 + index->suffix_len_nr;
+
+	if (max > PATTERN_CANDIDATES_ON_STACK) {
+		ALLOC_ARRAY(c.lists, max);
+		ALLOC_ARRAY(c.next, max);
+	}
+
+	add_candidates(&c, &index->other);
+	add_candidates(&c, pattern_index_get(&index->literal, basename,
+					     basenamelen, 0));
+	/* match_pathname() wants the path to be in the base directory */
+	if (index->have_base && pathlen > index->baselen &&
+	    !strncmp(pathname, index->base, index->baselen)) {
+		const char *component = pathname + index->baselen;
+		const char *end = memchr(component, '/',
+					 pathlen - index->baselen);
+		int len = end ? end - component : pathlen - index->baselen;
+
+		add_candidates(&c, pattern_index_get(&index->first_component,
+						     component, len, 0));
+	}
+	for (i = 0; i < index->suffix_len_nr; i++) {
+		int len = index->suffix_len[i];
+		if (len > basenamelen)
+			break;
+		add_candidates(&c, pattern_index_get(&index->suffix,
+						     basename + basenamelen - len,
+						     len, 0));
+	}
+
+	for (;;) {
+		int best = -1, pos = -1;
+
+		for (i = 0; i < c.nr; i++) {
+			int p;
+			if (c.next[i] < 0)
+				continue;
+			p = c.lists[i]->pos[c.next[i]];
+			if (p > pos) {
+				pos = p;
+				best = i;
+			}
+		}
+		if (best < 0)
+			break;
+		c.next[best]--;
+
+		if (path_pattern_matches(pathname, pathlen, basename, dtype,
+					 pl->patterns[pos], istate)) {
+			res = pl->patterns[pos];
+			break;
+		}
+	}
+
+	if (c.lists != lists) {
+		free(c.lists);
+		free(c.next);
+	}
+	return res;
+}
+
 /*
  * Scan the given exclude list in reverse to see whether pathname
  * should be ignored.  The first match (i.e. the last on the list), if
@@ -1360,46 +1710,29 @@ static struct path_pattern *last_matching_pattern_from_list(const char *pathname
 						       struct pattern_list *pl,
 						       struct index_state *istate)
 {
-	struct path_pattern *res = NULL; /* undecided */
 	int i;
 
 	if (!pl->nr)
 		return NULL;	/* undefined */
 
+	/*
+	 * The index is only used while it is up to date; it is not
+	 * rebuilt here, so that matching leaves the list alone.
+	 */
+	if (pl->index && pl->index->nr == pl->nr &&
+	    pl->index->ignore_case == ignore_case)
+		return last_matching_pattern_from_index(pathname, pathlen,
+							basename, dtype,
+							pl, istate);
+
 	for (i = pl->nr - 1; 0 <= i; i--) {
 		struct path_pattern *pattern = pl->patterns[i];
-		const char *exclude = pattern->pattern;
-		int prefix = pattern->nowildcardlen;
-
-		if (pattern->flags & PATTERN_FLAG_MUSTBEDIR) {
-			*dtype = resolve_dtype(*dtype, istate, pathname, pathlen);
-			if (*dtype != DT_DIR)
-				continue;
-		}
 
-		if (pattern->flags & PATTERN_FLAG_NODIR) {
-			if (match_basename(basename,
-					   pathlen - (basename - pathname),
-					   exclude, prefix, pattern->patternlen,
-					   pattern->flags)) {
-				res = pattern;
-				break;
-			}
-			continue;
-		}
-
-		assert(pattern->baselen == 0 ||
-		       pattern->base[pattern->baselen - 1] == '/');
-		if (match_pathname(pathname, pathlen,
-				   pattern->base,
-				   pattern->baselen ? pattern->baselen - 1 : 0,
-				   exclude, prefix, pattern->patternlen,
-				   pattern->flags)) {
-			res = pattern;
-			break;
-		}
+		if (path_pattern_matches(pathname, pathlen, basename, dtype,
+					 pattern, istate))
+			return pattern;
 	}
-	return res;
+	return NULL;
 }
 
 enum pattern_match_result path_matches_cone_mode_pattern_list(
@@ -2465,6 +2798,201 @@ static int valid_cached_dir(struct dir_struct *dir,
 	return untracked->valid;
 }
 
+/*
+ * Reading the directories of a large worktree one after the other is
+ * dominated by the latency of opendir() and readdir() while they are
+ * not in the OS cache yet. The walk in read_directory() opens every
+ * directory that holds tracked files, unless the untracked cache can
+ * tell that it did not change. So with core.preloadIndex, we first let
+ * a few threads read those directories, each taking the next batch of
+ * them from a shared list until none are left, and open_cached_dir()
+ * then hands out what they found.
+ *
+ * Everything else, i.e. the exclude patterns, the untracked cache and
+ * the lists of results, is still done by the walk itself, in order.
+ */
+#define PRELOAD_DIRS_MAX_PARALLEL (20)
+#define PRELOAD_DIRS_THREAD_COST (100)
+#define PRELOAD_DIRS_BATCH (16)
+
+struct preloaded_dirent {
+	size_t name; /* offset into preloaded_dir.names */
+	int d_type;
+};
+
+struct preloaded_dir {
+	/* as passed to open_cached_dir(), e.g. "" or "sub/dir/" */
+	char *path;
+	/* NUL-terminated names of the entries, in readdir() order */
+	struct strbuf names;
+	struct preloaded_dirent *entries;
+	size_t nr, alloc;
+	unsigned read:1;
+};
+
+struct preloaded_dirs {
+	struct preloaded_dir *dirs;
+	size_t nr, alloc;
+	struct strmap by_path;
+
+	pthread_mutex_t mutex;
+	size_t next;
+};
+
+static void preload_one_directory(struct preloaded_dir *pdir)
+{
+	DIR *fdir = opendir(*pdir->path ? pdir->path : ".");
+	struct dirent *de;
+
+	if (!fdir)
+		return;
+	while ((de = readdir_skip_dot_and_dotdot(fdir)) != NULL) {
+		ALLOC_GROW(pdir->entries, pdir->nr + 1, pdir->alloc);
+		pdir->entries[pdir->nr].name = pdir->names.len;
+		pdir->entries[pdir->nr].d_type = DTYPE(de);
+		pdir->nr++;
+		strbuf_addstr(&pdir->names, de->d_name);
+		strbuf_addch(&pdir->names, '\0');
+	}
+	closedir(fdir);
+	pdir->read = 1;
+}
+
+static void *preload_directories_thread(void *data)
+{
+	struct preloaded_dirs *pd = data;
+
+	for (;;) {
+		size_t i, end;
+
+		pthread_mutex_lock(&pd->mutex);
+		i = pd->next;
+		end = i + PRELOAD_DIRS_BATCH;
+		if (end > pd->nr)
+			end = pd->nr;
+		pd->next = end;
+		pthread_mutex_unlock(&pd->mutex);
+
+		if (i >= end)
+			return NULL;
+		for (; i < end; i++)
+			preload_one_directory(&pd->dirs[i]);
+	}
+}
+
+static void add_preloaded_dir(struct preloaded_dirs *pd,
+			      const char *path, size_t len)
+{
+	ALLOC_GROW(pd->dirs, pd->nr + 1, pd->alloc);
+	memset(&pd->dirs[pd->nr], 0, sizeof(pd->dirs[pd->nr]));
+	pd->dirs[pd->nr].path = xmemdupz(path, len);
+	strbuf_init(&pd->dirs[pd->nr].names, 0);
+	pd->nr++;
+}
+
+static void preload_directories(struct dir_struct *dir,
+				struct index_state *istate)
+{
+	struct preloaded_dirs *pd;
+	const char *prev = "";
+	size_t prev_len = 0;
+	pthread_t pthreads[PRELOAD_DIRS_MAX_PARALLEL];
+	int threads, i;
+
+	if (!HAVE_THREADS || !core_preload_index || core_virtualfilesystem)
+		return;
+
+	CALLOC_ARRAY(pd, 1);
+	add_preloaded_dir(pd, "", 0);
+
+	/*
+	 * The index is sorted, so the entries of each directory come
+	 * together; add the directories that the name of each entry
+	 * enters, but the previous one did not.
+	 */
+	for (i = 0; i < istate->cache_nr; i++) {
+		const struct cache_entry *ce = istate->cache[i];
+		const char *slash = strrchr(ce->name, '/');
+		size_t len, common = 0, j;
+
+		if (!slash || S_ISSPARSEDIR(ce->ce_mode))
+			continue;
+		len = slash - ce->name + 1;
+		if (len == prev_len && !memcmp(ce->name, prev, len))
+			continue;
+		for (j = 0; j < len && j < prev_len && ce->name[j] == prev[j]; j++)
+			if (ce->name[j] == '/')
+				common = j + 1;
+		for (j = common; j < len; j++)
+			if (ce->name[j] == '/')
+				add_preloaded_dir(pd, ce->name, j + 1);
+		prev = ce->name;
+		prev_len = len;
+	}
+
+	threads = pd->nr / PRELOAD_DIRS_THREAD_COST;
+	if (pd->nr > 1 && threads < 2 &&
+	    git_env_bool("GIT_TEST_PRELOAD_INDEX", 0))
+		threads = 2;
+	if (threads < 2) {
+		for (i = 0; i < pd->nr; i++)
+			free(pd->dirs[i].path);
+		free(pd->dirs);
+		free(pd);
+		return;
+	}
+	if (threads > PRELOAD_DIRS_MAX_PARALLEL)
+		threads = PRELOAD_DIRS_MAX_PARALLEL;
+
+	trace2_region_enter("dir", "preload", istate->repo);
+	pthread_mutex_init(&pd->mutex, NULL);
+	for (i = 0; i < threads; i++) {
+		int err = pthread_create(&pthreads[i], NULL,
+					 preload_directories_thread, pd);
+		if (err)
+			die(_("unable to create threaded opendir: %s"),
+			    strerror(err));
+	}
+	for (i = 0; i < threads; i++)
+		if (pthread_join(pthreads[i], NULL))
+			die("unable to join threaded opendir");
+	pthread_mutex_destroy(&pd->mutex);
+
+	strmap_init(&pd->by_path);
+	for (i = 0; i < pd->nr; i++)
+		if (pd->dirs[i].read)
+			strmap_put(&pd->by_path, pd->dirs[i].path, &pd->dirs[i]);
+	trace2_data_intmax("dir", istate->repo, "preload/directories",
+			   strmap_get_size(&pd->by_path));
+	trace2_region_leave("dir", "preload", istate->repo);
+
+	dir->preloaded = pd;
+}
+
+static void release_preloaded_dir(struct preloaded_dir *pdir)
+{
+	strbuf_release(&pdir->names);
+	FREE_AND_NULL(pdir->entries);
+	pdir->nr = pdir->alloc = 0;
+	pdir->read = 0;
+}
+
+static void free_preloaded_directories(struct dir_struct *dir)
+{
+	struct preloaded_dirs *pd = dir->preloaded;
+	size_t i;
+
+	if (!pd)
+		return;
+	for (i = 0; i < pd->nr; i++) {
+		release_preloaded_dir(&pd->dirs[i]);
+		free(pd->dirs[i].path);
+	}
+	free(pd->dirs);
+	strmap_clear(&pd->by_path, 0);
+	FREE_AND_NULL(dir->preloaded);
+}
+
 static int open_cached_dir(struct cached_dir *cdir,
 			   struct dir_struct *dir,
 			   struct untracked_cache_dir *untracked,
@@ -2478,6 +3006,19 @@ static int open_cached_dir(struct cached_dir *cdir,
 	cdir->untracked = untracked;
 	if (valid_cached_dir(dir, untracked, istate, path, check_only))
 		return 0;
+	if (dir->preloaded) {
+		struct preloaded_dir *pdir =
+			strmap_get(&dir->preloaded->by_path, path->buf);
+
+		if (pdir && pdir->read) {
+			cdir->preloaded = pdir;
+			if (dir->untracked) {
+				invalidate_directory(dir->untracked, untracked);
+				dir->untracked->dir_opened++;
+			}
+			return 0;
+		}
+	}
 	c_path = path->len ? path->buf : ".";
 	cdir->fdir = opendir(c_path);
 	if (!cdir->fdir)
@@ -2495,6 +3036,20 @@ static int read_cached_dir(struct cached_dir *cdir)
 {
 	struct dirent *de;
 
+	if (cdir->preloaded) {
+		struct preloaded_dir *pdir = cdir->preloaded;
+
+		if (cdir->preloaded_pos >= pdir->nr) {
+			cdir->d_name = NULL;
+			cdir->d_type = DT_UNKNOWN;
+			return -1;
+		}
+		cdir->d_name = pdir->names.buf +
+			pdir->entries[cdir->preloaded_pos].name;
+		cdir->d_type = pdir->entries[cdir->preloaded_pos].d_type;
+		cdir->preloaded_pos++;
+		return 0;
+	}
 	if (cdir->fdir) {
 		de = readdir_skip_dot_and_dotdot(cdir->fdir);
 		if (!de) {
@@ -2529,6 +3084,9 @@ static void close_cached_dir(struct cached_dir *cdir)
 {
 	if (cdir->fdir)
 		closedir(cdir->fdir);
+	/* a directory we visit again is read from disk */
+	if (cdir->preloaded)
+		release_preloaded_dir(cdir->preloaded);
 	/*
 	 * We have gone through this directory and found no untracked
 	 * entries. Mark it valid.
@@ -2566,7 +3124,7 @@ static void add_path_to_appropriate_result_list(struct dir_struct *dir,
 		if (dir->flags & DIR_SHOW_IGNORED)
 			break;
 		dir_add_name(dir, istate, path->buf, path->len);
-		if (cdir->fdir)
+		if (cdir->fdir || cdir->preloaded)
 			add_untracked(untracked, path->buf + baselen);
 		break;
 
@@ -2671,7 +3229,7 @@ static enum path_treatment read_directory_recursive(struct dir_struct *dir,
 
 			/* abort early if maximum state has been reached */
 			if (dir_state == path_untracked) {
-				if (cdir.fdir)
+				if (cdir.fdir || cdir.preloaded)
 					add_untracked(untracked, path.buf + baselen);
 				break;
 			}
@@ -2991,8 +3549,12 @@ int read_directory(struct dir_struct *dir, struct index_state *istate,
 		 * e.g. prep_exclude()
 		 */
 		dir->untracked = NULL;
+	if (!len && (!pathspec || !pathspec->nr) &&
+	    (!untracked || !untracked->valid))
+		preload_directories(dir, istate);
 	if (!len || treat_leading_path(dir, istate, path, len, pathspec))
 		read_directory_recursive(dir, istate, path, len, untracked, 0, 0, pathspec);
+	free_preloaded_directories(dir);
 	QSORT(dir->entries, dir->nr, cmp_dir_entry);
 	QSORT(dir->ignored, dir->ignored_nr, cmp_dir_entry);
 
@@ -115,6 +115,13 @@ struct pattern_list {
 	 * Used to check single-level parents of blobs.
 	 */
 	struct hashmap parent_hashmap;
+
+	/*
+	 * Index of the patterns by basename and suffix, kept up to date
+	 * by add_pattern() for last_matching_pattern_from_list() on long
+	 * lists.
+	 */
+	struct pattern_index *index;
 };
 
 /*
@@ -340,6 +347,9 @@ struct dir_struct {
 	/* Stats about the traversal */
 	unsigned visited_paths;
 	unsigned visited_directories;
+
+	/* Directories read ahead of the walk, see preload_directories() */
+	struct preloaded_dirs *preloaded;
 };
 
 #define DIR_INIT { 0 }
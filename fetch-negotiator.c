@@ -14,6 +14,10 @@ void fetch_negotiator_init(struct repository *r,
 		skipping_negotiator_init(negotiator);
 		return;
 
+	case FETCH_NEGOTIATION_GENERATION:
+		generation_negotiator_init(negotiator);
+		return;
+
 	case FETCH_NEGOTIATION_NOOP:
 		noop_negotiator_init(negotiator);
 		return;
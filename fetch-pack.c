@@ -2035,8 +2035,15 @@ void negotiate_using_fetch(const struct oid_array *negotiation_tips,
 		packet_buf_write(&req_buf, "wait-for-done");
 
 		haves_added = add_haves(&negotiator, &req_buf, &haves_to_send);
+		if (!haves_added)
+			/*
+			 * The negotiator has run out of commits. A request
+			 * without any "have" would be answered with a
+			 * packfile, so stop here.
+			 */
+			break;
 		in_vain += haves_added;
-		if (!haves_added || (seen_ack && in_vain >= MAX_IN_VAIN))
+		if (seen_ack && in_vain >= MAX_IN_VAIN)
 			last_iteration = 1;
 
 		/* Send request */
@@ -465,6 +465,62 @@ void refresh_fsmonitor(struct index_state *istate)
 	istate->fsmonitor_last_update = strbuf_detach(&last_update_token, NULL);
 }
 
+int fsmonitor_query_changes(struct repository *r, const char *since_token,
+			    struct strbuf *token, struct strbuf *changes)
+{
+	struct strbuf query_result = STRBUF_INIT;
+	enum fsmonitor_mode fsm_mode = fsm_settings__get_mode(r);
+	size_t bol = 0;
+	int ret = -1;
+
+	strbuf_reset(token);
+	strbuf_reset(changes);
+
+	if (fsm_mode == FSMONITOR_MODE_IPC) {
+		ret = fsmonitor_ipc__send_query(since_token, &query_result);
+		if (!ret) {
+			strbuf_addstr(token, query_result.buf);
+			bol = token->len + 1;
+		}
+	} else if (fsm_mode == FSMONITOR_MODE_HOOK) {
+		int hook_version = fsmonitor_hook_version();
+		uint64_t now = getnanotime();
+
+		if (hook_version != HOOK_INTERFACE_VERSION1) {
+			ret = query_fsmonitor_hook(r, HOOK_INTERFACE_VERSION2,
+						   since_token, &query_result);
+			if (!ret) {
+				strbuf_addstr(token, query_result.buf);
+				if (!token->len)
+					ret = -1;
+				bol = token->len + 1;
+			}
+		}
+		if (ret && hook_version != HOOK_INTERFACE_VERSION2) {
+			strbuf_reset(&query_result);
+			ret = query_fsmonitor_hook(r, HOOK_INTERFACE_VERSION1,
+						   since_token, &query_result);
+			if (!ret) {
+				strbuf_addf(token, "%"PRIu64"", now);
+				bol = 0;
+			}
+		}
+	}
+
+	if (!ret) {
+		if (bol > query_result.len)
+			bol = query_result.len;
+		if (query_result.buf[bol] == '/')
+			ret = 1;
+		else
+			strbuf_add(changes, query_result.buf + bol,
+				   query_result.len - bol);
+	}
+
+	strbuf_release(&query_result);
+	return ret;
+}
+
 /*
  * The caller wants to turn on FSMonitor.  And when the caller writes
  * the index to disk, a FSMonitor extension should be included.  This
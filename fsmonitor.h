@@ -45,6 +45,18 @@ void tweak_fsmonitor(struct index_state *istate);
  */
 void refresh_fsmonitor(struct index_state *istate);
 
+/*
+ * Ask the configured fsmonitor (hook or daemon) which paths changed
+ * since `since_token`, without touching any index.  The new token is
+ * stored in `token` and the NUL terminated pathnames in `changes`.
+ *
+ * Returns 0 on success, 1 if the fsmonitor had no information (the
+ * "trivial" response, i.e. everything may have changed) and -1 if it
+ * could not be queried.
+ */
+int fsmonitor_query_changes(struct repository *r, const char *since_token,
+			    struct strbuf *token, struct strbuf *changes);
+
 /*
  * Does the received result contain the "trivial" response?
  */
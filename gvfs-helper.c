@@ -80,6 +80,11 @@
 //                       Request objects from server in batches of at
 //                       most n objects (not bytes).
 //
+//                 --max-parallel=<n>    // defaults to "1"
+//
+//                       Keep up to n batches in flight at once.  The
+//                       default comes from "gvfs.maxParallelRequests".
+//
 //                 --depth=<depth>       // defaults to "1"
 //
 //                 --max-retries=<n>     // defaults to "6"
@@ -120,6 +125,10 @@
 //                       most n objects (not bytes) when using POST
 //                       requests.
 //
+//                 --max-parallel=<n>    // defaults to "1"
+//
+//                       Keep up to n POST batches in flight at once.
+//
 //                 --depth=<depth>       // defaults to "1"
 //
 //                 --max-retries=<n>     // defaults to "6"
@@ -279,6 +288,12 @@ static const char *const server_usage[] = {
  */
 #define GH__DEFAULT__OBJECTS_POST__BLOCK_SIZE 4000
 
+/*
+ * Number of POST requests to keep in flight at once when a request
+ * is split into blocks.
+ */
+#define GH__DEFAULT__OBJECTS_POST__MAX_PARALLEL 1
+
 /*
  * Retry attempts (after the initial request) for transient errors and 429s.
  */
@@ -334,6 +349,7 @@ static struct gh__cmd_opts {
 
 	int depth;
 	int block_size;
+	int max_parallel;
 	int max_retries;
 	int max_transient_backoff_sec;
 
@@ -2856,16 +2872,20 @@ static void set_cache_server_creds_on_slot(struct active_request_slot *slot,
 }
 
 /*
- * Do a single HTTP request WITHOUT robust-retry, auth-retry or fallback.
+ * Get a slot and set it up for a single HTTP request, but do not start it.
+ *
+ * Returns NULL (with the error in `status`) if we could not create the
+ * tempfile to receive the response.
  */
-static void do_req(const char *url_base,
-		   const char *url_component,
-		   const struct credential *creds,
-		   struct gh__request_params *params,
-		   struct gh__response_status *status)
+static struct active_request_slot *do_req__prepare_slot(
+	const char *url_base,
+	const char *url_component,
+	const struct credential *creds,
+	struct gh__request_params *params,
+	struct gh__response_status *status,
+	struct slot_results *results)
 {
 	struct active_request_slot *slot;
-	struct slot_results results;
 	struct strbuf rest_url = STRBUF_INIT;
 
 	gh__response_status__zero(status);
@@ -2877,7 +2897,7 @@ static void do_req(const char *url_base,
 
 		my_create_tempfile(status, 1, NULL, &params->tempfile, NULL, NULL);
 		if (!params->tempfile || status->ec != GH__ERROR_CODE__OK)
-			return;
+			return NULL;
 	} else {
 		/* Guard against caller using dirty buffer */
 		strbuf_setlen(params->buffer, 0);
@@ -2890,7 +2910,7 @@ static void do_req(const char *url_base,
 	gh__azure_throttle__zero(&gh__global_throttle[params->server_type]);
 
 	slot = get_active_slot();
-	slot->results = &results;
+	slot->results = results;
 
 	curl_easy_setopt(slot->curl, CURLOPT_NOBODY, 0); /* not a HEAD request */
 	curl_easy_setopt(slot->curl, CURLOPT_URL, rest_url.buf);
@@ -2935,7 +2955,26 @@ static void do_req(const char *url_base,
 		curl_easy_setopt(slot->curl, CURLOPT_NOPROGRESS, 1);
 	}
 
-	gh__run_one_slot(slot, params, status);
+	strbuf_release(&rest_url);
+	return slot;
+}
+
+/*
+ * Do a single HTTP request WITHOUT robust-retry, auth-retry or fallback.
+ */
+static void do_req(const char *url_base,
+		   const char *url_component,
+		   const struct credential *creds,
+		   struct gh__request_params *params,
+		   struct gh__response_status *status)
+{
+	struct active_request_slot *slot;
+	struct slot_results results;
+
+	slot = do_req__prepare_slot(url_base, url_component, creds,
+				    params, status, &results);
+	if (slot)
+		gh__run_one_slot(slot, params, status);
 }
 
 /*
@@ -3217,6 +3256,57 @@ static void do__http_get__gvfs_object(struct gh__response_status *status,
 	strbuf_release(&component_url);
 }
 
+/*
+ * Build the request for a "gvfs/objects" POST of the next (up to)
+ * `nr_wanted_in_block` objects from the OIDSET.
+ */
+static void setup_gvfs_objects_post(struct gh__request_params *params,
+				    struct json_writer *jw_req,
+				    struct oidset_iter *iter,
+				    unsigned long nr_wanted_in_block,
+				    int j_pack_num, int j_pack_den,
+				    struct string_list *result_list)
+{
+	params->object_count = build_json_payload__gvfs_objects(
+		jw_req, iter, nr_wanted_in_block, &params->loose_oid);
+
+	strbuf_addstr(&params->tr2_label, "POST/objects");
+
+	params->b_is_post = 1;
+	params->b_write_to_file = 1;
+	params->b_permit_cache_server_if_defined = 1;
+	params->objects_mode = GH__OBJECTS_MODE__POST;
+
+	params->post_payload = &jw_req->json;
+
+	params->result_list = result_list;
+
+	params->headers = http_copy_default_headers();
+	params->headers = curl_slist_append(params->headers,
+					    "X-TFS-FedAuthRedirect: Suppress");
+	params->headers = curl_slist_append(params->headers,
+					    "Pragma: no-cache");
+	params->headers = curl_slist_append(params->headers,
+					    "Content-Type: application/json");
+	/*
+	 * If our POST contains more than one object, we want the
+	 * server to send us a packfile.  We DO NOT want the non-standard
+	 * concatenated loose object format, so we DO NOT send:
+	 *     "Accept: application/x-git-loose-objects" (plural)
+	 *
+	 * However, if the payload only requests 1 OID, the server
+	 * will send us a single loose object instead of a packfile,
+	 * so we ACK that and send:
+	 *     "Accept: application/x-git-loose-object" (singular)
+	 */
+	params->headers = curl_slist_append(params->headers,
+					    "Accept: application/x-git-packfile");
+	params->headers = curl_slist_append(params->headers,
+					    "Accept: application/x-git-loose-object");
+
+	setup_gvfs_objects_progress(params, j_pack_num, j_pack_den);
+}
+
 /*
  * Call "gvfs/objects" POST REST API to fetch a batch of objects
  * from the OIDSET.  Normal, this is results in a packfile containing
@@ -3243,50 +3333,276 @@ static void do__http_post__gvfs_objects(struct gh__response_status *status,
 
 	gh__response_status__zero(status);
 
-	params.object_count = build_json_payload__gvfs_objects(
-		&jw_req, iter, nr_wanted_in_block, &params.loose_oid);
+	setup_gvfs_objects_post(&params, &jw_req, iter, nr_wanted_in_block,
+				j_pack_num, j_pack_den, result_list);
 	*nr_oid_taken = params.object_count;
 
-	strbuf_addstr(&params.tr2_label, "POST/objects");
+	do_req__with_fallback("gvfs/objects", &params, status);
 
-	params.b_is_post = 1;
-	params.b_write_to_file = 1;
-	params.b_permit_cache_server_if_defined = 1;
-	params.objects_mode = GH__OBJECTS_MODE__POST;
+	gh__request_params__release(&params);
+	jw_release(&jw_req);
+}
 
-	params.post_payload = &jw_req.json;
+/*
+ * State for one of the "gvfs/objects" POST requests that we run
+ * concurrently.
+ */
+struct gh__parallel_req {
+	struct gh__request_params params;
+	struct gh__response_status status;
+	struct json_writer jw_req;
+	struct slot_results results;
+	struct active_request_slot *slot; /* while in flight */
+	curl_off_t dlnow;
+	int b_done;
+	int b_handled;
+};
 
-	params.result_list = result_list;
+/*
+ * The "struct progress" API cannot show a meter for each of the
+ * concurrent requests, so we show a single meter counting completed
+ * requests with the throughput summed across all of them.
+ */
+static struct gh__parallel_progress {
+	struct progress *progress;
+	uint64_t bytes_received;
+	int nr_done;
+} gh__parallel_progress;
 
-	params.headers = http_copy_default_headers();
-	params.headers = curl_slist_append(params.headers,
-					   "X-TFS-FedAuthRedirect: Suppress");
-	params.headers = curl_slist_append(params.headers,
-					   "Pragma: no-cache");
-	params.headers = curl_slist_append(params.headers,
-					   "Content-Type: application/json");
-	/*
-	 * If our POST contains more than one object, we want the
-	 * server to send us a packfile.  We DO NOT want the non-standard
-	 * concatenated loose object format, so we DO NOT send:
-	 *     "Accept: application/x-git-loose-objects" (plural)
-	 *
-	 * However, if the payload only requests 1 OID, the server
-	 * will send us a single loose object instead of a packfile,
-	 * so we ACK that and send:
-	 *     "Accept: application/x-git-loose-object" (singular)
-	 */
-	params.headers = curl_slist_append(params.headers,
-					   "Accept: application/x-git-packfile");
-	params.headers = curl_slist_append(params.headers,
-					   "Accept: application/x-git-loose-object");
+static int gh__parallel_progress_cb(void *clientp,
+				    curl_off_t dltotal, curl_off_t dlnow,
+				    curl_off_t ultotal, curl_off_t ulnow)
+{
+	struct gh__parallel_req *req = clientp;
 
-	setup_gvfs_objects_progress(&params, j_pack_num, j_pack_den);
+	if (dlnow > req->dlnow) {
+		gh__parallel_progress.bytes_received += dlnow - req->dlnow;
+		req->dlnow = dlnow;
+		display_throughput(gh__parallel_progress.progress,
+				   gh__parallel_progress.bytes_received);
+	}
+	return 0;
+}
 
-	do_req__with_fallback("gvfs/objects", &params, status);
+/*
+ * Called by the http layer as soon as the request completes, while the
+ * curl handle still describes it (the slot may be reused for another
+ * request once we return).
+ */
+static void gh__parallel_req_finished(void *data)
+{
+	struct gh__parallel_req *req = data;
 
-	gh__request_params__release(&params);
-	jw_release(&jw_req);
+	fflush(req->params.tempfile->fp);
+	gh__response_status__set_from_slot(&req->params, &req->status,
+					   req->slot);
+	log_e2eid(&req->params, &req->status);
+
+	req->slot = NULL;
+	req->b_done = 1;
+
+	display_progress(gh__parallel_progress.progress,
+			 ++gh__parallel_progress.nr_done);
+}
+
+/*
+ * Start the first attempt of a request.  We do not do any retries,
+ * auth-retries, or fallback here; failed requests are resubmitted
+ * serially (with all of that) once the concurrent ones are drained.
+ */
+static void gh__parallel_req_start(struct gh__parallel_req *req)
+{
+	struct active_request_slot *slot;
+	const char *url_base;
+	const struct credential *creds;
+
+	if (gh__global.cache_server_url &&
+	    req->params.b_permit_cache_server_if_defined) {
+		req->params.server_type = GH__SERVER_TYPE__CACHE;
+		synthesize_cache_server_creds();
+		url_base = gh__global.cache_server_url;
+		creds = &gh__global.cache_creds;
+	} else {
+		req->params.server_type = GH__SERVER_TYPE__MAIN;
+		url_base = gh__global.main_url;
+		creds = &gh__global.main_creds;
+	}
+
+	slot = do_req__prepare_slot(url_base, "gvfs/objects", creds,
+				    &req->params, &req->status,
+				    &req->results);
+	if (!slot) {
+		req->status.retry = GH__RETRY_MODE__HARD_FAIL;
+		req->b_done = 1;
+		return;
+	}
+
+	curl_easy_setopt(slot->curl, CURLOPT_XFERINFOFUNCTION,
+			 gh__parallel_progress_cb);
+	curl_easy_setopt(slot->curl, CURLOPT_XFERINFODATA, req);
+	curl_easy_setopt(slot->curl, CURLOPT_NOPROGRESS, 0);
+
+	slot->callback_func = gh__parallel_req_finished;
+	slot->callback_data = req;
+	req->slot = slot;
+
+	if (!start_active_slot(slot)) {
+		compute_retry_mode_from_curl_error(&req->status,
+						   CURLE_FAILED_INIT);
+		req->slot = NULL;
+		req->b_done = 1;
+	}
+}
+
+/*
+ * Like do__http_post__fetch_oidset(), but keep up to
+ * `gh__cmd_opts.max_parallel` POST requests in flight at once.
+ * (With "http.version=HTTP/2", the http layer multiplexes them over
+ * a single connection.)
+ *
+ * The packfiles are installed in the order that the requests complete.
+ * A request that fails is retried serially, using the normal robust
+ * retry and fallback machinery, after all of the others finish.
+ */
+static void do__http_post__fetch_oidset_parallel(
+	struct gh__response_status *status,
+	struct oidset *oids,
+	unsigned long nr_oid_total,
+	struct string_list *result_list)
+{
+	struct gh__parallel_req *reqs;
+	struct oidset_iter iter;
+	struct strbuf err404 = STRBUF_INIT;
+	unsigned long k;
+	int nr_reqs = 0, nr_started = 0, nr_in_flight = 0, nr_retried = 0;
+	int j, j_oldest = 0;
+	int had_404 = 0;
+
+	gh__response_status__zero(status);
+
+	oidset_iter_init(oids, &iter);
+
+	nr_reqs = ((nr_oid_total + gh__cmd_opts.block_size - 1)
+		   / gh__cmd_opts.block_size);
+	CALLOC_ARRAY(reqs, nr_reqs);
+
+	for (j = 0, k = 0; k < nr_oid_total; j++) {
+		struct gh__request_params params = GH__REQUEST_PARAMS_INIT;
+		struct gh__response_status rs = GH__RESPONSE_STATUS_INIT;
+		struct json_writer jw = JSON_WRITER_INIT;
+
+		if (j == nr_reqs)
+			BUG("more blocks than expected in oidset");
+
+		reqs[j].params = params;
+		reqs[j].status = rs;
+		reqs[j].jw_req = jw;
+		setup_gvfs_objects_post(&reqs[j].params, &reqs[j].jw_req,
+					&iter, gh__cmd_opts.block_size,
+					j + 1, nr_reqs, result_list);
+		k += reqs[j].params.object_count;
+	}
+	nr_reqs = j;
+
+	trace2_region_enter(TR2_CAT, "POST/objects/parallel", NULL);
+
+	memset(&gh__parallel_progress, 0, sizeof(gh__parallel_progress));
+	if (gh__cmd_opts.show_progress)
+		gh__parallel_progress.progress =
+			start_progress("Receiving packfiles", nr_reqs);
+
+	while (nr_started < nr_reqs || nr_in_flight) {
+		while (nr_started < nr_reqs &&
+		       nr_in_flight < gh__cmd_opts.max_parallel) {
+			gh__parallel_req_start(&reqs[nr_started++]);
+			nr_in_flight++;
+		}
+
+		/*
+		 * Drive all of the transfers until the oldest one that is
+		 * still running completes.
+		 */
+		while (j_oldest < nr_started && reqs[j_oldest].b_done)
+			j_oldest++;
+		if (j_oldest < nr_started)
+			run_active_slot(reqs[j_oldest].slot);
+
+		for (j = 0; j < nr_started; j++) {
+			struct gh__parallel_req *req = &reqs[j];
+
+			if (!req->b_done || req->b_handled)
+				continue;
+			req->b_handled = 1;
+			nr_in_flight--;
+
+			if (req->status.retry != GH__RETRY_MODE__SUCCESS)
+				continue;
+
+			/*
+			 * Only approve the creds of the server that answered.
+			 * A cache-server accepting the synthesized creds does
+			 * not tell us that the main Git server would.
+			 */
+			if (req->params.server_type == GH__SERVER_TYPE__MAIN)
+				approve_main_creds();
+			install_result(&req->params, &req->status);
+		}
+	}
+
+	stop_progress(&gh__parallel_progress.progress);
+
+	for (j = 0; j < nr_reqs; j++) {
+		struct gh__parallel_req *req = &reqs[j];
+
+		if (req->status.retry != GH__RETRY_MODE__SUCCESS &&
+		    req->status.retry != GH__RETRY_MODE__FAIL_404) {
+			do_req__with_fallback("gvfs/objects", &req->params,
+					      &req->status);
+			nr_retried++;
+		}
+
+		/* Same error handling as do__http_post__fetch_oidset(). */
+		if (req->status.ec == GH__ERROR_CODE__HTTP_404) {
+			if (!err404.len)
+				strbuf_addf(&err404,
+					    "%s: from POST",
+					    req->status.error_message.buf);
+			had_404 = 1;
+			continue;
+		}
+
+		if (req->status.ec != GH__ERROR_CODE__OK) {
+			/* Stop at the first hard error. */
+			strbuf_addbuf(&status->error_message,
+				      &req->status.error_message);
+			strbuf_addstr(&status->error_message,
+				      ": from POST");
+			status->ec = req->status.ec;
+			status->retry = req->status.retry;
+			break;
+		}
+	}
+
+	if (had_404 && status->ec == GH__ERROR_CODE__OK) {
+		strbuf_addbuf(&status->error_message, &err404);
+		status->ec = GH__ERROR_CODE__HTTP_404;
+	}
+
+	trace2_data_intmax(TR2_CAT, NULL, "POST/objects/parallel/nr_requests",
+			   nr_reqs);
+	trace2_data_intmax(TR2_CAT, NULL, "POST/objects/parallel/nr_retried",
+			   nr_retried);
+	trace2_data_intmax(TR2_CAT, NULL, "POST/objects/parallel/nr_bytes",
+			   gh__parallel_progress.bytes_received);
+	trace2_region_leave(TR2_CAT, "POST/objects/parallel", NULL);
+
+	for (j = 0; j < nr_reqs; j++) {
+		gh__request_params__release(&reqs[j].params);
+		gh__response_status__release(&reqs[j].status);
+		jw_release(&reqs[j].jw_req);
+	}
+	free(reqs);
+	strbuf_release(&err404);
 }
 
 struct find_last_data {
@@ -3498,6 +3814,13 @@ static void do__http_post__fetch_oidset(struct gh__response_status *status,
 	if (!nr_oid_total)
 		return;
 
+	if (gh__cmd_opts.max_parallel > 1 &&
+	    nr_oid_total > gh__cmd_opts.block_size) {
+		do__http_post__fetch_oidset_parallel(status, oids, nr_oid_total,
+						     result_list);
+		return;
+	}
+
 	oidset_iter_init(oids, &iter);
 
 	j_pack_den = ((nr_oid_total + gh__cmd_opts.block_size - 1)
@@ -3691,6 +4014,8 @@ static enum gh__error_code do_sub_cmd__post(int argc, const char **argv)
 	static struct option post_options[] = {
 		OPT_MAGNITUDE('b', "block-size", &gh__cmd_opts.block_size,
 			      N_("number of objects to request at a time")),
+		OPT_INTEGER(0, "max-parallel", &gh__cmd_opts.max_parallel,
+			    N_("number of concurrent POST requests")),
 		OPT_INTEGER('d', "depth", &gh__cmd_opts.depth,
 			    N_("Commit depth")),
 		OPT_INTEGER('r', "max-retries", &gh__cmd_opts.max_retries,
@@ -4055,6 +4380,8 @@ static enum gh__error_code do_sub_cmd__server(int argc, const char **argv)
 	static struct option server_options[] = {
 		OPT_MAGNITUDE('b', "block-size", &gh__cmd_opts.block_size,
 			      N_("number of objects to request at a time")),
+		OPT_INTEGER(0, "max-parallel", &gh__cmd_opts.max_parallel,
+			    N_("number of concurrent POST requests")),
 		OPT_INTEGER('d', "depth", &gh__cmd_opts.depth,
 			    N_("Commit depth")),
 		OPT_INTEGER('r', "max-retries", &gh__cmd_opts.max_retries,
@@ -4140,6 +4467,16 @@ static enum gh__error_code do_sub_cmd(int argc, const char **argv)
 	return GH__ERROR_CODE__USAGE;
 }
 
+static int gh__config(const char *var, const char *value, void *cb)
+{
+	if (!strcmp(var, "gvfs.maxparallelrequests")) {
+		gh__cmd_opts.max_parallel = git_config_int(var, value);
+		return 0;
+	}
+
+	return git_default_config(var, value, cb);
+}
+
 /*
  * Communicate with the primary Git server or a GVFS cache-server using the
  * GVFS Protocol.
@@ -4180,6 +4517,7 @@ int cmd_main(int argc, const char **argv)
 	/* Set any non-zero initial values in gh__cmd_opts. */
 	gh__cmd_opts.depth = GH__DEFAULT__OBJECTS_POST__COMMIT_DEPTH;
 	gh__cmd_opts.block_size = GH__DEFAULT__OBJECTS_POST__BLOCK_SIZE;
+	gh__cmd_opts.max_parallel = GH__DEFAULT__OBJECTS_POST__MAX_PARALLEL;
 	gh__cmd_opts.max_retries = GH__DEFAULT_MAX_RETRIES;
 	gh__cmd_opts.max_transient_backoff_sec =
 		GH__DEFAULT_MAX_TRANSIENT_BACKOFF_SEC;
@@ -4192,7 +4530,7 @@ int cmd_main(int argc, const char **argv)
 	// TODO
 	// TODO See "scalar.max-retries" (and maybe "gvfs.max-retries")
 
-	git_config(git_default_config, NULL);
+	git_config(gh__config, NULL);
 
 	argc = parse_options(argc, argv, NULL, main_options, main_usage,
 			     PARSE_OPT_STOP_AT_NON_OPTION);
@@ -62,7 +62,8 @@ static void fetch_single_packfile(struct object_id *packfile_hash,
 
 	if (start_active_slot(preq->slot)) {
 		run_active_slot(preq->slot);
-		if (results.curl_result != CURLE_OK) {
+		if (results.curl_result != CURLE_OK &&
+		    !http_pack_request_is_complete(preq, results.http_code)) {
 			die("Unable to get pack file %s\n%s", preq->url,
 			    curl_errorstr);
 		}
@@ -585,17 +585,16 @@ static void finish_request(struct transfer_request *request)
 
 	} else if (request->state == RUN_FETCH_PACKED) {
 		int fail = 1;
-		if (request->curl_result != CURLE_OK) {
+		preq = (struct http_pack_request *)request->userData;
+		if (request->curl_result != CURLE_OK &&
+		    !(preq && http_pack_request_is_complete(preq,
+							     request->http_code))) {
 			fprintf(stderr, "Unable to get pack file %s\n%s",
 				request->url, curl_errorstr);
-		} else {
-			preq = (struct http_pack_request *)request->userData;
-
-			if (preq) {
-				if (finish_http_pack_request(preq) == 0)
-					fail = 0;
-				release_http_pack_request(preq);
-			}
+		} else if (preq) {
+			if (finish_http_pack_request(preq) == 0)
+				fail = 0;
+			release_http_pack_request(preq);
 		}
 		if (fail)
 			repo->can_update_info_refs = 0;
@@ -455,7 +455,8 @@ static int http_fetch_pack(struct walker *walker, struct alt_base *repo, unsigne
 
 	if (start_active_slot(preq->slot)) {
 		run_active_slot(preq->slot);
-		if (results.curl_result != CURLE_OK) {
+		if (results.curl_result != CURLE_OK &&
+		    !http_pack_request_is_complete(preq, results.http_code)) {
 			error("Unable to get pack file %s\n%s", preq->url,
 			      curl_errorstr);
 			goto abort;
@@ -900,6 +900,15 @@ static CURL *get_curl_handle(void)
 		if (!get_curl_http_version_opt(curl_http_version, &opt)) {
 			/* Set request use http version */
 			curl_easy_setopt(result, CURLOPT_HTTP_VERSION, opt);
+#if LIBCURL_VERSION_NUM >= 0x072b00 // 7.43.0
+			/*
+			 * Have concurrent requests wait for an existing
+			 * HTTP/2 connection to multiplex them over, rather
+			 * than each opening a new connection.
+			 */
+			if (opt == CURL_HTTP_VERSION_2)
+				curl_easy_setopt(result, CURLOPT_PIPEWAIT, 1L);
+#endif
 		}
     }
 #endif
@@ -1210,6 +1219,9 @@ void http_init(struct remote *remote, const char *url, int proactive_auth)
 	curlm = curl_multi_init();
 	if (!curlm)
 		die("curl_multi_init failed");
+#if LIBCURL_VERSION_NUM >= 0x072b00
+	curl_multi_setopt(curlm, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
 #endif
 
 	if (getenv("GIT_SSL_NO_VERIFY"))
@@ -2363,6 +2375,110 @@ struct http_pack_request *new_http_pack_request(
 					    strbuf_detach(&buf, NULL));
 }
 
+/*
+ * Returns 1 if the data kept from an interrupted transfer starts with a
+ * pack header we can resume after, 0 otherwise.
+ */
+static int partial_pack_is_resumable(FILE *packfile, off_t size)
+{
+	struct pack_header hdr;
+	int ret = 0;
+
+	if (size < sizeof(hdr))
+		return 0;
+	if (fseeko(packfile, 0, SEEK_SET))
+		return 0;
+	if (fread(&hdr, sizeof(hdr), 1, packfile) == 1 &&
+	    hdr.hdr_signature == htonl(PACK_SIGNATURE) &&
+	    pack_version_ok(hdr.hdr_version))
+		ret = 1;
+	fseeko(packfile, 0, SEEK_END);
+	return ret;
+}
+
+/*
+ * Returns 1 if "packfile" holds a whole pack, i.e. its trailer is the
+ * checksum of the rest of it.
+ */
+static int pack_file_is_complete(FILE *packfile)
+{
+	const size_t hashsz = the_hash_algo->rawsz;
+	unsigned char buf[8192];
+	unsigned char hash[GIT_MAX_RAWSZ], trailer[GIT_MAX_RAWSZ];
+	git_hash_ctx ctx;
+	off_t size, left;
+	int ret = 0;
+
+	if (fflush(packfile) || fseeko(packfile, 0, SEEK_END))
+		return 0;
+	size = ftello(packfile);
+	if (size < sizeof(struct pack_header) + hashsz ||
+	    !partial_pack_is_resumable(packfile, size) ||
+	    fseeko(packfile, 0, SEEK_SET))
+		return 0;
+
+	the_hash_algo->init_fn(&ctx);
+	for (left = size - hashsz; left > 0; ) {
+		size_t n = left < sizeof(buf) ? left : sizeof(buf);
+
+		if (fread(buf, 1, n, packfile) != n)
+			goto out;
+		the_hash_algo->update_fn(&ctx, buf, n);
+		left -= n;
+	}
+	if (fread(trailer, 1, hashsz, packfile) != hashsz)
+		goto out;
+	the_hash_algo->final_fn(hash, &ctx);
+	ret = hasheq(hash, trailer);
+out:
+	fseeko(packfile, 0, SEEK_END);
+	return ret;
+}
+
+int http_pack_request_is_complete(struct http_pack_request *preq,
+				  long http_code)
+{
+	if (http_code != 416 || !preq->resume_posn || !preq->packfile)
+		return 0;
+	if (!pack_file_is_complete(preq->packfile))
+		return 0;
+	if (http_is_verbose)
+		fprintf(stderr, "Pack %s was already complete\n", preq->url);
+	return 1;
+}
+
+/*
+ * A server may ignore our range request and send the whole pack again
+ * (with a "200 OK" instead of "206 Partial Content"). In that case,
+ * throw away what we kept, instead of appending a second copy to it.
+ */
+static size_t fwrite_pack_request(char *ptr, size_t eltsize, size_t nmemb,
+				  void *data)
+{
+	struct http_pack_request *preq = data;
+
+	if (preq->resume_posn && !preq->range_checked) {
+		long http_code = 0;
+
+		curl_easy_getinfo(preq->slot->curl, CURLINFO_RESPONSE_CODE,
+				  &http_code);
+		if (http_code != 206) {
+			if (http_is_verbose)
+				fprintf(stderr,
+					"Server ignored resume request for %s; "
+					"starting over\n", preq->url);
+			fflush(preq->packfile);
+			if (ftruncate(fileno(preq->packfile), 0) ||
+			    fseeko(preq->packfile, 0, SEEK_SET))
+				return 0; /* makes curl fail the transfer */
+			preq->resume_posn = 0;
+		}
+		preq->range_checked = 1;
+	}
+
+	return fwrite(ptr, eltsize, nmemb, preq->packfile);
+}
+
 struct http_pack_request *new_direct_http_pack_request(
 	const unsigned char *packed_git_hash, char *url)
 {
@@ -2375,25 +2491,40 @@ struct http_pack_request *new_direct_http_pack_request(
 	preq->url = url;
 
 	strbuf_addf(&preq->tmpfile, "%s.temp", sha1_pack_name(packed_git_hash));
-	preq->packfile = fopen(preq->tmpfile.buf, "a");
+	preq->packfile = fopen(preq->tmpfile.buf, "a+");
 	if (!preq->packfile) {
 		error("Unable to open local file %s for pack",
 		      preq->tmpfile.buf);
 		goto abort;
 	}
 
+	/*
+	 * If there is data present from a previous transfer attempt,
+	 * resume where it left off, unless it is not a pack at all
+	 * (e.g. an error page that was saved in its place).
+	 */
+	fseeko(preq->packfile, 0, SEEK_END);
+	prev_posn = ftello(preq->packfile);
+	if (prev_posn > 0 &&
+	    !partial_pack_is_resumable(preq->packfile, prev_posn)) {
+		fclose(preq->packfile);
+		preq->packfile = fopen(preq->tmpfile.buf, "w+");
+		if (!preq->packfile) {
+			error("Unable to open local file %s for pack",
+			      preq->tmpfile.buf);
+			goto abort;
+		}
+		prev_posn = 0;
+	}
+
 	preq->slot = get_active_slot();
-	curl_easy_setopt(preq->slot->curl, CURLOPT_FILE, preq->packfile);
-	curl_easy_setopt(preq->slot->curl, CURLOPT_WRITEFUNCTION, fwrite);
+	curl_easy_setopt(preq->slot->curl, CURLOPT_FILE, preq);
+	curl_easy_setopt(preq->slot->curl, CURLOPT_WRITEFUNCTION,
+			 fwrite_pack_request);
 	curl_easy_setopt(preq->slot->curl, CURLOPT_URL, preq->url);
 	curl_easy_setopt(preq->slot->curl, CURLOPT_HTTPHEADER,
 		no_pragma_header);
 
-	/*
-	 * If there is data present from a previous transfer attempt,
-	 * resume where it left off
-	 */
-	prev_posn = ftello(preq->packfile);
 	if (prev_posn>0) {
 		if (http_is_verbose)
 			fprintf(stderr,
@@ -2401,6 +2532,9 @@ struct http_pack_request *new_direct_http_pack_request(
 				hash_to_hex(packed_git_hash),
 				(uintmax_t)prev_posn);
 		http_opt_request_remainder(preq->slot->curl, prev_posn);
+		preq->resume_posn = prev_posn;
+		trace2_data_intmax("http", the_repository, "pack/resume_offset",
+				   prev_posn);
 	}
 
 	return preq;
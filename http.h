@@ -228,6 +228,13 @@ struct http_pack_request {
 	FILE *packfile;
 	struct strbuf tmpfile;
 	struct active_request_slot *slot;
+
+	/*
+	 * Number of bytes kept from a previous, interrupted transfer of
+	 * this pack; the request asks only for the rest.
+	 */
+	off_t resume_posn;
+	unsigned range_checked : 1;
 };
 
 struct http_pack_request *new_http_pack_request(
@@ -237,6 +244,15 @@ struct http_pack_request *new_direct_http_pack_request(
 int finish_http_pack_request(struct http_pack_request *preq);
 void release_http_pack_request(struct http_pack_request *preq);
 
+/*
+ * Returns 1 if "preq" failed with "http_code" only because the server
+ * had nothing left to send after the data kept from an earlier transfer
+ * ("416 Range Not Satisfiable"), and that data is the whole pack; it can
+ * then be finished like a successful request.
+ */
+int http_pack_request_is_complete(struct http_pack_request *preq,
+				  long http_code);
+
 /*
  * Remove p from the given list, and invoke install_packed_git() on it.
  *
@@ -510,6 +510,25 @@ static void fill_blob_sha1(struct repository *r, struct commit *commit,
 	return;
 }
 
+/*
+ * The line ends of a blob are needed both to map the ranges across a
+ * diff and to show that diff, and the preimage of one commit's diff is
+ * usually the postimage of the next one shown.  Remember them for the
+ * last few blobs instead of scanning the same blob again.
+ */
+#define LINE_ENDS_CACHE_SIZE 8
+
+static struct line_ends_cache_entry {
+	struct object_id oid;
+	long lines;
+	unsigned long *ends;
+} line_ends_cache[LINE_ENDS_CACHE_SIZE];
+static unsigned int line_ends_cache_next;
+
+/*
+ * The array stored in "line_ends" belongs to the cache; it stays valid
+ * until LINE_ENDS_CACHE_SIZE other blobs have been looked up.
+ */
 static void fill_line_ends(struct repository *r,
 			   struct diff_filespec *spec,
 			   long *lines,
@@ -519,10 +538,22 @@ static void fill_line_ends(struct repository *r,
 	long cur = 0;
 	unsigned long *ends = NULL;
 	char *data = NULL;
+	struct line_ends_cache_entry *e;
+	int i;
 
 	if (diff_populate_filespec(r, spec, NULL))
 		die("Cannot read blob %s", oid_to_hex(&spec->oid));
 
+	assert(spec->oid_valid);
+	for (i = 0; i < LINE_ENDS_CACHE_SIZE; i++) {
+		e = &line_ends_cache[i];
+		if (e->ends && oideq(&e->oid, &spec->oid)) {
+			*lines = e->lines;
+			*line_ends = e->ends;
+			return;
+		}
+	}
+
 	ALLOC_ARRAY(ends, size);
 	ends[cur++] = 0;
 	data = spec->data;
@@ -536,8 +567,16 @@ static void fill_line_ends(struct repository *r,
 
 	/* shrink the array to fit the elements */
 	REALLOC_ARRAY(ends, cur);
-	*lines = cur-1;
-	*line_ends = ends;
+
+	e = &line_ends_cache[line_ends_cache_next];
+	line_ends_cache_next = (line_ends_cache_next + 1) % LINE_ENDS_CACHE_SIZE;
+	free(e->ends);
+	oidcpy(&e->oid, &spec->oid);
+	e->lines = cur-1;
+	e->ends = ends;
+
+	*lines = e->lines;
+	*line_ends = e->ends;
 }
 
 struct nth_line_cb {
@@ -613,7 +652,6 @@ parse_lines(struct repository *r, struct commit *commit,
 		line_log_data_insert(&ranges, full_name, begin, end);
 
 		free_filespec(spec);
-		FREE_AND_NULL(ends);
 	}
 
 	for (p = ranges; p; p = p->next)
@@ -1000,9 +1038,6 @@ static void dump_diff_hacky_one(struct rev_info *rev, struct line_log_data *rang
 			print_line(prefix, ' ', t_cur, t_ends, pair->two->data,
 				   c_context, c_reset, opt->file);
 	}
-
-	free(p_ends);
-	free(t_ends);
 }
 
 /*
@@ -1018,6 +1053,118 @@ static void dump_diff_hacky(struct rev_info *rev, struct line_log_data *range)
 	}
 }
 
+static long count_lines(const char *buf, long len)
+{
+	long nr = 0, i;
+
+	for (i = 0; i < len; i++)
+		if (buf[i] == '\n')
+			nr++;
+	if (len && buf[len - 1] != '\n')
+		nr++;
+	return nr;
+}
+
+/* Is "line" (including its newline) one of the lines in "buf"? */
+static int has_line(const char *buf, long len, const char *line, long line_len)
+{
+	const char *p = buf, *end = buf + len;
+
+	while (p < end) {
+		const char *next = memchr(p, '\n', end - p);
+		next = next ? next + 1 : end;
+		if (next - p == line_len && !memcmp(p, line, line_len))
+			return 1;
+		p = next;
+	}
+	return 0;
+}
+
+/*
+ * Map the ranges in "rs" from "target" to "parent" without running
+ * xdiff, when the lines that differ between the two cannot belong to
+ * any hunk that touches one of the ranges.  The differing lines are
+ * those between the longest common prefix and suffix of whole lines;
+ * a hunk only ever leaves that middle part by sliding over a run of
+ * identical lines (see xdl_change_compact()), which it cannot do if
+ * neither the line just above nor the one just below it occurs there.
+ *
+ * Returns 1 and fills "out" if the ranges are all outside of the
+ * middle part, and 0 if the diff needs to be computed.
+ */
+static int map_ranges_around_change(struct range_set *out,
+				    struct range_set *rs,
+				    mmfile_t *parent, mmfile_t *target)
+{
+	const char *a = parent->ptr, *b = target->ptr;
+	long a_size = parent->size, b_size = target->size;
+	long n = a_size < b_size ? a_size : b_size;
+	long prefix = 0, prefix_lines = 0, suffix = 0, i;
+	long a_mid, b_mid, mid_start, mid_end;
+	int above = 0, below = 0;
+
+	for (i = 0; i < n && a[i] == b[i]; i++)
+		if (a[i] == '\n') {
+			prefix = i + 1;
+			prefix_lines++;
+		}
+
+	while (suffix < n - prefix &&
+	       a[a_size - suffix - 1] == b[b_size - suffix - 1])
+		suffix++;
+	/* the common suffix must begin at a line boundary in both */
+	if (suffix &&
+	    ((a_size - suffix && a[a_size - suffix - 1] != '\n') ||
+	     (b_size - suffix && b[b_size - suffix - 1] != '\n'))) {
+		while (suffix && b[b_size - suffix] != '\n')
+			suffix--;
+		if (suffix)
+			suffix--;
+	}
+
+	a_mid = count_lines(a + prefix, a_size - suffix - prefix);
+	b_mid = count_lines(b + prefix, b_size - suffix - prefix);
+	mid_start = prefix_lines;
+	mid_end = prefix_lines + b_mid;
+
+	for (i = 0; i < rs->nr; i++) {
+		if (rs->ranges[i].end <= mid_start)
+			above = 1;
+		else if (rs->ranges[i].start >= mid_end)
+			below = 1;
+		else
+			return 0;
+	}
+
+	if (above && prefix) {
+		const char *line = b + prefix - 1;
+		while (line > b && line[-1] != '\n')
+			line--;
+		if (has_line(a + prefix, a_size - suffix - prefix,
+			     line, b + prefix - line) ||
+		    has_line(b + prefix, b_size - suffix - prefix,
+			     line, b + prefix - line))
+			return 0;
+	}
+	if (below && suffix) {
+		const char *line = b + b_size - suffix;
+		const char *eol = memchr(line, '\n', suffix);
+		long len = eol ? eol - line + 1 : suffix;
+		if (has_line(a + prefix, a_size - suffix - prefix, line, len) ||
+		    has_line(b + prefix, b_size - suffix - prefix, line, len))
+			return 0;
+	}
+
+	for (i = 0; i < rs->nr; i++) {
+		long shift = rs->ranges[i].start >= mid_end ? a_mid - b_mid : 0;
+		range_set_append(out, rs->ranges[i].start + shift,
+				 rs->ranges[i].end + shift);
+	}
+	/* ranges on both sides of a deletion now meet */
+	sort_and_merge_range_set(out);
+	return 1;
+}
+
 /*
  * Unlike most other functions, this destructively operates on
  * 'range'.
@@ -1059,15 +1206,22 @@ static int process_diff_filepair(struct rev_info *rev,
 		file_parent.size = 0;
 	}
 
-	diff_ranges_init(&diff);
-	if (collect_diff(&file_parent, &file_target, &diff))
-		die("unable to generate diff for %s", pair->one->path);
-
 	/* NEEDSWORK should apply some heuristics to prevent mismatches */
 	free(rg->path);
 	rg->path = xstrdup(pair->one->path);
 
 	range_set_init(&tmp, 0);
+	if (map_ranges_around_change(&tmp, &rg->ranges,
+				     &file_parent, &file_target)) {
+		range_set_release(&rg->ranges);
+		range_set_move(&rg->ranges, &tmp);
+		return 0;
+	}
+
+	diff_ranges_init(&diff);
+	if (collect_diff(&file_parent, &file_target, &diff))
+		die("unable to generate diff for %s", pair->one->path);
+
 	range_set_map_across_diff(&tmp, &rg->ranges, &diff, diff_out);
 	range_set_release(&rg->ranges);
 	range_set_move(&rg->ranges, &tmp);
@@ -1147,8 +1301,13 @@ int line_log_print(struct rev_info *rev, struct commit *commit)
 	return 1;
 }
 
+/*
+ * Returns 0 if the changed-path Bloom filter of "commit" against its
+ * nth parent (counting from 0) says that none of the paths in "range"
+ * differ between them, and 1 if they may.
+ */
 static int bloom_filter_check(struct rev_info *rev,
-			      struct commit *commit,
+			      struct commit *commit, int nth_parent,
 			      struct line_log_data *range)
 {
 	struct bloom_filter *filter;
@@ -1159,7 +1318,7 @@ static int bloom_filter_check(struct rev_info *rev,
 		return 1;
 
 	if (!rev->bloom_filter_settings ||
-	    !(filter = get_bloom_filter(rev->repo, commit)))
+	    !(filter = get_parent_bloom_filter(rev->repo, commit, nth_parent)))
 		return 1;
 
 	if (!range)
@@ -1211,7 +1370,7 @@ static int process_ranges_merge_commit(struct rev_info *rev, struct commit *comm
 	if (nparents > 1 && rev->first_parent_only)
 		nparents = 1;
 
-	ALLOC_ARRAY(diffqueues, nparents);
+	CALLOC_ARRAY(diffqueues, nparents);
 	ALLOC_ARRAY(cand, nparents);
 	ALLOC_ARRAY(parents, nparents);
 
@@ -1219,13 +1378,25 @@ static int process_ranges_merge_commit(struct rev_info *rev, struct commit *comm
 	for (i = 0; i < nparents; i++) {
 		parents[i] = p->item;
 		p = p->next;
-		queue_diffs(range, &rev->diffopt, &diffqueues[i], commit, parents[i]);
+		cand[i] = NULL;
 	}
 
 	for (i = 0; i < nparents; i++) {
 		int changed;
-		cand[i] = NULL;
-		changed = process_all_files(&cand[i], rev, &diffqueues[i], range);
+
+		/*
+		 * Our caller already asked the Bloom filter about the
+		 * first parent.
+		 */
+		if (i && !bloom_filter_check(rev, commit, i, range)) {
+			cand[i] = line_log_data_copy(range);
+			changed = 0;
+		} else {
+			queue_diffs(range, &rev->diffopt, &diffqueues[i],
+				    commit, parents[i]);
+			changed = process_all_files(&cand[i], rev,
+						    &diffqueues[i], range);
+		}
 		if (!changed) {
 			/*
 			 * This parent can take all the blame, so we
@@ -1266,7 +1437,7 @@ int line_log_process_ranges_arbitrary_commit(struct rev_info *rev, struct commit
 	int changed = 0;
 
 	if (range) {
-		if (commit->parents && !bloom_filter_check(rev, commit, range)) {
+		if (commit->parents && !bloom_filter_check(rev, commit, 0, range)) {
 			struct line_log_data *prange = line_log_data_copy(range);
 			add_line_range(rev, commit->parents->item, prange);
 			clear_commit_line_range(rev, commit);
@@ -616,6 +616,11 @@ static void lazy_init_name_hash(struct index_state *istate)
  * Requesting threading WILL NOT override guards
  * in lookup_lazy_params().
  */
+void prepare_name_hash(struct index_state *istate)
+{
+	lazy_init_name_hash(istate);
+}
+
 int test_lazy_init_name_hash(struct index_state *istate, int try_threaded)
 {
 	lazy_nr_dir_threads = 0;
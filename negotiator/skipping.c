@@ -1,6 +1,7 @@
 #include "cache.h"
 #include "skipping.h"
 #include "../commit.h"
+#include "../commit-slab.h"
 #include "../fetch-negotiator.h"
 #include "../prio-queue.h"
 #include "../refs.h"
@@ -41,9 +42,21 @@ struct entry {
 	uint16_t ttl;
 };
 
+define_commit_slab(entry_slab, struct entry *);
+
 struct data {
 	struct prio_queue rev_list;
 
+	/* Lookup from a queued commit to its entry. */
+	struct entry_slab entries;
+
+	/*
+	 * Whether rev_list is ordered by generation number (falling back
+	 * to commit date), so that a commit is only popped once all of its
+	 * queued descendants have been, even with clock skew.
+	 */
+	int by_generation;
+
 	/*
 	 * The number of non-COMMON commits in rev_list.
 	 */
@@ -57,13 +70,24 @@ static int compare(const void *a_, const void *b_, void *unused)
 	return compare_commits_by_commit_date(a->commit, b->commit, NULL);
 }
 
+static int compare_by_generation(const void *a_, const void *b_, void *unused)
+{
+	const struct entry *a = a_;
+	const struct entry *b = b_;
+	return compare_commits_by_gen_then_commit_date(a->commit, b->commit,
+						       NULL);
+}
+
 static struct entry *rev_list_push(struct data *data, struct commit *commit, int mark)
 {
 	struct entry *entry;
 	commit->object.flags |= mark | SEEN;
+	if (data->by_generation)
+		parse_commit(commit);
 
 	CALLOC_ARRAY(entry, 1);
 	entry->commit = commit;
+	*entry_slab_at(&data->entries, commit) = entry;
 	prio_queue_put(&data->rev_list, entry);
 
 	if (!(mark & COMMON))
@@ -116,7 +140,6 @@ static int push_parent(struct data *data, struct entry *entry,
 	struct entry *parent_entry;
 
 	if (to_push->object.flags & SEEN) {
-		int i;
 		if (to_push->object.flags & POPPED)
 			/*
 			 * The entry for this commit has already been popped,
@@ -127,14 +150,9 @@ static int push_parent(struct data *data, struct entry *entry,
 		/*
 		 * Find the existing entry and use it.
 		 */
-		for (i = 0; i < data->rev_list.nr; i++) {
-			parent_entry = data->rev_list.array[i].data;
-			if (parent_entry->commit == to_push)
-				goto parent_found;
-		}
-		BUG("missing parent in priority queue");
-parent_found:
-		;
+		parent_entry = *entry_slab_at(&data->entries, to_push);
+		if (!parent_entry)
+			BUG("missing parent in priority queue");
 	} else {
 		parent_entry = rev_list_push(data, to_push, 0);
 	}
@@ -189,6 +207,7 @@ static const struct object_id *get_rev(struct data *data)
 			 */
 			to_send = commit;
 
+		*entry_slab_at(&data->entries, commit) = NULL;
 		free(entry);
 	}
 
@@ -229,11 +248,17 @@ static int ack(struct fetch_negotiator *n, struct commit *c)
 
 static void release(struct fetch_negotiator *n)
 {
-	clear_prio_queue(&((struct data *)n->data)->rev_list);
+	struct data *data = n->data;
+	struct entry *entry;
+
+	while ((entry = prio_queue_get(&data->rev_list)))
+		free(entry);
+	clear_prio_queue(&data->rev_list);
+	clear_entry_slab(&data->entries);
 	FREE_AND_NULL(n->data);
 }
 
-void skipping_negotiator_init(struct fetch_negotiator *negotiator)
+static void init(struct fetch_negotiator *negotiator, int by_generation)
 {
 	struct data *data;
 	negotiator->known_common = known_common;
@@ -242,9 +267,21 @@ void skipping_negotiator_init(struct fetch_negotiator *negotiator)
 	negotiator->ack = ack;
 	negotiator->release = release;
 	negotiator->data = CALLOC_ARRAY(data, 1);
-	data->rev_list.compare = compare;
+	data->by_generation = by_generation;
+	data->rev_list.compare = by_generation ? compare_by_generation : compare;
+	init_entry_slab(&data->entries);
 
 	if (marked)
 		for_each_ref(clear_marks, NULL);
 	marked = 1;
 }
+
+void skipping_negotiator_init(struct fetch_negotiator *negotiator)
+{
+	init(negotiator, 0);
+}
+
+void generation_negotiator_init(struct fetch_negotiator *negotiator)
+{
+	init(negotiator, 1);
+}
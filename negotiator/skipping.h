@@ -5,4 +5,11 @@ struct fetch_negotiator;
 
 void skipping_negotiator_init(struct fetch_negotiator *negotiator);
 
+/*
+ * Like the skipping negotiator, but walks the history in generation number
+ * order when a commit-graph is available, so that clock skew cannot have a
+ * commit popped before its descendants.
+ */
+void generation_negotiator_init(struct fetch_negotiator *negotiator);
+
 #endif
@@ -1845,6 +1845,9 @@ static int do_oid_object_info_extended(struct repository *r,
 			 * TODO Investigate checking promisor_remote_get_direct()
 			 * TODO return value and stopping on error here.
 			 */
+			if (promisor_remote_prefetch_wait(r, real))
+				/* queued for prefetch; fetch it directly only if that failed */
+				continue;
 			promisor_remote_get_direct(r, real, 1);
 			already_retried = 1;
 			continue;
@@ -2167,17 +2170,18 @@ static int write_loose_object(const struct object_id *oid, char *hdr,
 	git_zstream stream;
 	git_hash_ctx c;
 	struct object_id parano_oid;
-	static struct strbuf tmp_file = STRBUF_INIT;
-	static struct strbuf filename = STRBUF_INIT;
+	struct strbuf tmp_file = STRBUF_INIT;
+	struct strbuf filename = STRBUF_INIT;
 
 	loose_object_path(the_repository, &filename, oid);
 
 	fd = create_tmpfile(&tmp_file, filename.buf);
 	if (fd < 0) {
 		if (errno == EACCES)
-			return error(_("insufficient permission for adding an object to repository database %s"), get_object_directory());
+			ret = error(_("insufficient permission for adding an object to repository database %s"), get_object_directory());
 		else
-			return error_errno(_("unable to create temporary file"));
+			ret = error_errno(_("unable to create temporary file"));
+		goto out;
 	}
 
 	/* Set it up */
@@ -2228,7 +2232,11 @@ static int write_loose_object(const struct object_id *oid, char *hdr,
 			warning_errno(_("failed utime() on %s"), tmp_file.buf);
 	}
 
-	return finalize_object_file(tmp_file.buf, filename.buf);
+	ret = finalize_object_file(tmp_file.buf, filename.buf);
+out:
+	strbuf_release(&tmp_file);
+	strbuf_release(&filename);
+	return ret;
 }
 
 static int freshen_loose_object(const struct object_id *oid,
@@ -2266,6 +2274,23 @@ int write_object_file(const void *buf, unsigned long len, const char *type,
 	return write_loose_object(oid, hdr, hdrlen, buf, len, 0);
 }
 
+int write_object_file_hashed(const void *buf, unsigned long len,
+			     const char *type, const struct object_id *oid)
+{
+	char hdr[MAX_HEADER_LEN];
+	int hdrlen, exists;
+
+	hdrlen = xsnprintf(hdr, sizeof(hdr), "%s %"PRIuMAX , type,
+			   (uintmax_t)len) + 1;
+
+	obj_read_lock();
+	exists = freshen_packed_object(oid) || freshen_loose_object(oid, 1);
+	obj_read_unlock();
+	if (exists)
+		return 0;
+	return write_loose_object(oid, hdr, hdrlen, buf, len, 0);
+}
+
 int hash_object_file_literally(const void *buf, unsigned long len,
 			       const char *type, struct object_id *oid,
 			       unsigned flags)
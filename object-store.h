@@ -233,6 +233,16 @@ int hash_object_file(const struct git_hash_algo *algo, const void *buf,
 int write_object_file(const void *buf, unsigned long len,
 		      const char *type, struct object_id *oid);
 
+/*
+ * Like write_object_file(), for an object whose name "oid" the caller
+ * has already computed with hash_object_file(). Only the lookup of an
+ * existing copy to freshen is done under obj_read_lock(); a missing
+ * object is deflated and written outside of it, so that several threads
+ * can write objects at the same time.
+ */
+int write_object_file_hashed(const void *buf, unsigned long len,
+			     const char *type, const struct object_id *oid);
+
 int hash_object_file_literally(const void *buf, unsigned long len,
 			       const char *type, struct object_id *oid,
 			       unsigned flags);
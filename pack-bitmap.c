@@ -68,6 +68,14 @@ struct bitmap_index {
 	/* Number of bitmapped commits */
 	uint32_t entry_count;
 
+	/*
+	 * Map from commit ID -> the commits reachable from it, as found by
+	 * bitmap_for_commit_reach(), or NULL if it could not tell. Kept so
+	 * that later queries about the same commits (or their descendants)
+	 * do not walk again.
+	 */
+	kh_oid_map_t *reach_cache;
+
 	/* If not NULL, this is a name-hash cache pointing into map. */
 	uint32_t *hashes;
 
@@ -563,6 +571,90 @@ static int add_commit_to_bitmap(struct bitmap_index *bitmap_git,
 	return 1;
 }
 
+/*
+ * How many commits without a stored bitmap bitmap_for_commit_reach()
+ * walks before it gives up. Bitmapped commits are rarely much further
+ * apart than this, so giving up usually means that the walk left the
+ * part of the history covered by the bitmaps.
+ */
+#define BITMAP_REACH_MAX_WALK 1000
+
+struct bitmap *bitmap_for_commit_reach(struct bitmap_index *bitmap_git,
+				       struct commit *commit)
+{
+	struct bitmap *result;
+	struct commit **stack = NULL;
+	size_t stack_nr = 0, stack_alloc = 0, walked = 0;
+	khiter_t cache_pos;
+	int hash_ret;
+
+	if (!bitmap_git->reach_cache)
+		bitmap_git->reach_cache = kh_init_oid_map();
+	cache_pos = kh_put_oid_map(bitmap_git->reach_cache, commit->object.oid,
+				   &hash_ret);
+	if (!hash_ret) {
+		struct ewah_bitmap *cached = kh_value(bitmap_git->reach_cache,
+						      cache_pos);
+		return cached ? ewah_to_bitmap(cached) : NULL;
+	}
+	kh_value(bitmap_git->reach_cache, cache_pos) = NULL;
+
+	result = bitmap_new();
+	ALLOC_GROW(stack, stack_nr + 1, stack_alloc);
+	stack[stack_nr++] = commit;
+
+	while (stack_nr) {
+		struct commit *c = stack[--stack_nr];
+		struct commit_list *p;
+		int pos;
+
+		/*
+		 * The bitmapped pack is closed under reachability, so all
+		 * we need to know about a commit outside of it is that we
+		 * cannot answer for it.
+		 */
+		pos = bitmap_position_packfile(bitmap_git, &c->object.oid);
+		if (pos < 0)
+			goto fail;
+		if (bitmap_get(result, pos))
+			continue;
+		if (add_commit_to_bitmap(bitmap_git, &result, c))
+			continue;
+		if (c != commit) {
+			khiter_t hash_pos = kh_get_oid_map(bitmap_git->reach_cache,
+							   c->object.oid);
+
+			if (hash_pos < kh_end(bitmap_git->reach_cache)) {
+				struct ewah_bitmap *cached =
+					kh_value(bitmap_git->reach_cache, hash_pos);
+
+				if (!cached)
+					goto fail;
+				bitmap_or_ewah(result, cached);
+				continue;
+			}
+		}
+
+		if (++walked > BITMAP_REACH_MAX_WALK ||
+		    repo_parse_commit(the_repository, c))
+			goto fail;
+		bitmap_set(result, pos);
+		for (p = c->parents; p; p = p->next) {
+			ALLOC_GROW(stack, stack_nr + 1, stack_alloc);
+			stack[stack_nr++] = p->item;
+		}
+	}
+
+	free(stack);
+	kh_value(bitmap_git->reach_cache, cache_pos) = bitmap_to_ewah(result);
+	return result;
+
+fail:
+	free(stack);
+	bitmap_free(result);
+	return NULL;
+}
+
 static struct bitmap *find_objects(struct bitmap_index *bitmap_git,
 				   struct rev_info *revs,
 				   struct object_list *roots,
@@ -1128,7 +1220,7 @@ struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs,
 	return NULL;
 }
 
-static void try_partial_reuse(struct bitmap_index *bitmap_git,
+static void try_partial_reuse(struct packed_git *pack,
 			      size_t pos,
 			      struct bitmap *reuse,
 			      struct pack_window **w_curs)
@@ -1137,11 +1229,11 @@ static void try_partial_reuse(struct bitmap_index *bitmap_git,
 	enum object_type type;
 	unsigned long size;
 
-	if (pos >= bitmap_git->pack->num_objects)
+	if (pos >= pack->num_objects)
 		return; /* not actually in the pack */
 
-	offset = header = pack_pos_to_offset(bitmap_git->pack, pos);
-	type = unpack_object_header(bitmap_git->pack, w_curs, &offset, &size);
+	offset = header = pack_pos_to_offset(pack, pos);
+	type = unpack_object_header(pack, w_curs, &offset, &size);
 	if (type < 0)
 		return; /* broken packfile, punt */
 
@@ -1157,11 +1249,11 @@ static void try_partial_reuse(struct bitmap_index *bitmap_git,
 		 * and the normal slow path will complain about it in
 		 * more detail.
 		 */
-		base_offset = get_delta_base(bitmap_git->pack, w_curs,
+		base_offset = get_delta_base(pack, w_curs,
 					     &offset, type, header);
 		if (!base_offset)
 			return;
-		if (offset_to_pack_pos(bitmap_git->pack, base_offset, &base_pos) < 0)
+		if (offset_to_pack_pos(pack, base_offset, &base_pos) < 0)
 			return;
 
 		/*
@@ -1194,13 +1286,114 @@ static void try_partial_reuse(struct bitmap_index *bitmap_git,
 	bitmap_set(reuse, pos);
 }
 
+struct ext_reuse_entry {
+	struct packed_git *p;
+	uint32_t pack_pos;
+	uint32_t ext_pos;
+};
+
+static int ext_reuse_entry_cmp(const void *va, const void *vb)
+{
+	const struct ext_reuse_entry *a = va, *b = vb;
+
+	if (a->p != b->p) {
+		int cmp = strcmp(a->p->pack_name, b->p->pack_name);
+		if (cmp)
+			return cmp;
+		return a->p < b->p ? -1 : 1;
+	}
+	if (a->pack_pos != b->pack_pos)
+		return a->pack_pos < b->pack_pos ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Objects reachable from the wants but missing from the bitmapped pack
+ * live in the extended index. Those which are stored in some other
+ * pack can be sent verbatim out of that pack, under the same rules as
+ * try_partial_reuse(): a delta is reused only if its base is reused
+ * from the same pack.
+ *
+ * Each pack gets its own pack-order bitmap appended to "packs", and the
+ * extended bitmap positions of the reused objects are set in "reuse".
+ */
+static void reuse_extended_packfiles(struct bitmap_index *bitmap_git,
+				     struct bitmap *reuse,
+				     struct reused_packfile **packs,
+				     size_t *packs_nr, size_t *packs_alloc)
+{
+	struct bitmap *result = bitmap_git->result;
+	struct eindex *eindex = &bitmap_git->ext_index;
+	struct ext_reuse_entry *entries = NULL;
+	size_t entries_nr = 0, entries_alloc = 0;
+	size_t i, j;
+
+	for (i = 0; i < eindex->count; i++) {
+		struct object *obj = eindex->objects[i];
+		struct pack_entry e;
+		uint32_t pos;
+
+		if (!bitmap_get(result, bitmap_git->pack->num_objects + i))
+			continue;
+		if (!find_pack_entry(the_repository, &obj->oid, &e))
+			continue; /* loose object */
+		if (e.p == bitmap_git->pack || !e.p->pack_local)
+			continue;
+		if (offset_to_pack_pos(e.p, e.offset, &pos) < 0)
+			continue;
+
+		ALLOC_GROW(entries, entries_nr + 1, entries_alloc);
+		entries[entries_nr].p = e.p;
+		entries[entries_nr].pack_pos = pos;
+		entries[entries_nr].ext_pos = i;
+		entries_nr++;
+	}
+
+	QSORT(entries, entries_nr, ext_reuse_entry_cmp);
+
+	for (i = 0; i < entries_nr; i = j) {
+		struct packed_git *p = entries[i].p;
+		struct pack_window *w_curs = NULL;
+		struct bitmap *objects = bitmap_new();
+		int any = 0;
+
+		for (j = i; j < entries_nr && entries[j].p == p; j++) {
+			try_partial_reuse(p, entries[j].pack_pos, objects, &w_curs);
+			if (!bitmap_get(objects, entries[j].pack_pos))
+				continue;
+
+			bitmap_set(reuse, bitmap_git->pack->num_objects +
+					  entries[j].ext_pos);
+			any = 1;
+		}
+
+		unuse_pack(&w_curs);
+
+		if (!any) {
+			bitmap_free(objects);
+			continue;
+		}
+
+		ALLOC_GROW(*packs, *packs_nr + 1, *packs_alloc);
+		(*packs)[*packs_nr].p = p;
+		(*packs)[*packs_nr].objects = objects;
+		(*packs_nr)++;
+	}
+
+	free(entries);
+}
+
 int reuse_partial_packfile_from_bitmap(struct bitmap_index *bitmap_git,
-				       struct packed_git **packfile_out,
+				       int multi_pack,
+				       struct reused_packfile **packs_out,
+				       size_t *packs_nr,
 				       uint32_t *entries,
 				       struct bitmap **reuse_out)
 {
 	struct bitmap *result = bitmap_git->result;
-	struct bitmap *reuse;
+	struct bitmap *pack_reuse, *reuse;
+	struct reused_packfile *packs = NULL;
+	size_t nr = 0, alloc = 0;
 	struct pack_window *w_curs = NULL;
 	size_t i = 0;
 	uint32_t offset;
@@ -1214,26 +1407,51 @@ int reuse_partial_packfile_from_bitmap(struct bitmap_index *bitmap_git,
 	if (i > bitmap_git->pack->num_objects / BITS_IN_EWORD)
 		i = bitmap_git->pack->num_objects / BITS_IN_EWORD;
 
-	reuse = bitmap_word_alloc(i);
-	memset(reuse->words, 0xFF, i * sizeof(eword_t));
+	pack_reuse = bitmap_word_alloc(i);
+	memset(pack_reuse->words, 0xFF, i * sizeof(eword_t));
 
 	for (; i < result->word_alloc; ++i) {
 		eword_t word = result->words[i];
 		size_t pos = (i * BITS_IN_EWORD);
 
+		if (pos >= bitmap_git->pack->num_objects)
+			break;
+
 		for (offset = 0; offset < BITS_IN_EWORD; ++offset) {
 			if ((word >> offset) == 0)
 				break;
 
 			offset += ewah_bit_ctz64(word >> offset);
-			try_partial_reuse(bitmap_git, pos + offset, reuse, &w_curs);
+			try_partial_reuse(bitmap_git->pack, pos + offset,
+					  pack_reuse, &w_curs);
 		}
 	}
 
 	unuse_pack(&w_curs);
 
+	/*
+	 * The bitmapped pack's positions coincide with the first
+	 * "num_objects" bitmap positions, so it seeds the combined
+	 * bitmap as-is.
+	 */
+	reuse = bitmap_word_alloc(pack_reuse->word_alloc);
+	COPY_ARRAY(reuse->words, pack_reuse->words, pack_reuse->word_alloc);
+
+	if (bitmap_popcount(pack_reuse)) {
+		ALLOC_GROW(packs, nr + 1, alloc);
+		packs[nr].p = bitmap_git->pack;
+		packs[nr].objects = pack_reuse;
+		nr++;
+	} else {
+		bitmap_free(pack_reuse);
+	}
+
+	if (multi_pack)
+		reuse_extended_packfiles(bitmap_git, reuse, &packs, &nr, &alloc);
+
 	*entries = bitmap_popcount(reuse);
 	if (!*entries) {
+		free(packs);
 		bitmap_free(reuse);
 		return -1;
 	}
@@ -1243,7 +1461,8 @@ int reuse_partial_packfile_from_bitmap(struct bitmap_index *bitmap_git,
 	 * need to be handled separately.
 	 */
 	bitmap_and_not(result, reuse);
-	*packfile_out = bitmap_git->pack;
+	*packs_out = packs;
+	*packs_nr = nr;
 	*reuse_out = reuse;
 	return 0;
 }
@@ -1499,6 +1718,12 @@ void free_bitmap_index(struct bitmap_index *b)
 	ewah_pool_free(b->blobs);
 	ewah_pool_free(b->tags);
 	kh_destroy_oid_map(b->bitmaps);
+	if (b->reach_cache) {
+		struct ewah_bitmap *cached;
+
+		kh_foreach_value(b->reach_cache, cached, ewah_free(cached));
+		kh_destroy_oid_map(b->reach_cache);
+	}
 	free(b->ext_index.objects);
 	free(b->ext_index.hashes);
 	bitmap_free(b->result);
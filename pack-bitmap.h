@@ -43,6 +43,16 @@ typedef int (*show_reachable_fn)(
 
 struct bitmap_index;
 
+/*
+ * A packfile whose objects are sent verbatim by pack-objects. The
+ * "objects" bitmap is indexed by position in the pack (i.e., in the
+ * order given by the pack's reverse index), not by bitmap position.
+ */
+struct reused_packfile {
+	struct packed_git *p;
+	struct bitmap *objects;
+};
+
 struct bitmap_index *prepare_bitmap_git(struct repository *r);
 void count_bitmap_commit_list(struct bitmap_index *, uint32_t *commits,
 			      uint32_t *trees, uint32_t *blobs, uint32_t *tags);
@@ -54,8 +64,22 @@ int test_bitmap_commits(struct repository *r);
 struct bitmap_index *prepare_bitmap_walk(struct rev_info *revs,
 					 struct list_objects_filter_options *filter,
 					 int filter_provided_objects);
+/*
+ * Find objects in the result of the last walk which can be copied verbatim
+ * out of their on-disk packs. The bitmapped pack is always considered; if
+ * "multi_pack" is set, objects in the extended index that live in other
+ * packs are considered as well.
+ *
+ * On success, "packs_out" holds the packs to reuse from (in the order they
+ * should be written), "entries" the total number of reused objects, and
+ * "reuse_out" those same objects in bitmap position order, suitable for
+ * bitmap_walk_contains(). Reused objects are removed from the walk's result.
+ * Returns -1 if nothing can be reused.
+ */
 int reuse_partial_packfile_from_bitmap(struct bitmap_index *,
-				       struct packed_git **packfile,
+				       int multi_pack,
+				       struct reused_packfile **packs_out,
+				       size_t *packs_nr,
 				       uint32_t *entries,
 				       struct bitmap **reuse_out);
 int rebuild_existing_bitmaps(struct bitmap_index *, struct packing_data *mapping,
@@ -64,6 +88,19 @@ void free_bitmap_index(struct bitmap_index *);
 int bitmap_walk_contains(struct bitmap_index *,
 			 struct bitmap *bitmap, const struct object_id *oid);
 
+/*
+ * Return a bitmap with (at least) all commits reachable from "commit"
+ * set, built from the stored bitmaps of its closest bitmapped
+ * ancestors. Trees are never walked, so this is cheap, but returns
+ * NULL if the commits between "commit" and those ancestors are not all
+ * in the bitmapped pack, or if there are too many of them. The answer is
+ * remembered in the bitmap index, and later calls for "commit" or for
+ * its descendants start from it instead of walking again. Query the
+ * result with bitmap_walk_contains(); free it with bitmap_free().
+ */
+struct bitmap *bitmap_for_commit_reach(struct bitmap_index *,
+				       struct commit *commit);
+
 /*
  * After a traversal has been performed by prepare_bitmap_walk(), this can be
  * queried to see if a particular object was reachable from any of the
@@ -1,6 +1,7 @@
 #include "cache.h"
 #include "config.h"
 #include "entry.h"
+#include "object-store.h"
 #include "parallel-checkout.h"
 #include "pkt-line.h"
 #include "progress.h"
@@ -33,6 +34,20 @@ enum pc_status parallel_checkout_status(void)
 static const int DEFAULT_THRESHOLD_FOR_PARALLELISM = 100;
 static const int DEFAULT_NUM_WORKERS = 1;
 
+static int use_worker_threads(void)
+{
+	int v;
+
+	if (!HAVE_THREADS)
+		return 0;
+	v = git_env_bool("GIT_TEST_CHECKOUT_THREADS", -1);
+	if (v >= 0)
+		return v;
+	if (git_config_get_bool("checkout.useThreads", &v))
+		return 0;
+	return v;
+}
+
 void get_parallel_checkout_configs(int *num_workers, int *threshold)
 {
 	char *env_workers = getenv("GIT_TEST_CHECKOUT_WORKERS");
@@ -254,11 +269,27 @@ static int reset_fd(int fd, const char *path)
 	return 0;
 }
 
+/*
+ * The object reading API can be used by several threads at once once
+ * enable_obj_read_lock() has been called, but the streaming interface
+ * cannot: it reads loose objects and pack windows without the lock. So
+ * worker threads read the blobs they write into memory, and only those
+ * that are too big for that are streamed, while holding the lock.
+ */
+static int stream_in_thread(const struct object_id *oid)
+{
+	unsigned long size;
+
+	if (oid_object_info(the_repository, oid, &size) != OBJ_BLOB)
+		return 0;
+	return size > big_file_threshold;
+}
+
 static int write_pc_item_to_fd(struct parallel_checkout_item *pc_item, int fd,
-			       const char *path)
+			       const char *path, int in_thread)
 {
 	int ret;
-	struct stream_filter *filter;
+	struct stream_filter *filter = NULL;
 	struct strbuf buf = STRBUF_INIT;
 	char *blob;
 	unsigned long size;
@@ -267,9 +298,15 @@ static int write_pc_item_to_fd(struct parallel_checkout_item *pc_item, int fd,
 	/* Sanity check */
 	assert(is_eligible_for_parallel_checkout(pc_item->ce, &pc_item->ca));
 
-	filter = get_stream_filter_ca(&pc_item->ca, &pc_item->ce->oid);
+	if (!in_thread || stream_in_thread(&pc_item->ce->oid))
+		filter = get_stream_filter_ca(&pc_item->ca, &pc_item->ce->oid);
 	if (filter) {
-		if (stream_blob_to_fd(fd, &pc_item->ce->oid, filter, 1)) {
+		if (in_thread)
+			obj_read_lock();
+		ret = stream_blob_to_fd(fd, &pc_item->ce->oid, filter, 1);
+		if (in_thread)
+			obj_read_unlock();
+		if (ret) {
 			/* On error, reset fd to try writing without streaming */
 			if (reset_fd(fd, path))
 				return -1;
@@ -319,8 +356,13 @@ static int close_and_clear(int *fd)
 	return ret;
 }
 
-void write_pc_item(struct parallel_checkout_item *pc_item,
-		   struct checkout *state)
+/*
+ * Write the item to the working tree. "cache" is the lstat cache to use
+ * for the leading directories, or NULL for the default one; worker
+ * threads must each have their own.
+ */
+static void write_pc_item_1(struct parallel_checkout_item *pc_item,
+			    struct checkout *state, struct cache_def *cache)
 {
 	unsigned int mode = (pc_item->ce->ce_mode & 0100) ? 0777 : 0666;
 	int fd = -1, fstat_done = 0;
@@ -338,8 +380,12 @@ void write_pc_item(struct parallel_checkout_item *pc_item,
 	 * a symlink (checked out after we enqueued this entry for parallel
 	 * checkout). Thus, we must check the leading dirs again.
 	 */
-	if (dir_sep && !has_dirs_only_path(path.buf, dir_sep - path.buf,
-					   state->base_dir_len)) {
+	if (dir_sep && !(cache ?
+			 threaded_has_dirs_only_path(cache, path.buf,
+						     dir_sep - path.buf,
+						     state->base_dir_len) :
+			 has_dirs_only_path(path.buf, dir_sep - path.buf,
+					    state->base_dir_len))) {
 		pc_item->status = PC_ITEM_COLLIDED;
 		trace2_data_string("pcheckout", NULL, "collision/dirname", path.buf);
 		goto out;
@@ -366,7 +412,7 @@ void write_pc_item(struct parallel_checkout_item *pc_item,
 		goto out;
 	}
 
-	if (write_pc_item_to_fd(pc_item, fd, path.buf)) {
+	if (write_pc_item_to_fd(pc_item, fd, path.buf, !!cache)) {
 		/* Error was already reported. */
 		pc_item->status = PC_ITEM_FAILED;
 		close_and_clear(&fd);
@@ -394,6 +440,12 @@ void write_pc_item(struct parallel_checkout_item *pc_item,
 	strbuf_release(&path);
 }
 
+void write_pc_item(struct parallel_checkout_item *pc_item,
+		   struct checkout *state)
+{
+	write_pc_item_1(pc_item, state, NULL);
+}
+
 static void send_one_item(int fd, struct parallel_checkout_item *pc_item)
 {
 	size_t len_data;
@@ -630,6 +682,82 @@ static void gather_results_from_workers(struct pc_worker *workers,
 	free(pfds);
 }
 
+/*
+ * Instead of spawning checkout--worker processes, the items can also be
+ * written by threads of this process. This saves sending the items over
+ * to the workers and their results back, and having each of them set up
+ * the repository and object store again, which matters most when there
+ * are many small files. The threads take the next batch of items from
+ * the queue until it is empty, so that one that gets stuck on a large
+ * file does not hold up the rest.
+ */
+#define PC_THREAD_BATCH 32
+
+struct pc_threads {
+	struct checkout *state;
+	pthread_mutex_t mutex;
+	size_t next;
+};
+
+static void *write_items_thread(void *data)
+{
+	struct pc_threads *pt = data;
+	struct cache_def cache = CACHE_DEF_INIT;
+	size_t start = 0, end = 0;
+
+	trace2_thread_start("checkout-worker");
+	for (;;) {
+		size_t i;
+
+		pthread_mutex_lock(&pt->mutex);
+		/* report the batch we have just written */
+		for (i = start; i < end; i++)
+			if (parallel_checkout.items[i].status != PC_ITEM_COLLIDED)
+				advance_progress_meter();
+		start = pt->next;
+		end = start + PC_THREAD_BATCH;
+		if (end > parallel_checkout.nr)
+			end = parallel_checkout.nr;
+		pt->next = end;
+		pthread_mutex_unlock(&pt->mutex);
+
+		if (start >= end)
+			break;
+		for (i = start; i < end; i++)
+			write_pc_item_1(&parallel_checkout.items[i], pt->state,
+					&cache);
+	}
+	cache_def_clear(&cache);
+	trace2_thread_exit();
+	return NULL;
+}
+
+static void write_items_in_threads(struct checkout *state, int num_threads)
+{
+	struct pc_threads pt = { .state = state };
+	pthread_t *threads;
+	int i;
+
+	ALLOC_ARRAY(threads, num_threads);
+	pthread_mutex_init(&pt.mutex, NULL);
+	enable_obj_read_lock();
+
+	for (i = 0; i < num_threads; i++) {
+		int err = pthread_create(&threads[i], NULL,
+					 write_items_thread, &pt);
+		if (err)
+			die(_("unable to create checkout worker thread: %s"),
+			    strerror(err));
+	}
+	for (i = 0; i < num_threads; i++)
+		if (pthread_join(threads[i], NULL))
+			die("unable to join checkout worker thread");
+
+	disable_obj_read_lock();
+	pthread_mutex_destroy(&pt.mutex);
+	free(threads);
+}
+
 static void write_items_sequentially(struct checkout *state)
 {
 	size_t i;
@@ -659,6 +787,8 @@ int run_parallel_checkout(struct checkout *state, int num_workers, int threshold
 
 	if (num_workers <= 1 || parallel_checkout.nr < threshold) {
 		write_items_sequentially(state);
+	} else if (use_worker_threads()) {
+		write_items_in_threads(state, num_workers);
 	} else {
 		struct pc_worker *workers = setup_workers(state, num_workers);
 		gather_results_from_workers(workers, num_workers);
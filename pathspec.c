@@ -758,3 +758,20 @@ int match_pathspec_attrs(struct index_state *istate,
 
 	return 1;
 }
+
+int pathspec_item_leading_path_len(const struct pathspec_item *item)
+{
+	int len = item->nowildcard_len;
+
+	if (item->magic & PATHSPEC_ICASE)
+		return 0;
+
+	/* a wildcard may only stand for the rest of a directory */
+	if (len < item->len)
+		while (len > 0 && item->match[len - 1] != '/')
+			len--;
+	while (len > 0 && item->match[len - 1] == '/')
+		len--;
+
+	return len;
+}
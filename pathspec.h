@@ -172,4 +172,12 @@ int match_pathspec_attrs(struct index_state *istate,
 			 const char *name, int namelen,
 			 const struct pathspec_item *item);
 
+/*
+ * Return the length of the leading path that every path matched by
+ * "item" is either equal to or inside of, without a trailing slash;
+ * e.g. 3 for "dir/sub*" and 7 for "dir/sub/". Returns 0 if there is
+ * no such path, or if the item matches case-insensitively.
+ */
+int pathspec_item_leading_path_len(const struct pathspec_item *item);
+
 #endif /* PATHSPEC_H */
@@ -21,77 +21,110 @@ static struct fscache *fscache;
 #define MAX_PARALLEL (20)
 #define THREAD_COST (500)
 
-struct progress_data {
-	unsigned long n;
-	struct progress *progress;
+/*
+ * The threads take the entries to check from the index in batches of
+ * about this many. Each batch is extended to the end of the directory
+ * it stops in, so that the entries of one directory are all looked at
+ * by the same thread, which then finds their leading directories in
+ * its lstat cache. Handing out the work in small batches also keeps a
+ * thread that is stuck on a slow directory (e.g. on a network file
+ * system) from holding up the rest of the index.
+ */
+#define BATCH_SIZE (256)
+
+struct preload_queue {
+	struct index_state *index;
 	pthread_mutex_t mutex;
+	int next;
+	unsigned long done;
+	struct progress *progress;
 };
 
 struct thread_data {
 	pthread_t pthread;
-	struct index_state *index;
+	struct preload_queue *queue;
 	struct pathspec pathspec;
-	struct progress_data *progress;
-	int offset, nr;
+	int nr; /* the share of the index this thread expects to check */
 	int t2_nr_lstat;
+	int t2_nr_leading_lstat;
 };
 
+/*
+ * Claim the next batch of entries into [*begin, *end), after reporting
+ * the "done" entries of the previous one. Return 0 when there are none
+ * left.
+ */
+static int next_batch(struct preload_queue *q, int done, int *begin, int *end)
+{
+	struct index_state *index = q->index;
+	int i, len;
+	const char *name, *slash;
+
+	pthread_mutex_lock(&q->mutex);
+	if (q->progress) {
+		q->done += done;
+		display_progress(q->progress, q->done);
+	}
+	i = q->next;
+	if (i + BATCH_SIZE < index->cache_nr) {
+		/* do not split the directory we stop in */
+		name = index->cache[i + BATCH_SIZE - 1]->name;
+		slash = strrchr(name, '/');
+		len = slash ? slash - name + 1 : 0;
+		for (q->next = i + BATCH_SIZE; q->next < index->cache_nr; q->next++) {
+			const char *next = index->cache[q->next]->name;
+			if (strncmp(name, next, len) || strchr(next + len, '/'))
+				break;
+		}
+	} else {
+		q->next = index->cache_nr;
+	}
+	*begin = i;
+	*end = q->next;
+	pthread_mutex_unlock(&q->mutex);
+
+	return *begin < *end;
+}
+
 static void *preload_thread(void *_data)
 {
-	int nr, last_nr;
 	struct thread_data *p = _data;
-	struct index_state *index = p->index;
-	struct cache_entry **cep = index->cache + p->offset;
+	struct preload_queue *q = p->queue;
+	struct index_state *index = q->index;
 	struct cache_def cache = CACHE_DEF_INIT;
-
-	nr = p->nr;
-	if (nr + p->offset > index->cache_nr)
-		nr = index->cache_nr - p->offset;
-	last_nr = nr;
-
-	enable_fscache(nr);
-	do {
-		struct cache_entry *ce = *cep++;
-		struct stat st;
-
-		if (ce_stage(ce))
-			continue;
-		if (S_ISGITLINK(ce->ce_mode))
-			continue;
-		if (ce_uptodate(ce))
-			continue;
-		if (ce_skip_worktree(ce))
-			continue;
-		if (ce->ce_flags & CE_FSMONITOR_VALID)
-			continue;
-		if (p->progress && !(nr & 31)) {
-			struct progress_data *pd = p->progress;
-
-			pthread_mutex_lock(&pd->mutex);
-			pd->n += last_nr - nr;
-			display_progress(pd->progress, pd->n);
-			pthread_mutex_unlock(&pd->mutex);
-			last_nr = nr;
+	int i, end, done = 0;
+
+	enable_fscache(p->nr);
+	while (next_batch(q, done, &i, &end)) {
+		done = end - i;
+		for (; i < end; i++) {
+			struct cache_entry *ce = index->cache[i];
+			struct stat st;
+
+			if (ce_stage(ce))
+				continue;
+			if (S_ISGITLINK(ce->ce_mode))
+				continue;
+			if (ce_uptodate(ce))
+				continue;
+			if (ce_skip_worktree(ce))
+				continue;
+			if (ce->ce_flags & CE_FSMONITOR_VALID)
+				continue;
+			if (!ce_path_match(index, ce, &p->pathspec, NULL))
+				continue;
+			if (threaded_has_symlink_leading_path(&cache, ce->name, ce_namelen(ce)))
+				continue;
+			p->t2_nr_lstat++;
+			if (lstat(ce->name, &st))
+				continue;
+			if (ie_match_stat(index, ce, &st, CE_MATCH_RACY_IS_DIRTY|CE_MATCH_IGNORE_FSMONITOR))
+				continue;
+			ce_mark_uptodate(ce);
+			mark_fsmonitor_valid(index, ce);
 		}
-		if (!ce_path_match(index, ce, &p->pathspec, NULL))
-			continue;
-		if (threaded_has_symlink_leading_path(&cache, ce->name, ce_namelen(ce)))
-			continue;
-		p->t2_nr_lstat++;
-		if (lstat(ce->name, &st))
-			continue;
-		if (ie_match_stat(index, ce, &st, CE_MATCH_RACY_IS_DIRTY|CE_MATCH_IGNORE_FSMONITOR))
-			continue;
-		ce_mark_uptodate(ce);
-		mark_fsmonitor_valid(index, ce);
-	} while (--nr > 0);
-	if (p->progress) {
-		struct progress_data *pd = p->progress;
-
-		pthread_mutex_lock(&pd->mutex);
-		display_progress(pd->progress, pd->n + last_nr);
-		pthread_mutex_unlock(&pd->mutex);
 	}
+	p->t2_nr_leading_lstat = cache.nr_lstat;
 	cache_def_clear(&cache);
 	merge_fscache(fscache);
 	return NULL;
@@ -101,10 +134,10 @@ void preload_index(struct index_state *index,
 		   const struct pathspec *pathspec,
 		   unsigned int refresh_flags)
 {
-	int threads, i, work, offset;
+	int threads, i, work;
 	struct thread_data data[MAX_PARALLEL];
-	struct progress_data pd;
-	int t2_sum_lstat = 0;
+	struct preload_queue queue;
+	int t2_sum_lstat = 0, t2_sum_leading_lstat = 0;
 
 	if (!HAVE_THREADS || !core_preload_index)
 		return;
@@ -121,28 +154,23 @@ void preload_index(struct index_state *index,
 	trace_performance_enter();
 	if (threads > MAX_PARALLEL)
 		threads = MAX_PARALLEL;
-	offset = 0;
-	work = DIV_ROUND_UP(index->cache_nr, threads);
 	memset(&data, 0, sizeof(data));
 
-	memset(&pd, 0, sizeof(pd));
-	if (refresh_flags & REFRESH_PROGRESS && isatty(2)) {
-		pd.progress = start_delayed_progress(_("Refreshing index"), index->cache_nr);
-		pthread_mutex_init(&pd.mutex, NULL);
-	}
+	memset(&queue, 0, sizeof(queue));
+	queue.index = index;
+	pthread_mutex_init(&queue.mutex, NULL);
+	if (refresh_flags & REFRESH_PROGRESS && isatty(2))
+		queue.progress = start_delayed_progress(_("Refreshing index"), index->cache_nr);
 
+	work = DIV_ROUND_UP(index->cache_nr, threads);
 	for (i = 0; i < threads; i++) {
 		struct thread_data *p = data+i;
 		int err;
 
-		p->index = index;
+		p->queue = &queue;
+		p->nr = work;
 		if (pathspec)
 			copy_pathspec(&p->pathspec, pathspec);
-		p->offset = offset;
-		p->nr = work;
-		if (pd.progress)
-			p->progress = &pd;
-		offset += work;
 		err = pthread_create(&p->pthread, NULL, preload_thread, p);
 
 		if (err)
@@ -153,12 +181,16 @@ void preload_index(struct index_state *index,
 		if (pthread_join(p->pthread, NULL))
 			die("unable to join threaded lstat");
 		t2_sum_lstat += p->t2_nr_lstat;
+		t2_sum_leading_lstat += p->t2_nr_leading_lstat;
 	}
-	stop_progress(&pd.progress);
+	stop_progress(&queue.progress);
+	pthread_mutex_destroy(&queue.mutex);
 
 	trace_performance_leave("preload index");
 
 	trace2_data_intmax("index", NULL, "preload/sum_lstat", t2_sum_lstat);
+	trace2_data_intmax("index", NULL, "preload/sum_leading_lstat",
+			   t2_sum_leading_lstat);
 	trace2_region_leave("index", "preload", NULL);
 }
 
@@ -5,19 +5,28 @@
 #include "config.h"
 #include "transport.h"
 #include "strvec.h"
+#include "oidmap.h"
+#include "thread-utils.h"
+#include "packfile.h"
 
 struct promisor_remote_config {
 	struct promisor_remote *promisors;
 	struct promisor_remote **promisors_tail;
 };
 
+/*
+ * Run "git fetch" for the given objects. This is also called by the
+ * prefetch thread, so report failures to the caller instead of dying
+ * and do not use the shared buffers of oid_to_hex().
+ */
 static int fetch_objects(struct repository *repo,
 			 const char *remote_name,
 			 const struct object_id *oids,
 			 int oid_nr)
 {
 	struct child_process child = CHILD_PROCESS_INIT;
-	int i;
+	char hex[GIT_MAX_HEXSZ + 1];
+	int i, ret = 0;
 	FILE *child_in;
 
 	child.git_cmd = 1;
@@ -29,21 +38,30 @@ static int fetch_objects(struct repository *repo,
 		     "--no-write-fetch-head", "--recurse-submodules=no",
 		     "--filter=blob:none", "--stdin", NULL);
 	if (start_command(&child))
-		die(_("promisor-remote: unable to fork off fetch subprocess"));
-	child_in = xfdopen(child.in, "w");
+		return error(_("promisor-remote: unable to fork off fetch subprocess"));
+	child_in = fdopen(child.in, "w");
+	if (!child_in) {
+		error_errno(_("promisor-remote: could not write to fetch subprocess"));
+		close(child.in);
+		finish_command(&child);
+		return -1;
+	}
 
 	trace2_data_intmax("promisor", repo, "fetch_count", oid_nr);
 
 	for (i = 0; i < oid_nr; i++) {
-		if (fputs(oid_to_hex(&oids[i]), child_in) < 0)
-			die_errno(_("promisor-remote: could not write to fetch subprocess"));
-		if (fputc('\n', child_in) < 0)
-			die_errno(_("promisor-remote: could not write to fetch subprocess"));
+		if (fputs(oid_to_hex_r(hex, &oids[i]), child_in) < 0 ||
+		    fputc('\n', child_in) < 0) {
+			ret = error_errno(_("promisor-remote: could not write to fetch subprocess"));
+			break;
+		}
 	}
 
-	if (fclose(child_in) < 0)
-		die_errno(_("promisor-remote: could not close stdin to fetch subprocess"));
-	return finish_command(&child) ? -1 : 0;
+	if (fclose(child_in) < 0 && !ret)
+		ret = error_errno(_("promisor-remote: could not close stdin to fetch subprocess"));
+	if (finish_command(&child))
+		ret = -1;
+	return ret;
 }
 
 static struct promisor_remote *promisor_remote_new(struct promisor_remote_config *config,
@@ -273,3 +291,257 @@ int promisor_remote_get_direct(struct repository *repo,
 
 	return res;
 }
+
+/*
+ * Asynchronous prefetching.
+ *
+ * Queued objects are collected into batches, which a single background
+ * thread hands to fetch_objects() one after the other. The batch size
+ * starts small so that the caller is not kept waiting for its first
+ * objects, and doubles up to "promisor.prefetchBatchSize".
+ *
+ * The background thread never looks at the object store; it only runs
+ * "git fetch". Making the fetched packs visible is left to the main
+ * thread, in promisor_remote_prefetch_wait() and _finish().
+ */
+#define PREFETCH_INITIAL_BATCH_SIZE 64
+#define PREFETCH_DEFAULT_MAX_BATCH_SIZE 4096
+
+struct prefetch_entry {
+	struct oidmap_entry entry;
+	/* id of the batch this object is fetched in */
+	unsigned batch;
+};
+
+struct prefetch_batch {
+	struct prefetch_batch *next;
+	unsigned id;
+	struct oid_array oids;
+};
+
+static struct prefetch_state {
+	int started;
+	struct repository *repo;
+	char *remote_name;
+	int batch_size, max_batch_size;
+
+	/* objects not yet handed to the background thread */
+	struct oid_array pending;
+	/* pending and in-flight objects nobody waited for yet */
+	struct oidmap queued;
+	/* number of batches handed to the background thread */
+	unsigned batches;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cond, done_cond;
+	/* the fields below are protected by "mutex" */
+	struct prefetch_batch *head, **tail;
+	unsigned done_batch;
+	int finishing;
+
+	/* statistics, reported to trace2 by _finish() */
+	intmax_t objects, stalls;
+	uint64_t stall_ns;
+} prefetch;
+
+static void *prefetch_thread(void *data)
+{
+	trace2_thread_start("promisor-prefetch");
+
+	pthread_mutex_lock(&prefetch.mutex);
+	for (;;) {
+		struct prefetch_batch *batch;
+
+		while (!prefetch.head && !prefetch.finishing)
+			pthread_cond_wait(&prefetch.work_cond, &prefetch.mutex);
+		if (!prefetch.head)
+			break;
+
+		batch = prefetch.head;
+		prefetch.head = batch->next;
+		if (!prefetch.head)
+			prefetch.tail = &prefetch.head;
+		pthread_mutex_unlock(&prefetch.mutex);
+
+		/*
+		 * A failed fetch is not fatal: whatever is still missing
+		 * gets fetched lazily, from all promisor remotes, once the
+		 * caller actually needs it.
+		 */
+		fetch_objects(prefetch.repo, prefetch.remote_name,
+			      batch->oids.oid, batch->oids.nr);
+
+		pthread_mutex_lock(&prefetch.mutex);
+		prefetch.done_batch = batch->id;
+		pthread_cond_broadcast(&prefetch.done_cond);
+		oid_array_clear(&batch->oids);
+		free(batch);
+	}
+	pthread_mutex_unlock(&prefetch.mutex);
+
+	trace2_thread_exit();
+	return NULL;
+}
+
+static int prefetch_start(struct repository *r)
+{
+	int err;
+
+	if (prefetch.started)
+		return r == prefetch.repo ? 0 : -1;
+
+	promisor_remote_init(r);
+	if (!r->promisor_remote_config->promisors)
+		return -1;
+
+	if (repo_config_get_int(r, "promisor.prefetchbatchsize",
+				&prefetch.max_batch_size))
+		prefetch.max_batch_size = PREFETCH_DEFAULT_MAX_BATCH_SIZE;
+	if (prefetch.max_batch_size <= 0)
+		return -1;
+
+	prefetch.repo = r;
+	prefetch.remote_name = xstrdup(r->promisor_remote_config->promisors->name);
+	prefetch.batch_size = PREFETCH_INITIAL_BATCH_SIZE;
+	if (prefetch.batch_size > prefetch.max_batch_size)
+		prefetch.batch_size = prefetch.max_batch_size;
+	oidmap_init(&prefetch.queued, 0);
+	prefetch.tail = &prefetch.head;
+
+	pthread_mutex_init(&prefetch.mutex, NULL);
+	pthread_cond_init(&prefetch.work_cond, NULL);
+	pthread_cond_init(&prefetch.done_cond, NULL);
+	err = pthread_create(&prefetch.thread, NULL, prefetch_thread, NULL);
+	if (err) {
+		warning(_("promisor-remote: unable to create prefetch thread: %s"),
+			strerror(err));
+		pthread_cond_destroy(&prefetch.done_cond);
+		pthread_cond_destroy(&prefetch.work_cond);
+		pthread_mutex_destroy(&prefetch.mutex);
+		oidmap_free(&prefetch.queued, 0);
+		free(prefetch.remote_name);
+		memset(&prefetch, 0, sizeof(prefetch));
+		return -1;
+	}
+
+	prefetch.started = 1;
+	return 0;
+}
+
+static void prefetch_send_pending(void)
+{
+	struct prefetch_batch *batch;
+
+	if (!prefetch.pending.nr)
+		return;
+
+	CALLOC_ARRAY(batch, 1);
+	batch->id = ++prefetch.batches;
+	batch->oids = prefetch.pending;
+	memset(&prefetch.pending, 0, sizeof(prefetch.pending));
+
+	pthread_mutex_lock(&prefetch.mutex);
+	*prefetch.tail = batch;
+	prefetch.tail = &batch->next;
+	pthread_cond_signal(&prefetch.work_cond);
+	pthread_mutex_unlock(&prefetch.mutex);
+
+	prefetch.batch_size *= 2;
+	if (prefetch.batch_size > prefetch.max_batch_size)
+		prefetch.batch_size = prefetch.max_batch_size;
+}
+
+void promisor_remote_prefetch(struct repository *r,
+			      const struct object_id *oids,
+			      int oid_nr)
+{
+	int i;
+
+	if (!oid_nr)
+		return;
+	if (!HAVE_THREADS || core_use_gvfs_helper || prefetch_start(r)) {
+		promisor_remote_get_direct(r, oids, oid_nr);
+		return;
+	}
+
+	for (i = 0; i < oid_nr; i++) {
+		struct prefetch_entry *e;
+
+		if (oidmap_get(&prefetch.queued, &oids[i]))
+			continue;
+
+		CALLOC_ARRAY(e, 1);
+		oidcpy(&e->entry.oid, &oids[i]);
+		e->batch = prefetch.batches + 1;
+		oidmap_put(&prefetch.queued, e);
+
+		oid_array_append(&prefetch.pending, &oids[i]);
+		prefetch.objects++;
+		if (prefetch.pending.nr >= prefetch.batch_size)
+			prefetch_send_pending();
+	}
+	prefetch_send_pending();
+}
+
+int promisor_remote_prefetch_wait(struct repository *r,
+				  const struct object_id *oid)
+{
+	struct prefetch_entry *e;
+
+	if (!prefetch.started || r != prefetch.repo)
+		return 0;
+
+	e = oidmap_remove(&prefetch.queued, oid);
+	if (!e)
+		return 0;
+
+	pthread_mutex_lock(&prefetch.mutex);
+	if (prefetch.done_batch < e->batch) {
+		uint64_t start = getnanotime();
+
+		while (prefetch.done_batch < e->batch)
+			pthread_cond_wait(&prefetch.done_cond, &prefetch.mutex);
+		prefetch.stalls++;
+		prefetch.stall_ns += getnanotime() - start;
+	}
+	pthread_mutex_unlock(&prefetch.mutex);
+
+	free(e);
+	reprepare_packed_git(r);
+	return 1;
+}
+
+void promisor_remote_prefetch_finish(struct repository *r)
+{
+	uint64_t start;
+
+	if (!prefetch.started || r != prefetch.repo)
+		return;
+
+	prefetch_send_pending();
+
+	start = getnanotime();
+	pthread_mutex_lock(&prefetch.mutex);
+	prefetch.finishing = 1;
+	pthread_cond_signal(&prefetch.work_cond);
+	pthread_mutex_unlock(&prefetch.mutex);
+	pthread_join(prefetch.thread, NULL);
+	prefetch.stall_ns += getnanotime() - start;
+
+	reprepare_packed_git(r);
+
+	trace2_data_intmax("promisor", r, "prefetch/batches", prefetch.batches);
+	trace2_data_intmax("promisor", r, "prefetch/objects", prefetch.objects);
+	trace2_data_intmax("promisor", r, "prefetch/stalls", prefetch.stalls);
+	trace2_data_intmax("promisor", r, "prefetch/stall_ms",
+			   prefetch.stall_ns / 1000000);
+
+	pthread_cond_destroy(&prefetch.done_cond);
+	pthread_cond_destroy(&prefetch.work_cond);
+	pthread_mutex_destroy(&prefetch.mutex);
+	oidmap_free(&prefetch.queued, 1);
+	oid_array_clear(&prefetch.pending);
+	free(prefetch.remote_name);
+	memset(&prefetch, 0, sizeof(prefetch));
+}
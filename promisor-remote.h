@@ -48,4 +48,30 @@ int promisor_remote_get_direct(struct repository *repo,
 			       const struct object_id *oids,
 			       int oid_nr);
 
+/*
+ * Queues objects that the caller is going to need soon. They are fetched in
+ * the background, in batches, while the caller keeps working. When threads
+ * are not available, this is the same as promisor_remote_get_direct().
+ *
+ * A lazy fetch of a queued object waits for the batch it is part of
+ * (see promisor_remote_prefetch_wait()) instead of fetching it again.
+ */
+void promisor_remote_prefetch(struct repository *repo,
+			      const struct object_id *oids,
+			      int oid_nr);
+
+/*
+ * If "oid" was queued by promisor_remote_prefetch(), waits until the
+ * background fetch of its batch is done and returns 1. Returns 0 if
+ * the object was not queued, or was already waited for.
+ */
+int promisor_remote_prefetch_wait(struct repository *repo,
+				  const struct object_id *oid);
+
+/*
+ * Waits for all queued objects to be fetched, and reports statistics
+ * about the batches and the time spent waiting for them to trace2.
+ */
+void promisor_remote_prefetch_finish(struct repository *repo);
+
 #endif /* PROMISOR_REMOTE_H */
@@ -3708,11 +3708,11 @@ static void write_ieot_extension(struct strbuf *sb, struct index_entry_offset_ta
 	}
 }
 
-void prefetch_cache_entries(const struct index_state *istate,
-			    must_prefetch_predicate must_prefetch)
+static void collect_missing_cache_entries(const struct index_state *istate,
+					  must_prefetch_predicate must_prefetch,
+					  struct oid_array *to_fetch)
 {
 	int i;
-	struct oid_array to_fetch = OID_ARRAY_INIT;
 
 	for (i = 0; i < istate->cache_nr; i++) {
 		struct cache_entry *ce = istate->cache[i];
@@ -3723,9 +3723,28 @@ void prefetch_cache_entries(const struct index_state *istate,
 					      NULL,
 					      OBJECT_INFO_FOR_PREFETCH))
 			continue;
-		oid_array_append(&to_fetch, &ce->oid);
+		oid_array_append(to_fetch, &ce->oid);
 	}
+}
+
+void prefetch_cache_entries(const struct index_state *istate,
+			    must_prefetch_predicate must_prefetch)
+{
+	struct oid_array to_fetch = OID_ARRAY_INIT;
+
+	collect_missing_cache_entries(istate, must_prefetch, &to_fetch);
 	promisor_remote_get_direct(the_repository,
 				   to_fetch.oid, to_fetch.nr);
 	oid_array_clear(&to_fetch);
 }
+
+void prefetch_cache_entries_async(const struct index_state *istate,
+				  must_prefetch_predicate must_prefetch)
+{
+	struct oid_array to_fetch = OID_ARRAY_INIT;
+
+	collect_missing_cache_entries(istate, must_prefetch, &to_fetch);
+	promisor_remote_prefetch(the_repository,
+				 to_fetch.oid, to_fetch.nr);
+	oid_array_clear(&to_fetch);
+}
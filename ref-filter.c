@@ -156,6 +156,7 @@ enum atom_type {
 	ATOM_IF,
 	ATOM_THEN,
 	ATOM_ELSE,
+	ATOM_AHEADBEHIND,
 };
 
 /*
@@ -205,10 +206,14 @@ static struct used_atom {
 		} email_option;
 		struct refname_atom refname;
 		char *head;
+		size_t ahead_behind; /* index into ahead_behind_bases */
 	} u;
 } *used_atom;
 static int used_atom_cnt, need_tagged, need_symref;
 
+/* The committishes given to %(ahead-behind:<committish>) atoms */
+static struct string_list ahead_behind_bases = STRING_LIST_INIT_DUP;
+
 /*
  * Expand string, append it to strbuf *sb, then return error code ret.
  * Allow to save few lines of code.
@@ -551,6 +556,20 @@ static int head_atom_parser(const struct ref_format *format, struct used_atom *a
 	return 0;
 }
 
+static int ahead_behind_atom_parser(const struct ref_format *format,
+				    struct used_atom *atom,
+				    const char *arg, struct strbuf *err)
+{
+	struct string_list_item *item;
+
+	if (!arg)
+		return strbuf_addf_ret(err, -1, _("expected format: %%(ahead-behind:<committish>)"));
+
+	item = string_list_append(&ahead_behind_bases, arg);
+	atom->u.ahead_behind = item - ahead_behind_bases.items;
+	return 0;
+}
+
 static struct {
 	const char *name;
 	info_source source;
@@ -599,6 +618,7 @@ static struct {
 	[ATOM_IF] = { "if", SOURCE_NONE, FIELD_STR, if_atom_parser },
 	[ATOM_THEN] = { "then", SOURCE_NONE },
 	[ATOM_ELSE] = { "else", SOURCE_NONE },
+	[ATOM_AHEADBEHIND] = { "ahead-behind", SOURCE_OTHER, FIELD_STR, ahead_behind_atom_parser },
 	/*
 	 * Please update $__git_ref_fieldlist in git-completion.bash
 	 * when you add new atoms
@@ -1554,16 +1574,35 @@ static const char *show_ref(struct refname_atom *atom, const char *refname)
 		return xstrdup(refname);
 }
 
+/*
+ * Like stat_tracking_info(), but use the counts that
+ * filter_ahead_behind() computed for this ref, if any.
+ */
+static int get_tracking_counts(struct ref_array_item *ref,
+			       struct branch *branch, int for_push,
+			       int *num_ours, int *num_theirs)
+{
+	const struct ahead_behind_count *count = ref->tracking_counts[for_push];
+
+	if (count) {
+		*num_ours = count->ahead;
+		*num_theirs = count->behind;
+		return 0;
+	}
+	return stat_tracking_info(branch, num_ours, num_theirs, NULL,
+				  for_push, AHEAD_BEHIND_FULL);
+}
+
 static void fill_remote_ref_details(struct used_atom *atom, const char *refname,
+				    struct ref_array_item *ref,
 				    struct branch *branch, const char **s)
 {
 	int num_ours, num_theirs;
 	if (atom->u.remote_ref.option == RR_REF)
 		*s = show_ref(&atom->u.remote_ref.refname, refname);
 	else if (atom->u.remote_ref.option == RR_TRACK) {
-		if (stat_tracking_info(branch, &num_ours, &num_theirs,
-				       NULL, atom->u.remote_ref.push,
-				       AHEAD_BEHIND_FULL) < 0) {
+		if (get_tracking_counts(ref, branch, atom->u.remote_ref.push,
+					&num_ours, &num_theirs) < 0) {
 			*s = xstrdup(msgs.gone);
 		} else if (!num_ours && !num_theirs)
 			*s = xstrdup("");
@@ -1580,9 +1619,8 @@ static void fill_remote_ref_details(struct used_atom *atom, const char *refname,
 			free((void *)to_free);
 		}
 	} else if (atom->u.remote_ref.option == RR_TRACKSHORT) {
-		if (stat_tracking_info(branch, &num_ours, &num_theirs,
-				       NULL, atom->u.remote_ref.push,
-				       AHEAD_BEHIND_FULL) < 0) {
+		if (get_tracking_counts(ref, branch, atom->u.remote_ref.push,
+					&num_ours, &num_theirs) < 0) {
 			*s = xstrdup("");
 			return;
 		}
@@ -1792,7 +1830,7 @@ static int populate_value(struct ref_array_item *ref, struct strbuf *err)
 
 			refname = branch_get_upstream(branch, NULL);
 			if (refname)
-				fill_remote_ref_details(atom, refname, branch, &v->s);
+				fill_remote_ref_details(atom, refname, ref, branch, &v->s);
 			else
 				v->s = xstrdup("");
 			continue;
@@ -1813,11 +1851,21 @@ static int populate_value(struct ref_array_item *ref, struct strbuf *err)
 			}
 			/* We will definitely re-init v->s on the next line. */
 			free((char *)v->s);
-			fill_remote_ref_details(atom, refname, branch, &v->s);
+			fill_remote_ref_details(atom, refname, ref, branch, &v->s);
 			continue;
 		} else if (atom_type == ATOM_COLOR) {
 			v->s = xstrdup(atom->u.color);
 			continue;
+		} else if (atom_type == ATOM_AHEADBEHIND) {
+			const struct ahead_behind_count *count = NULL;
+
+			if (ref->counts)
+				count = ref->counts[atom->u.ahead_behind];
+			if (count)
+				v->s = xstrfmt("%u %u", count->ahead, count->behind);
+			else
+				v->s = xstrdup("");
+			continue;
 		} else if (atom_type == ATOM_FLAG) {
 			char buf[256], *cp = buf;
 			if (ref->flag & REF_ISSYMREF)
@@ -2207,6 +2255,7 @@ static int ref_filter_handler(const char *refname, const struct object_id *oid,
 static void free_array_item(struct ref_array_item *item)
 {
 	free((char *)item->symref);
+	free(item->counts);
 	if (item->value) {
 		int i;
 		for (i = 0; i < used_atom_cnt; i++)
@@ -2225,6 +2274,8 @@ void ref_array_clear(struct ref_array *array)
 		free_array_item(array->items[i]);
 	FREE_AND_NULL(array->items);
 	array->nr = array->alloc = 0;
+	FREE_AND_NULL(array->counts);
+	array->counts_nr = 0;
 
 	for (i = 0; i < used_atom_cnt; i++) {
 		struct used_atom *atom = &used_atom[i];
@@ -2234,6 +2285,7 @@ void ref_array_clear(struct ref_array *array)
 	}
 	FREE_AND_NULL(used_atom);
 	used_atom_cnt = 0;
+	string_list_clear(&ahead_behind_bases, 0);
 
 	if (ref_to_worktree_map.worktrees) {
 		hashmap_clear_and_free(&(ref_to_worktree_map.map),
@@ -2356,6 +2408,159 @@ int filter_refs(struct ref_array *array, struct ref_filter *filter, unsigned int
 	return ret;
 }
 
+define_commit_slab(commit_position, size_t);
+
+/*
+ * Return the position of "c" in "commits", appending it if needed.
+ * Positions are stored off by one in the slab, so that zero means
+ * "not seen yet".
+ */
+static size_t ahead_behind_position(struct commit_position *positions,
+				    struct commit ***commits, size_t *nr,
+				    size_t *alloc, struct commit *c)
+{
+	size_t *pos = commit_position_at(positions, c);
+
+	if (!*pos) {
+		ALLOC_GROW(*commits, *nr + 1, *alloc);
+		(*commits)[(*nr)++] = c;
+		*pos = *nr;
+	}
+	return *pos - 1;
+}
+
+static struct commit *tracking_commit(struct repository *r,
+				      const char *branch_name, int for_push)
+{
+	struct branch *branch = branch_get(branch_name);
+	const char *base;
+	struct object_id oid;
+
+	base = for_push ? branch_get_push(branch, NULL) :
+		branch_get_upstream(branch, NULL);
+	if (!base || read_ref(base, &oid))
+		return NULL;
+	return lookup_commit_reference_gently(r, &oid, 1);
+}
+
+/*
+ * Queue a comparison between the commits at "tip" and "base", whose
+ * result pointer is to be stored at "*dest" once the walk is done.
+ */
+static void add_ahead_behind_count(struct ref_array *array,
+				   struct ahead_behind_count ****dests,
+				   size_t *alloc, size_t tip, size_t base,
+				   struct ahead_behind_count **dest)
+{
+	size_t old_alloc = *alloc;
+
+	ALLOC_GROW(array->counts, array->counts_nr + 1, *alloc);
+	if (*alloc != old_alloc)
+		REALLOC_ARRAY(*dests, *alloc);
+	array->counts[array->counts_nr].tip_index = tip;
+	array->counts[array->counts_nr].base_index = base;
+	(*dests)[array->counts_nr++] = dest;
+}
+
+void filter_ahead_behind(struct repository *r, struct ref_array *array)
+{
+	struct commit_position positions;
+	struct commit **commits = NULL;
+	size_t commits_nr = 0, commits_alloc = 0;
+	struct ahead_behind_count ***dests = NULL;
+	size_t counts_alloc = 0;
+	size_t *base_pos = NULL;
+	size_t bases_nr = ahead_behind_bases.nr;
+	int need_tracking[2] = { 0, 0 };
+	size_t i, j;
+	int k;
+
+	for (i = 0; i < used_atom_cnt; i++) {
+		struct used_atom *atom = &used_atom[i];
+
+		if ((atom->atom_type == ATOM_UPSTREAM ||
+		     atom->atom_type == ATOM_PUSH) &&
+		    (atom->u.remote_ref.option == RR_TRACK ||
+		     atom->u.remote_ref.option == RR_TRACKSHORT))
+			need_tracking[!!atom->u.remote_ref.push] = 1;
+	}
+	/*
+	 * Without generation numbers the batched walk has to compute them
+	 * for the whole history, while stat_tracking_info() stops at the
+	 * merge base; leave the tracking counts to it in that case.
+	 */
+	if (!generation_numbers_enabled(r))
+		need_tracking[0] = need_tracking[1] = 0;
+	if (!array->nr ||
+	    (!bases_nr && !need_tracking[0] && !need_tracking[1]))
+		return;
+
+	init_commit_position(&positions);
+
+	ALLOC_ARRAY(base_pos, bases_nr);
+	for (i = 0; i < bases_nr; i++) {
+		const char *name = ahead_behind_bases.items[i].string;
+		struct commit *c = lookup_commit_reference_by_name(name);
+
+		if (!c)
+			die(_("failed to find '%s'"), name);
+		base_pos[i] = ahead_behind_position(&positions, &commits,
+						    &commits_nr, &commits_alloc, c);
+	}
+
+	FREE_AND_NULL(array->counts);
+	array->counts_nr = 0;
+	for (i = 0; i < array->nr; i++) {
+		struct ref_array_item *item = array->items[i];
+		const char *branch_name;
+		struct commit *tip;
+		size_t tip_pos;
+
+		tip = lookup_commit_reference_gently(r, &item->objectname, 1);
+		if (!tip)
+			continue;
+		tip_pos = ahead_behind_position(&positions, &commits,
+						&commits_nr, &commits_alloc, tip);
+
+		if (bases_nr) {
+			FREE_AND_NULL(item->counts);
+			CALLOC_ARRAY(item->counts, bases_nr);
+		}
+		for (j = 0; j < bases_nr; j++)
+			add_ahead_behind_count(array, &dests, &counts_alloc,
+					       tip_pos, base_pos[j],
+					       &item->counts[j]);
+
+		if (!skip_prefix(item->refname, "refs/heads/", &branch_name))
+			continue;
+		for (k = 0; k < 2; k++) {
+			struct commit *base;
+
+			if (!need_tracking[k])
+				continue;
+			base = tracking_commit(r, branch_name, k);
+			if (!base)
+				continue;
+			add_ahead_behind_count(array, &dests, &counts_alloc, tip_pos,
+					       ahead_behind_position(&positions, &commits,
+								     &commits_nr, &commits_alloc,
+								     base),
+					       &item->tracking_counts[k]);
+		}
+	}
+
+	ahead_behind(r, commits, commits_nr, array->counts, array->counts_nr);
+
+	/* Only now that "counts" no longer moves can we point into it. */
+	for (i = 0; i < array->counts_nr; i++)
+		*dests[i] = &array->counts[i];
+
+	free(dests);
+	free(base_pos);
+	free(commits);
+	clear_commit_position(&positions);
+}
+
 static int compare_detached_head(struct ref_array_item *a, struct ref_array_item *b)
 {
 	if (!(a->kind ^ b->kind))
@@ -6,6 +6,8 @@
 #include "commit.h"
 #include "parse-options.h"
 
+struct ahead_behind_count;
+
 /* Quoting styles */
 #define QUOTE_NONE 0
 #define QUOTE_SHELL 1
@@ -43,6 +45,14 @@ struct ref_array_item {
 	const char *symref;
 	struct commit *commit;
 	struct atom_value *value;
+	/*
+	 * Filled in by filter_ahead_behind(): one count per
+	 * %(ahead-behind:<committish>) base, and the counts against
+	 * the upstream and push tracking refs (in that order), if
+	 * %(upstream:track) or %(push:track) are in use.
+	 */
+	struct ahead_behind_count **counts;
+	struct ahead_behind_count *tracking_counts[2];
 	char refname[FLEX_ARRAY];
 };
 
@@ -50,6 +60,9 @@ struct ref_array {
 	int nr, alloc;
 	struct ref_array_item **items;
 	struct rev_info *revs;
+
+	struct ahead_behind_count *counts;
+	size_t counts_nr;
 };
 
 struct ref_filter {
@@ -106,6 +119,14 @@ struct ref_format {
  * filtered refs in the ref_array structure.
  */
 int filter_refs(struct ref_array *array, struct ref_filter *filter, unsigned int type);
+/*
+ * Compute, in a single commit walk, the ahead/behind counts that the
+ * format needs for all refs in the array: those of the
+ * %(ahead-behind:<committish>) atoms and those of %(upstream:track)
+ * and %(push:track). Call after filter_refs() and verify_ref_format();
+ * without it, tracking info is computed one ref at a time instead.
+ */
+void filter_ahead_behind(struct repository *r, struct ref_array *array);
 /*  Clear all memory allocated to ref_array */
 void ref_array_clear(struct ref_array *array);
 /*  Used to verify if the given format is correct and to parse out the used atoms */
@@ -49,6 +49,8 @@ void prepare_repo_settings(struct repository *r)
 			r->settings.fetch_negotiation_algorithm = FETCH_NEGOTIATION_SKIPPING;
 		else if (!strcasecmp(strval, "noop"))
 			r->settings.fetch_negotiation_algorithm = FETCH_NEGOTIATION_NOOP;
+		else if (!strcasecmp(strval, "generation"))
+			r->settings.fetch_negotiation_algorithm = FETCH_NEGOTIATION_GENERATION;
 		else
 			r->settings.fetch_negotiation_algorithm = FETCH_NEGOTIATION_DEFAULT;
 	}
@@ -57,6 +59,10 @@ void prepare_repo_settings(struct repository *r)
 		r->settings.pack_use_sparse = value;
 	UPDATE_DEFAULT_BOOL(r->settings.pack_use_sparse, 1);
 
+	if (!repo_config_get_bool(r, "pack.usebitmapreachability", &value))
+		r->settings.pack_use_bitmap_reachability = value;
+	UPDATE_DEFAULT_BOOL(r->settings.pack_use_bitmap_reachability, 0);
+
 	value = git_env_bool(GIT_TEST_MULTI_PACK_INDEX, 0);
 	if (value || !repo_config_get_bool(r, "core.multipackindex", &value))
 		r->settings.core_multi_pack_index = value;
@@ -26,6 +26,7 @@ enum fetch_negotiation_setting {
 	FETCH_NEGOTIATION_DEFAULT = 1,
 	FETCH_NEGOTIATION_SKIPPING = 2,
 	FETCH_NEGOTIATION_NOOP = 3,
+	FETCH_NEGOTIATION_GENERATION = 4,
 };
 
 struct repo_settings {
@@ -42,6 +43,7 @@ struct repo_settings {
 	enum untracked_cache_setting core_untracked_cache;
 
 	int pack_use_sparse;
+	int pack_use_bitmap_reachability;
 	enum fetch_negotiation_setting fetch_negotiation_algorithm;
 
 	int core_multi_pack_index;
@@ -648,13 +648,17 @@ static void trace2_bloom_filter_statistics_atexit(void)
 
 static int forbid_bloom_filters(struct pathspec *spec)
 {
-	if (spec->has_wildcard)
-		return 1;
-	if (spec->nr > 1)
-		return 1;
-	if (spec->magic & ~PATHSPEC_LITERAL)
-		return 1;
-	if (spec->nr && (spec->items[0].magic & ~PATHSPEC_LITERAL))
+	int i, nr = 0;
+
+	for (i = 0; i < spec->nr; i++) {
+		/* excluded paths can only make the commit TREESAME */
+		if (spec->items[i].magic & PATHSPEC_EXCLUDE)
+			continue;
+		if (!pathspec_item_leading_path_len(&spec->items[i]))
+			return 1;
+		nr++;
+	}
+	if (spec->nr && !nr)
 		return 1;
 
 	return 0;
@@ -662,11 +666,8 @@ static int forbid_bloom_filters(struct pathspec *spec)
 
 static void prepare_to_use_bloom_filter(struct rev_info *revs)
 {
-	struct pathspec_item *pi;
-	char *path_alloc = NULL;
-	const char *path, *p;
-	size_t len;
-	int path_component_nr = 1;
+	struct pathspec *spec = &revs->pruning.pathspec;
+	int i;
 
 	if (!revs->commits)
 		return;
@@ -680,66 +681,44 @@ static void prepare_to_use_bloom_filter(struct rev_info *revs)
 	if (!revs->bloom_filter_settings)
 		return;
 
-	if (!revs->pruning.pathspec.nr)
-		return;
-
-	pi = &revs->pruning.pathspec.items[0];
-
-	/* remove single trailing slash from path, if needed */
-	if (pi->len > 0 && pi->match[pi->len - 1] == '/') {
-		path_alloc = xmemdupz(pi->match, pi->len - 1);
-		path = path_alloc;
-	} else
-		path = pi->match;
-
-	len = strlen(path);
-	if (!len) {
-		revs->bloom_filter_settings = NULL;
-		free(path_alloc);
+	if (!spec->nr)
 		return;
-	}
-
-	p = path;
-	while (*p) {
-		/*
-		 * At this point, the path is normalized to use Unix-style
-		 * path separators. This is required due to how the
-		 * changed-path Bloom filters store the paths.
-		 */
-		if (*p == '/')
-			path_component_nr++;
-		p++;
-	}
-
-	revs->bloom_keys_nr = path_component_nr;
-	ALLOC_ARRAY(revs->bloom_keys, revs->bloom_keys_nr);
 
-	fill_bloom_key(path, len, &revs->bloom_keys[0],
-		       revs->bloom_filter_settings);
-	path_component_nr = 1;
+	/*
+	 * At this point, the paths are normalized to use Unix-style
+	 * path separators. This is required due to how the
+	 * changed-path Bloom filters store the paths.
+	 *
+	 * A commit may touch the pathspec if its filter contains all
+	 * the keys of any of the vectors. For items with wildcards,
+	 * only the leading directories before the first wildcard are
+	 * used, as those are the keys the filters are guaranteed to
+	 * have.
+	 */
+	ALLOC_ARRAY(revs->bloom_keyvecs, spec->nr);
+	for (i = 0; i < spec->nr; i++) {
+		const struct pathspec_item *pi = &spec->items[i];
 
-	p = path + len - 1;
-	while (p > path) {
-		if (*p == '/')
-			fill_bloom_key(path, p - path,
-				       &revs->bloom_keys[path_component_nr++],
-				       revs->bloom_filter_settings);
-		p--;
+		if (pi->magic & PATHSPEC_EXCLUDE)
+			continue;
+		revs->bloom_keyvecs[revs->bloom_keyvecs_nr++] =
+			bloom_keyvec_new(pi->match,
+					 pathspec_item_leading_path_len(pi),
+					 revs->bloom_filter_settings);
 	}
 
 	if (trace2_is_enabled() && !bloom_filter_atexit_registered) {
 		atexit(trace2_bloom_filter_statistics_atexit);
 		bloom_filter_atexit_registered = 1;
 	}
-
-	free(path_alloc);
 }
 
 static int check_maybe_different_in_bloom_filter(struct rev_info *revs,
-						 struct commit *commit)
+						 struct commit *commit,
+						 int nth_parent)
 {
 	struct bloom_filter *filter;
-	int result = 1, j;
+	int result = 0, j;
 
 	if (!revs->repo->objects->commit_graph)
 		return -1;
@@ -747,17 +726,19 @@ static int check_maybe_different_in_bloom_filter(struct rev_info *revs,
 	if (commit_graph_generation(commit) == GENERATION_NUMBER_INFINITY)
 		return -1;
 
-	filter = get_bloom_filter(revs->repo, commit);
+	filter = get_parent_bloom_filter(revs->repo, commit, nth_parent);
 
 	if (!filter) {
-		count_bloom_filter_not_present++;
+		/* filters for later parents of merges are optional */
+		if (!nth_parent)
+			count_bloom_filter_not_present++;
 		return -1;
 	}
 
-	for (j = 0; result && j < revs->bloom_keys_nr; j++) {
-		result = bloom_filter_contains(filter,
-					       &revs->bloom_keys[j],
-					       revs->bloom_filter_settings);
+	for (j = 0; !result && j < revs->bloom_keyvecs_nr; j++) {
+		result = bloom_filter_contains_vec(filter,
+						   revs->bloom_keyvecs[j],
+						   revs->bloom_filter_settings);
 	}
 
 	if (result)
@@ -798,8 +779,9 @@ static int rev_compare_tree(struct rev_info *revs,
 			return REV_TREE_SAME;
 	}
 
-	if (revs->bloom_keys_nr && !nth_parent) {
-		bloom_ret = check_maybe_different_in_bloom_filter(revs, commit);
+	if (revs->bloom_keyvecs_nr) {
+		bloom_ret = check_maybe_different_in_bloom_filter(revs, commit,
+								  nth_parent);
 
 		if (bloom_ret == 0)
 			return REV_TREE_SAME;
@@ -809,9 +791,8 @@ static int rev_compare_tree(struct rev_info *revs,
 	revs->pruning.flags.has_changes = 0;
 	diff_tree_oid(&t1->object.oid, &t2->object.oid, "", &revs->pruning);
 
-	if (!nth_parent)
-		if (bloom_ret == 1 && tree_difference == REV_TREE_SAME)
-			count_bloom_filter_false_positive++;
+	if (bloom_ret == 1 && tree_difference == REV_TREE_SAME)
+		count_bloom_filter_false_positive++;
 
 	return tree_difference;
 }
@@ -2256,6 +2237,12 @@ static int handle_revision_opt(struct rev_info *revs, int argc, const char **arg
 	} else if (!strcmp(arg, "--author-date-order")) {
 		revs->sort_order = REV_SORT_BY_AUTHOR_DATE;
 		revs->topo_order = 1;
+	} else if ((argcount = parse_long_opt("write-continuation", argv, &optarg))) {
+		revs->write_continuation = optarg;
+		return argcount;
+	} else if ((argcount = parse_long_opt("continue-from", argv, &optarg))) {
+		revs->continue_from = optarg;
+		return argcount;
 	} else if (!strcmp(arg, "--early-output")) {
 		revs->early_output = 100;
 		revs->topo_order = 1;
@@ -2885,6 +2872,20 @@ int setup_revisions(int argc, const char **argv, struct rev_info *revs, struct s
 		die("cannot combine --walk-reflogs with --graph");
 	if (revs->no_walk && revs->graph)
 		die("cannot combine --no-walk with --graph");
+
+	if (revs->write_continuation || revs->continue_from) {
+		const char *opt = revs->write_continuation ?
+			"--write-continuation" : "--continue-from";
+
+		if (!revs->topo_order)
+			die("%s requires --topo-order, --date-order or --author-date-order", opt);
+		if (revs->graph)
+			die("cannot combine %s with --graph", opt);
+		if (revs->reverse)
+			die("cannot combine %s with --reverse", opt);
+		if (revs->boundary)
+			die("cannot combine %s with --boundary", opt);
+	}
 	if (!revs->reflog_info && revs->grep_filter.use_reflog_filter)
 		die("cannot use --grep-reflog without --walk-reflogs");
 
@@ -3476,19 +3477,34 @@ static void init_topo_walk(struct rev_info *revs)
 	}
 	compute_indegrees_to_depth(revs, info->min_generation);
 
-	for (list = revs->commits; list; list = list->next) {
-		struct commit *c = list->item;
+	if (revs->continue_from) {
+		/*
+		 * Queue the tips in the same order as the walk that saved
+		 * them did, so that ties are broken the same way.
+		 */
+		for (list = revs->continuation_tips; list; list = list->next) {
+			struct commit *c = list->item;
 
-		if (*(indegree_slab_at(&info->indegree, c)) == 1)
-			prio_queue_put(&info->topo_queue, c);
-	}
+			if (*(indegree_slab_at(&info->indegree, c)) == 1)
+				prio_queue_put(&info->topo_queue, c);
+		}
+		free_commit_list(revs->continuation_tips);
+		revs->continuation_tips = NULL;
+	} else {
+		for (list = revs->commits; list; list = list->next) {
+			struct commit *c = list->item;
 
-	/*
-	 * This is unfortunate; the initial tips need to be shown
-	 * in the order given from the revision traversal machinery.
-	 */
-	if (revs->sort_order == REV_SORT_IN_GRAPH_ORDER)
-		prio_queue_reverse(&info->topo_queue);
+			if (*(indegree_slab_at(&info->indegree, c)) == 1)
+				prio_queue_put(&info->topo_queue, c);
+		}
+
+		/*
+		 * This is unfortunate; the initial tips need to be shown
+		 * in the order given from the revision traversal machinery.
+		 */
+		if (revs->sort_order == REV_SORT_IN_GRAPH_ORDER)
+			prio_queue_reverse(&info->topo_queue);
+	}
 
 	if (trace2_is_enabled() && !topo_walk_atexit_registered) {
 		atexit(trace2_topo_walk_statistics_atexit);
@@ -3550,6 +3566,128 @@ static void expand_topo_walk(struct rev_info *revs, struct commit *commit)
 	}
 }
 
+#define CONTINUATION_SIGNATURE "topo-continuation 1"
+
+static const char *sort_order_name(enum rev_sort_order order)
+{
+	switch (order) {
+	case REV_SORT_BY_COMMIT_DATE:
+		return "date";
+	case REV_SORT_BY_AUTHOR_DATE:
+		return "author-date";
+	default:
+		return "graph";
+	}
+}
+
+static int compare_queue_entry_ctr(const void *a_, const void *b_)
+{
+	const struct prio_queue_entry *a = a_, *b = b_;
+
+	return a->ctr < b->ctr ? -1 : a->ctr > b->ctr;
+}
+
+/*
+ * The commits that the topo walk has yet to show are exactly the
+ * (interesting) ancestors of those in its topo_queue: each of them has
+ * had all of its children shown. A walk started from these commits, with
+ * the same negative revisions, therefore picks up where this one stopped,
+ * provided that they are queued in the same order again.
+ */
+static void write_continuation(struct rev_info *revs)
+{
+	struct topo_walk_info *info = revs->topo_walk_info;
+	struct prio_queue_entry *tips;
+	struct strbuf buf = STRBUF_INIT;
+	int i, nr = info->topo_queue.nr;
+
+	ALLOC_ARRAY(tips, nr);
+	COPY_ARRAY(tips, info->topo_queue.array, nr);
+	/* a queue without compare function is a stack, kept in order */
+	if (info->topo_queue.compare)
+		QSORT(tips, nr, compare_queue_entry_ctr);
+
+	strbuf_addf(&buf, "%s\norder %s\n", CONTINUATION_SIGNATURE,
+		    sort_order_name(revs->sort_order));
+	for (i = 0; i < nr; i++) {
+		struct commit *c = tips[i].data;
+
+		if (c->object.flags & UNINTERESTING)
+			continue;
+		strbuf_addf(&buf, "%s\n", oid_to_hex(&c->object.oid));
+	}
+	write_file_buf(revs->write_continuation, buf.buf, buf.len);
+
+	strbuf_release(&buf);
+	free(tips);
+}
+
+static void read_continuation(struct rev_info *revs)
+{
+	struct strbuf buf = STRBUF_INIT;
+	struct commit_list **tail = &revs->continuation_tips;
+	const char *p, *order;
+
+	if (strbuf_read_file(&buf, revs->continue_from, 0) < 0)
+		die_errno(_("could not read '%s'"), revs->continue_from);
+	if (!skip_prefix(buf.buf, CONTINUATION_SIGNATURE "\norder ", &p))
+		die(_("'%s' does not look like a saved walk"), revs->continue_from);
+
+	order = sort_order_name(revs->sort_order);
+	if (!skip_prefix(p, order, &p) || *p++ != '\n')
+		die(_("'%s' was not saved by a walk in %s order"),
+		    revs->continue_from, order);
+
+	while (*p) {
+		struct object_id oid;
+		struct commit *c;
+
+		if (parse_oid_hex_algop(p, &oid, &p, revs->repo->hash_algo) ||
+		    *p++ != '\n')
+			die(_("'%s' does not look like a saved walk"),
+			    revs->continue_from);
+		c = lookup_commit_reference(revs->repo, &oid);
+		if (!c)
+			die(_("'%s' refers to missing commit %s"),
+			    revs->continue_from, oid_to_hex(&oid));
+		tail = &commit_list_insert(c, tail)->next;
+	}
+
+	strbuf_release(&buf);
+}
+
+/*
+ * Replace the positive tips of the walk by those saved in the
+ * continuation file; the negative ones are kept from the command line.
+ */
+static void use_continuation_tips(struct rev_info *revs)
+{
+	struct commit_list **pp = &revs->commits;
+	struct commit_list *list;
+
+	read_continuation(revs);
+
+	while (*pp) {
+		struct commit_list *entry = *pp;
+
+		if (entry->item->object.flags & UNINTERESTING) {
+			pp = &entry->next;
+			continue;
+		}
+		entry->item->object.flags &= ~SEEN;
+		*pp = entry->next;
+		free(entry);
+	}
+	for (list = revs->continuation_tips; list; list = list->next) {
+		struct commit *c = list->item;
+
+		if (c->object.flags & SEEN)
+			continue;
+		c->object.flags |= SEEN;
+		pp = commit_list_append(c, pp);
+	}
+}
+
 int prepare_revision_walk(struct rev_info *revs)
 {
 	int i;
@@ -3572,6 +3710,14 @@ int prepare_revision_walk(struct rev_info *revs)
 	}
 	object_array_clear(&old_pending);
 
+	if (revs->write_continuation || revs->continue_from) {
+		if (revs->limited || revs->no_walk || revs->reflog_info)
+			die(_("saving and resuming a walk needs a commit-graph, "
+			      "and cannot be used with history-limiting options"));
+		if (revs->continue_from)
+			use_continuation_tips(revs);
+	}
+
 	/* Signal whether we need per-parent treesame decoration */
 	if (revs->simplify_merges ||
 	    (revs->limited && limiting_can_increase_treesame(revs)))
@@ -4128,6 +4274,8 @@ static struct commit *get_revision_internal(struct rev_info *revs)
 
 	if (c)
 		c->object.flags |= SHOWN;
+	else if (revs->write_continuation && revs->topo_walk_info)
+		write_continuation(revs);
 
 	if (!revs->boundary)
 		return c;
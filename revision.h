@@ -307,10 +307,22 @@ struct rev_info {
 
 	struct topo_walk_info *topo_walk_info;
 
+	/*
+	 * Where the state of the topo walk is saved when it stops, and
+	 * read back from, to pick the walk up where an earlier one left
+	 * off (--write-continuation and --continue-from).
+	 */
+	const char *write_continuation;
+	const char *continue_from;
+	struct commit_list *continuation_tips;
+
 	/* Commit graph bloom filter fields */
-	/* The bloom filter key(s) for the pathspec */
-	struct bloom_key *bloom_keys;
-	int bloom_keys_nr;
+	/*
+	 * The bloom filter keys for the pathspec, one vector for each of
+	 * its (non-excluding) items.
+	 */
+	struct bloom_keyvec **bloom_keyvecs;
+	int bloom_keyvecs_nr;
 
 	/*
 	 * The bloom filter settings used to generate the key.
@@ -394,6 +394,21 @@ void expand_to_pattern_list(struct index_state *istate,
 	cache_tree_free(&istate->cache_tree);
 	cache_tree_update(istate, WRITE_TREE_MISSING_OK);
 
+	/*
+	 * Count the full expansions done by this process, so that traces
+	 * show how often a command falls back to a full index.
+	 */
+	if (!pl) {
+		static intmax_t nr_full_expansions;
+
+		trace2_data_intmax("index", istate->repo,
+				   "ensure_full_index/count",
+				   ++nr_full_expansions);
+		trace2_data_intmax("index", istate->repo,
+				   "ensure_full_index/entries",
+				   istate->cache_nr);
+	}
+
 	trace2_region_leave("index",
 			    pl ? "expand_to_pattern_list" : "ensure_full_index",
 			    istate->repo);
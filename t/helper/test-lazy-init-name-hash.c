@@ -1,6 +1,7 @@
 #include "test-tool.h"
 #include "cache.h"
 #include "parse-options.h"
+#include "thread-utils.h"
 
 static int single;
 static int multi;
@@ -9,6 +10,8 @@ static int dump;
 static int perf;
 static int analyze;
 static int analyze_step;
+static int lookup;
+static int nr_lookup_threads;
 
 /*
  * Dump the contents of the "dir" and "name" hash tables to stdout.
@@ -52,6 +55,98 @@ static void dump_run(void)
 	discard_cache();
 }
 
+struct lookup_thread_data {
+	pthread_t pthread;
+	int k_start;
+	int k_end;
+};
+
+static int has_entry(struct cache_entry *ce)
+{
+	struct cache_entry *found;
+
+	found = index_file_exists(&the_index, ce->name, ce_namelen(ce), 1);
+	while (found && found != ce)
+		found = index_file_next_match(&the_index, found, 1);
+	return !!found;
+}
+
+/*
+ * Check that each entry of our part of the index and its directory are
+ * found, then look up all the entries of the index, while the other
+ * threads do the same.
+ */
+static void *lookup_thread_proc(void *_data)
+{
+	struct lookup_thread_data *d = _data;
+	int k;
+
+	for (k = d->k_start; k < d->k_end; k++) {
+		struct cache_entry *ce = the_index.cache[k];
+		const char *slash = strrchr(ce->name, '/');
+
+		if (!has_entry(ce))
+			die("entry '%s' is not hashed", ce->name);
+		if (slash &&
+		    !index_dir_exists(&the_index, ce->name, slash - ce->name))
+			die("directory of '%s' is not hashed", ce->name);
+	}
+
+	for (k = 0; k < the_index.cache_nr; k++) {
+		struct cache_entry *ce = the_index.cache[k];
+
+		index_file_exists(&the_index, ce->name, ce_namelen(ce), 1);
+	}
+
+	return NULL;
+}
+
+/*
+ * Look up names in the hash tables from "nr_lookup_threads" threads at
+ * the same time "count" times and report on the time taken.
+ */
+static void lookup_runs(void)
+{
+	struct lookup_thread_data *td;
+	uint64_t t0, t1;
+	int nr_each, i, t;
+
+	CALLOC_ARRAY(td, nr_lookup_threads);
+
+	for (i = 0; i < count; i++) {
+		read_cache();
+		prepare_name_hash(&the_index);
+
+		nr_each = DIV_ROUND_UP(the_index.cache_nr, nr_lookup_threads);
+		t0 = getnanotime();
+		for (t = 0; t < nr_lookup_threads; t++) {
+			td[t].k_start = t * nr_each;
+			td[t].k_end = td[t].k_start + nr_each;
+			if (td[t].k_end > the_index.cache_nr)
+				td[t].k_end = the_index.cache_nr;
+			if (td[t].k_start > td[t].k_end)
+				td[t].k_start = td[t].k_end;
+			if (pthread_create(&td[t].pthread, NULL,
+					   lookup_thread_proc, &td[t]))
+				die("unable to create lookup thread");
+		}
+		for (t = 0; t < nr_lookup_threads; t++)
+			if (pthread_join(td[t].pthread, NULL))
+				die("unable to join lookup thread");
+		t1 = getnanotime();
+
+		printf("%f %d lookup %d\n",
+		       ((double)(t1 - t0))/1000000000,
+		       the_index.cache_nr,
+		       nr_lookup_threads);
+		fflush(stdout);
+
+		discard_cache();
+	}
+
+	free(td);
+}
+
 /*
  * Run the single or multi threaded version "count" times and
  * report on the time taken.
@@ -189,6 +284,7 @@ int cmd__lazy_init_name_hash(int argc, const char **argv)
 		"test-tool lazy-init-name-hash -a a [--step s] [-c c]",
 		"test-tool lazy-init-name-hash (-s | -m) [-c c]",
 		"test-tool lazy-init-name-hash -s -m [-c c]",
+		"test-tool lazy-init-name-hash -l [-t t] [-c c]",
 		NULL
 	};
 	struct option options[] = {
@@ -199,6 +295,9 @@ int cmd__lazy_init_name_hash(int argc, const char **argv)
 		OPT_BOOL('p', "perf", &perf, "compare single vs multi"),
 		OPT_INTEGER('a', "analyze", &analyze, "analyze different multi sizes"),
 		OPT_INTEGER(0, "step", &analyze_step, "analyze step factor"),
+		OPT_BOOL('l', "lookup", &lookup, "run concurrent lookups"),
+		OPT_INTEGER('t', "threads", &nr_lookup_threads,
+			    "number of lookup threads"),
 		OPT_END(),
 	};
 	const char *prefix;
@@ -213,6 +312,17 @@ int cmd__lazy_init_name_hash(int argc, const char **argv)
 	 */
 	ignore_case = 1;
 
+	if (lookup) {
+		if (dump || perf || analyze > 0 || single || multi)
+			die("cannot combine lookup with other modes");
+		if (!nr_lookup_threads)
+			nr_lookup_threads = online_cpus();
+		if (nr_lookup_threads < 1)
+			die("number of lookup threads must be positive");
+		lookup_runs();
+		return 0;
+	}
+
 	if (dump) {
 		if (perf || analyze > 0)
 			die("cannot combine dump, perf, or analyze");
@@ -43,6 +43,12 @@ int cmd__read_graph(int argc, const char **argv)
 		printf(" bloom_indexes");
 	if (graph->chunk_bloom_data)
 		printf(" bloom_data");
+	if (graph->chunk_bloom_merge_indexes)
+		printf(" bloom_merge_indexes");
+	if (graph->chunk_bloom_merge_data)
+		printf(" bloom_merge_data");
+	if (graph->chunk_first_parent_jumps)
+		printf(" first_parent_jumps");
 	printf("\n");
 
 	UNLEAK(graph);
@@ -1,7 +1,7 @@
 # Helpers for tests invoking parallel-checkout
 
 # Parallel checkout tests need full control of the number of workers
-unset GIT_TEST_CHECKOUT_WORKERS
+unset GIT_TEST_CHECKOUT_WORKERS GIT_TEST_CHECKOUT_THREADS
 
 set_checkout_config () {
 	if test $# -ne 2
@@ -13,7 +13,8 @@ set_checkout_config () {
 	test_config_global checkout.thresholdForParallelism $2
 }
 
-# Run "${@:2}" and check that $1 checkout workers were used
+# Run "${@:2}" and check that $1 checkout workers were used, be they
+# processes or threads
 test_checkout_workers () {
 	if test $# -lt 2
 	then
@@ -24,12 +25,14 @@ test_checkout_workers () {
 	shift &&
 
 	local trace_file=trace-test-checkout-workers &&
-	rm -f "$trace_file" &&
-	GIT_TRACE2="$(pwd)/$trace_file" "$@" 2>&8 &&
+	rm -f "$trace_file" "$trace_file.event" &&
+	GIT_TRACE2="$(pwd)/$trace_file" \
+	GIT_TRACE2_EVENT="$(pwd)/$trace_file.event" "$@" 2>&8 &&
 
 	local workers="$(grep "child_start\[..*\] git checkout--worker" "$trace_file" | wc -l)" &&
-	test $workers -eq $expected_workers &&
-	rm "$trace_file"
+	local threads="$(grep "\"thread_start\".*:checkout-worker\"" "$trace_file.event" | wc -l)" &&
+	test $((workers + threads)) -eq $expected_workers &&
+	rm "$trace_file" "$trace_file.event"
 } 8>&2 2>&4
 
 # Verify that both the working tree and the index were created correctly
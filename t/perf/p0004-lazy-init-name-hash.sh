@@ -53,4 +53,8 @@ test_perf REPO_BIG_ENOUGH_FOR_MULTI "multi-threaded, $desc" "
 	test-tool lazy-init-name-hash --multi --count=$count
 "
 
+test_perf "concurrent lookups, $desc" "
+	test-tool lazy-init-name-hash --lookup --count=$count
+"
+
 test_done
@@ -54,6 +54,15 @@ test_perf "switch between br_base br_ballast ($nr_files)" '
 	git checkout -q br_ballast
 '
 
+test_perf "switch between br_base br_ballast, single-threaded ($nr_files)" '
+	git -c index.threads=1 checkout -q br_base &&
+	git -c index.threads=1 checkout -q br_ballast
+'
+
+test_perf "read-tree -m br_base br_ballast, single-threaded ($nr_files)" '
+	git -c index.threads=1 read-tree -m br_base br_ballast -n
+'
+
 test_perf "switch between br_ballast br_ballast_plus_1 ($nr_files)" '
 	git checkout -q br_ballast_plus_1 &&
 	git checkout -q br_ballast
@@ -0,0 +1,35 @@
+#!/bin/sh
+
+test_description="Tests performance of updating the cache-tree"
+
+. ./perf-lib.sh
+
+test_perf_default_repo
+
+test_expect_success 'set up thread-counting tests' '
+	t=$(test-tool online-cpus) &&
+	threads= &&
+	while test $t -gt 1
+	do
+		threads="$t $threads"
+		t=$((t / 2))
+	done &&
+	nr_files=$(git ls-files | wc -l)
+'
+
+test_perf "write-tree after dropping the cache-tree, 1 thread ($nr_files files)" '
+	test-tool scrap-cache-tree &&
+	git -c index.threads=1 write-tree
+'
+
+for t in $threads
+do
+	THREADS=$t
+	export THREADS
+	test_perf "write-tree after dropping the cache-tree, $t threads ($nr_files files)" '
+		test-tool scrap-cache-tree &&
+		git -c index.threads=$THREADS write-tree
+	'
+done
+
+test_done
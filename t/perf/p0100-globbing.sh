@@ -40,4 +40,57 @@ do
 	'
 done
 
+test_expect_success 'setup many files and patterns' '
+	for d in $(test_seq 1 50)
+	do
+		mkdir -p dir$d &&
+		for f in $(test_seq 1 100)
+		do
+			>dir$d/file$f.c &&
+			>dir$d/file$f.o || return 1
+		done
+	done &&
+	for n in $(test_seq 1 2000)
+	do
+		case $((n % 4)) in
+		0) echo "*.ext$n" ;;
+		1) echo "generated$n.h" ;;
+		2) echo "/build$n/" ;;
+		3) echo "dir$((n % 50))/file$n.tmp" ;;
+		esac || return 1
+	done >many-patterns &&
+	echo "*.o" >>many-patterns &&
+	test_seq 1 50 | sed "s|.*|/dir&/|" >sparse-patterns &&
+	cat many-patterns >>sparse-patterns &&
+	echo "!*.o" >>sparse-patterns
+'
+
+for n in 10 100 1000 2001
+do
+	test_expect_success "setup .gitignore with $n patterns" '
+		head -n '$n' many-patterns >.gitignore
+	'
+
+	test_perf "ls-files -o --exclude-standard, $n patterns" '
+		git ls-files -o --exclude-standard >/dev/null
+	'
+
+	test_perf "status --ignored, $n patterns" '
+		git status --ignored --porcelain >/dev/null
+	'
+done
+
+test_expect_success 'setup non-cone sparse-checkout' '
+	rm .gitignore &&
+	git add dir* &&
+	git commit -q -m files &&
+	git config core.sparseCheckout true &&
+	git config core.sparseCheckoutCone false &&
+	cp sparse-patterns .git/info/sparse-checkout
+'
+
+test_perf 'read-tree with many non-cone sparse patterns' '
+	git read-tree -mu HEAD
+'
+
 test_done
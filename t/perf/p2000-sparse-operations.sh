@@ -110,5 +110,16 @@ test_perf_on_all git add -A
 test_perf_on_all git add .
 test_perf_on_all git commit -a -m A
 test_perf_on_all git checkout -f -
+test_perf_on_all git ls-files --sparse
+test_perf_on_all git grep --cached bogus -- "f2/f1/f1/*"
+test_perf_on_all git blame $SPARSE_CONE/a
+test_perf_on_all "git rm -f $SPARSE_CONE/a && git checkout HEAD -- $SPARSE_CONE/a"
+test_perf_on_all "git mv $SPARSE_CONE/a $SPARSE_CONE/b && git mv $SPARSE_CONE/b $SPARSE_CONE/a"
+test_perf_on_all git update-index --add --remove $SPARSE_CONE/a
+test_perf_on_all git update-index --again
+test_perf_on_all git checkout-index -f $SPARSE_CONE/a
+test_perf_on_all "git diff >patch && git apply --cached patch"
+test_perf_on_all "git stash && git stash drop"
+test_perf_on_all "git stash push -- $SPARSE_CONE/a && git stash drop"
 
 test_done
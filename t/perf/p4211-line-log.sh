@@ -31,6 +31,22 @@ test_perf 'git log -L (renames on)' '
 	git log -M -L 1:"$file" >/dev/null
 '
 
+test_expect_success 'write commit-graph with changed-path filters' '
+	git commit-graph write --reachable --changed-paths
+'
+
+test_perf 'git log -L (renames off, changed-path filters)' '
+	git log --no-renames -L 1:"$file" >/dev/null
+'
+
+test_perf 'git log -L (renames on, changed-path filters)' '
+	git log -M -L 1:"$file" >/dev/null
+'
+
+test_expect_success 'remove commit-graph' '
+	rm -f .git/objects/info/commit-graph
+'
+
 test_perf 'git log --oneline --raw --parents' '
 	git log --oneline --raw --parents >/dev/null
 '
@@ -49,6 +49,14 @@ test_perf 'rev-list (objects)' '
 	git rev-list --all --use-bitmap-index --objects >/dev/null
 '
 
+test_perf 'for-each-ref --contains (bitmap)' '
+	git -c pack.useBitmapReachability for-each-ref --contains HEAD~1000 >/dev/null
+'
+
+test_perf 'for-each-ref --contains (no bitmap)' '
+	git for-each-ref --contains HEAD~1000 >/dev/null
+'
+
 test_perf 'rev-list with tag negated via --not --all (objects)' '
 	git rev-list perf-tag --not --all --use-bitmap-index --objects >/dev/null
 '
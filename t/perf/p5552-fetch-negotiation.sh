@@ -0,0 +1,69 @@
+#!/bin/sh
+
+test_description='performance of fetch negotiation
+
+Simulate clients which are some number of first-parent commits behind the
+server, and which also carry local branches the server has never seen. For
+each negotiation algorithm, measure how long it takes to find the commits in
+common with the server, and how many round trips that needs.
+'
+. ./perf-lib.sh
+
+test_perf_default_repo
+
+test_expect_success 'setup' '
+	git rev-list --first-parent HEAD >first-parent &&
+	server=$(pwd)
+'
+
+for behind in 10 100 1000 10000
+do
+	test_expect_success "setup client $behind commits behind" '
+		tip=$(sed -n "$behind{p;q;}" first-parent) &&
+		tip=${tip:-$(tail -n 1 first-parent)} &&
+		git update-ref refs/heads/perf-behind-$behind $tip &&
+
+		rm -rf client-$behind &&
+		git init --bare client-$behind &&
+		git -C client-$behind remote add origin "$server" &&
+		git -C client-$behind fetch --no-tags origin \
+			refs/heads/perf-behind-$behind:refs/heads/main &&
+
+		# Local work the server does not know about, branching off
+		# at various points of the old history.
+		for i in $(test_seq 50)
+		do
+			base=$(git -C client-$behind rev-parse main~$i) || break
+			commit=$(git -C client-$behind commit-tree \
+					-p $base -m "local $i" $base^{tree}) &&
+			git -C client-$behind update-ref refs/heads/local-$i $commit ||
+			return 1
+		done &&
+		git -C client-$behind commit-graph write --reachable
+	'
+
+	for algorithm in default skipping generation
+	do
+		title="$algorithm, $behind behind"
+
+		test_perf "negotiate ($title)" "
+			git -C client-$behind -c protocol.version=2 \
+				-c fetch.negotiationAlgorithm=$algorithm \
+				fetch --negotiate-only \
+				--negotiation-tip='refs/heads/*' origin >/dev/null
+		"
+
+		test_size "round trips ($title)" "
+			GIT_TRACE_PACKET=\"\$(pwd)/trace-$algorithm-$behind\" \
+			git -C client-$behind -c protocol.version=2 \
+				-c fetch.negotiationAlgorithm=$algorithm \
+				fetch --negotiate-only \
+				--negotiation-tip='refs/heads/*' \
+				--upload-pack='unset GIT_TRACE_PACKET; git-upload-pack' \
+				origin >/dev/null &&
+			grep -c 'fetch> command=fetch' trace-$algorithm-$behind
+		"
+	done
+done
+
+test_done
@@ -0,0 +1,39 @@
+#!/bin/sh
+
+test_description='Tests blame performance on files with a long history'
+. ./perf-lib.sh
+
+test_perf_default_repo
+
+# Pick the file that was touched by the most commits, as that is where
+# blame has to compute the most diffs.
+test_expect_success 'select a file' '
+	git log --format= --name-only --no-renames HEAD -- |
+	sort | uniq -c | sort -rn |
+	while read count name
+	do
+		test -f "$name" && echo "$name" && break
+	done >filelist &&
+	test_line_count = 1 filelist
+'
+
+file=$(cat filelist)
+export file
+
+test_perf 'blame (1 thread)' '
+	git blame --threads=1 -- "$file" >/dev/null
+'
+
+test_perf 'blame (2 threads)' '
+	git blame --threads=2 -- "$file" >/dev/null
+'
+
+test_perf 'blame (4 threads)' '
+	git blame --threads=4 -- "$file" >/dev/null
+'
+
+test_perf 'blame (all CPUs)' '
+	git blame --threads=0 -- "$file" >/dev/null
+'
+
+test_done
@@ -342,6 +342,52 @@ test_expect_success 'query binary macro directly' '
 	test_cmp expect actual
 '
 
+test_expect_success 'names, suffixes and patterns keep their order' '
+	test_when_finished "rm -rf .gitattributes sub" &&
+	mkdir -p sub/dir &&
+	cat >.gitattributes <<-\EOF &&
+	*.c test=suffix
+	x.c test=name
+	*.tar.gz test=long-suffix
+	*.gz test=short-suffix
+	sub/*.c test=sub-glob
+	/sub/dir/y.c test=sub-dir-name
+	sub/x.c test=sub-name
+	dir/*.c test=dir-glob
+	EOF
+	echo "*.c test=nested-suffix" >sub/.gitattributes &&
+	cat >expect <<-\EOF &&
+	x.c: test: name
+	y.c: test: suffix
+	a.tar.gz: test: short-suffix
+	tar.gz: test: short-suffix
+	sub/x.c: test: nested-suffix
+	sub/dir/x.c: test: nested-suffix
+	sub/dir/y.c: test: nested-suffix
+	sub/dir/z.gz: test: short-suffix
+	dir/x.c: test: dir-glob
+	EOF
+	sed "s/: test: .*//" expect >paths &&
+	git check-attr --stdin test <paths >actual &&
+	test_cmp expect actual &&
+	rm sub/.gitattributes &&
+	cat >expect <<-\EOF &&
+	x.c: test: name
+	X.C: test: unspecified
+	sub/x.c: test: sub-name
+	sub/y.c: test: sub-glob
+	sub/dir/y.c: test: sub-dir-name
+	sub/dir/x.c: test: name
+	dir/y.c: test: dir-glob
+	EOF
+	sed "s/: test: .*//" expect >paths &&
+	git check-attr --stdin test <paths >actual &&
+	test_cmp expect actual &&
+	echo "X.C: test: name" >expect &&
+	git -c core.ignorecase=true check-attr test X.C >actual &&
+	test_cmp expect actual
+'
+
 test_expect_success SYMLINKS 'set up symlink tests' '
 	echo "* test" >attr &&
 	rm -f .gitattributes
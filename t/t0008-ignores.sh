@@ -865,6 +865,49 @@ test_expect_success 'info/exclude trumps core.excludesfile' '
 	test_cmp expect actual
 '
 
+test_expect_success 'long pattern lists keep the order of the patterns' '
+	test_when_finished "rm -rf long .git/info/exclude" &&
+	mkdir -p long/doc/sub long/out &&
+	(
+		for i in $(test_seq 1 20)
+		do
+			echo "unused$i.txt" &&
+			echo "*.unused$i" &&
+			echo "/unused$i/" || return 1
+		done &&
+		cat <<-\EOF
+		*.o
+		!keep.o
+		keep.o.d
+		*.d
+		!*.o.d
+		Makefile
+		/doc/*.html
+		!/doc/index.html
+		doc/sub/
+		out
+		!/out
+		EOF
+	) >long/.gitignore &&
+	cat >expect <<-\EOF &&
+	long/.gitignore:61:*.o	long/x.o
+	long/.gitignore:62:!keep.o	long/keep.o
+	long/.gitignore:65:!*.o.d	long/keep.o.d
+	long/.gitignore:64:*.d	long/x.d
+	long/.gitignore:66:Makefile	long/doc/Makefile
+	long/.gitignore:67:/doc/*.html	long/doc/a.html
+	long/.gitignore:68:!/doc/index.html	long/doc/index.html
+	long/.gitignore:69:doc/sub/	long/doc/sub/index.o
+	long/.gitignore:69:doc/sub/	long/doc/sub
+	long/.gitignore:71:!/out	long/out
+	long/.gitignore:70:out	long/doc/out
+	::	long/sub/a.html
+	EOF
+	cut -f2 expect >paths &&
+	git check-ignore -v -n --no-index --stdin <paths >actual &&
+	test_cmp expect actual
+'
+
 test_expect_success SYMLINKS 'set up ignore file for symlink tests' '
 	echo "*" >ignore &&
 	rm -f .gitignore .git/info/exclude
@@ -276,4 +276,68 @@ test_expect_success 'switching trees does not invalidate shared index' '
 	)
 '
 
+test_expect_success 'invalid subtrees can be updated by threads' '
+	git checkout -b threads no-children &&
+	for d in a b c d
+	do
+		mkdir $d &&
+		echo $d >$d/file &&
+		echo $d >$d/other || return 1
+	done &&
+	git add a b c d &&
+	git commit -m "four directories" &&
+	echo changed >a/file &&
+	echo changed >c/other &&
+	echo new >d/new &&
+	git add a c d &&
+	cp .git/index .git/index.single &&
+	GIT_INDEX_FILE=.git/index.single git -c index.threads=1 write-tree >expect &&
+	GIT_TRACE2_EVENT="$(pwd)/.git/trace.event" \
+		git -c index.threads=4 write-tree >actual &&
+	test_cmp expect actual &&
+	grep "\"key\":\"update_subtrees/threads\"" .git/trace.event &&
+	git commit -m "update subtrees" &&
+	test-tool dump-cache-tree >dump &&
+	! grep invalid dump &&
+	test_line_count = 5 dump
+'
+
+test_expect_success 'unmerged entries below an invalid subtree are noticed' '
+	test_when_finished "git reset --hard" &&
+	blob=$(git rev-parse HEAD:a/file) &&
+	echo changed-again >b/file &&
+	git add b/file &&
+	printf "100644 $blob %d\tc/other\n" 0 1 2 |
+		git update-index --index-info &&
+	test_must_fail git write-tree 2>err &&
+	test_i18ngrep "c/other: unmerged" err
+'
+
+test_expect_success 'missing objects below an invalid subtree are noticed' '
+	test_when_finished "git reset --hard" &&
+	echo changed-again >b/file &&
+	git add b/file &&
+	git update-index --add \
+		--cacheinfo 100644,$(test_oid deadbeef),c/missing &&
+	test_must_fail git -c index.threads=4 write-tree 2>err &&
+	test_i18ngrep "invalid object 100644 $(test_oid deadbeef) for .c/missing." err
+'
+
+test_expect_success 'missing trees below an invalid subtree are rewritten' '
+	test_when_finished "git reset --hard" &&
+	mkdir a/x &&
+	echo x >a/x/file &&
+	git add a/x &&
+	git commit -m "nested directory" &&
+	tree=$(git rev-parse HEAD:a/x) &&
+	loose=.git/objects/$(test_oid_to_path $tree) &&
+	test_path_is_file $loose &&
+	rm $loose &&
+	echo changed-again >a/file &&
+	echo changed-again >c/other &&
+	git add a/file c/other &&
+	git -c index.threads=4 write-tree --missing-ok &&
+	git cat-file -e $tree
+'
+
 test_done
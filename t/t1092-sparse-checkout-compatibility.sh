@@ -786,7 +786,8 @@ test_expect_success 'sparse-index is expanded and converted back' '
 	GIT_TRACE2_EVENT="$(pwd)/trace2.txt" GIT_TRACE2_EVENT_NESTING=10 \
 		git -C sparse-index -c core.fsmonitor="" read-tree -mu HEAD &&
 	test_region index convert_to_sparse trace2.txt &&
-	test_region index ensure_full_index trace2.txt
+	test_region index ensure_full_index trace2.txt &&
+	grep "\"key\":\"ensure_full_index/count\",\"value\":\"1\"" trace2.txt
 '
 
 ensure_not_expanded () {
@@ -907,6 +908,136 @@ test_expect_success 'sparse index is not expanded: sparse-checkout' '
 	ensure_not_expanded sparse-checkout set
 '
 
+test_expect_success 'ls-files, grep and blame' '
+	init_repos &&
+
+	test_all_match git ls-files &&
+	test_sparse_match git ls-files -t &&
+	test_all_match git ls-files --stage folder1 &&
+	test_all_match git ls-files --error-unmatch folder2/a &&
+	test_all_match git grep --cached a &&
+	test_all_match git grep --cached -e a -- folder1 "*/a" &&
+	test_all_match git grep --cached -l -e "^$" -- "folder?/0/*" &&
+	test_sparse_match git grep a &&
+	test_all_match git blame deep/deeper1/deepest/a
+'
+
+test_expect_success 'ls-files --sparse' '
+	init_repos &&
+
+	git -C sparse-index ls-files --sparse >actual &&
+	grep "^folder1/$" actual &&
+	grep "^deep/a$" actual &&
+	! grep "^folder1/a$" actual &&
+
+	# The full index shows files only, with or without --sparse
+	git -C sparse-checkout ls-files --sparse >expect &&
+	git -C sparse-checkout ls-files >actual &&
+	test_cmp expect actual &&
+	git -C sparse-index ls-files >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'rm, mv, apply and update-index' '
+	init_repos &&
+
+	write_script edit-contents <<-\EOF &&
+	echo text >>$1
+	EOF
+
+	test_all_match git rm deep/a &&
+	test_all_match git status --porcelain=v2 &&
+	test_all_match git rm -r --cached deep/deeper2 &&
+	test_all_match git status --porcelain=v2 &&
+	test_sparse_match test_must_fail git rm folder1/a &&
+	test_sparse_match test_must_fail git rm -r folder2 &&
+	test_all_match git reset --hard &&
+
+	test_all_match git mv deep/deeper1 deep/moved &&
+	test_all_match git status --porcelain=v2 &&
+	test_all_match git reset --hard &&
+
+	git -C full-checkout diff update-deep base -- deep >patch &&
+	test_all_match git apply -R --index ../patch &&
+	test_all_match git status --porcelain=v2 &&
+	test_all_match git reset --hard &&
+	git -C full-checkout diff update-folder1 base -- folder1 >patch &&
+	test_all_match git apply -R --cached ../patch &&
+	test_sparse_match git status --porcelain=v2 &&
+	test_all_match git reset --hard &&
+
+	run_on_all ../edit-contents deep/a &&
+	test_all_match git update-index deep/a &&
+	test_all_match git status --porcelain=v2 &&
+	test_all_match git update-index --again &&
+	test_all_match git update-index --again -- folder1 &&
+	test_all_match git status --porcelain=v2 &&
+	test_all_match git reset --hard &&
+
+	test_all_match git checkout-index -f deep/a &&
+	test_all_match git checkout-index -f -a &&
+	test_all_match git status --porcelain=v2
+'
+
+test_expect_success 'stash' '
+	init_repos &&
+
+	write_script edit-contents <<-\EOF &&
+	echo text >>$1
+	EOF
+
+	run_on_all ../edit-contents deep/a &&
+	test_all_match git stash &&
+	test_all_match git status --porcelain=v2 &&
+	test_all_match git stash apply --quiet &&
+	test_all_match git status --porcelain=v2 &&
+	test_all_match git stash push -- deep/a &&
+	test_all_match git status --porcelain=v2 &&
+	test_all_match git stash pop --quiet &&
+	test_all_match test_must_fail git stash push -- deep/no-such-file &&
+	test_all_match git stash list
+'
+
+test_expect_success 'sparse-index is not expanded: index-reading builtins' '
+	init_repos &&
+
+	ensure_not_expanded ls-files --sparse &&
+	ensure_not_expanded ls-files --sparse -t &&
+	ensure_not_expanded grep --cached a &&
+	ensure_not_expanded grep --cached a -- folder1 &&
+	ensure_not_expanded grep a &&
+	ensure_not_expanded blame deep/a &&
+	ensure_not_expanded checkout-index -f deep/a &&
+	ensure_not_expanded -C deep checkout-index -f -a &&
+
+	echo >>sparse-index/deep/a &&
+	ensure_not_expanded update-index deep/a &&
+	ensure_not_expanded update-index --again &&
+	ensure_not_expanded reset --hard &&
+
+	ensure_not_expanded rm deep/a &&
+	ensure_not_expanded rm -r --cached deep/deeper1 &&
+	ensure_not_expanded reset --hard &&
+
+	ensure_not_expanded mv deep/a deep/b &&
+	ensure_not_expanded mv deep/deeper1 deep/moved &&
+	ensure_not_expanded reset --hard &&
+
+	git -C sparse-index diff update-deep base -- deep >patch &&
+	ensure_not_expanded apply -R --index ../patch &&
+	ensure_not_expanded reset --hard &&
+	ensure_not_expanded apply -R --cached ../patch &&
+	ensure_not_expanded reset --hard &&
+
+	echo >>sparse-index/deep/a &&
+	ensure_not_expanded stash &&
+	ensure_not_expanded stash list &&
+	ensure_not_expanded stash show &&
+	echo >>sparse-index/deep/a &&
+	ensure_not_expanded stash push -- deep/a &&
+	ensure_not_expanded ! stash push -- deep/no-such-file
+'
+
 # NEEDSWORK: a sparse-checkout behaves differently from a full checkout
 # in this scenario, but it shouldn't.
 test_expect_success 'reset mixed and checkout orphan' '
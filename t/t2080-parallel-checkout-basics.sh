@@ -104,11 +104,13 @@ test_expect_success 'setup repo for checkout with various types of changes' '
 	)
 '
 
-for mode in sequential parallel sequential-fallback
+for mode in sequential parallel threaded sequential-fallback
 do
+	threads=false
 	case $mode in
 	sequential)          workers=1 threshold=0 expected_workers=0 ;;
 	parallel)            workers=2 threshold=0 expected_workers=2 ;;
+	threaded)            workers=2 threshold=0 expected_workers=2 threads=true ;;
 	sequential-fallback) workers=2 threshold=100 expected_workers=0 ;;
 	esac
 
@@ -126,22 +128,26 @@ do
 		git -C $repo submodule foreach "git update-index --refresh" &&
 
 		set_checkout_config $workers $threshold &&
+		test_config_global checkout.useThreads $threads &&
 		test_checkout_workers $expected_workers \
 			git -C $repo checkout --recurse-submodules B2 &&
 		verify_checkout $repo
 	'
 done
 
-for mode in parallel sequential-fallback
+for mode in parallel threaded sequential-fallback
 do
+	threads=false
 	case $mode in
 	parallel)            workers=2 threshold=0 expected_workers=2 ;;
+	threaded)            workers=2 threshold=0 expected_workers=2 threads=true ;;
 	sequential-fallback) workers=2 threshold=100 expected_workers=0 ;;
 	esac
 
 	test_expect_success "$mode checkout on clone" '
 		repo=various_${mode}_clone &&
 		set_checkout_config $workers $threshold &&
+		test_config_global checkout.useThreads $threads &&
 		test_checkout_workers $expected_workers \
 			git clone --recurse-submodules --branch B2 various $repo &&
 		verify_checkout $repo
@@ -159,6 +165,8 @@ test_expect_success 'compare the working trees' '
 	#
 	git diff --no-index various_sequential various_parallel &&
 	git diff --no-index various_sequential various_parallel_clone &&
+	git diff --no-index various_sequential various_threaded &&
+	git diff --no-index various_sequential various_threaded_clone &&
 	git diff --no-index various_sequential various_sequential-fallback &&
 	git diff --no-index various_sequential various_sequential-fallback_clone
 '
@@ -226,4 +234,41 @@ test_expect_success SYMLINKS 'parallel checkout checks for symlinks in leading d
 	)
 '
 
+test_expect_success SYMLINKS 'threaded checkout checks for symlinks in leading dirs' '
+	set_checkout_config 2 0 &&
+	test_config_global checkout.useThreads true &&
+	(
+		cd symlinks &&
+		rm -rf D &&
+		ln -s untracked D &&
+
+		test_checkout_workers 2 git checkout --force HEAD &&
+		! test -h D &&
+		grep D/A D/A.t &&
+		grep D/B D/B.t
+	)
+'
+
+test_expect_success 'threaded checkout streams large files' '
+	set_checkout_config 2 0 &&
+	test_config_global checkout.useThreads true &&
+	git init large &&
+	(
+		cd large &&
+		echo "* text eol=crlf" >.gitattributes &&
+		test_seq 1 1000 >big &&
+		test_seq 1 10 >small &&
+		git add . &&
+		git commit -m large &&
+		git repack -adq &&
+		rm big small &&
+		test_checkout_workers 2 \
+			git -c core.bigFileThreshold=1k checkout --force HEAD &&
+		git diff --exit-code &&
+		git -c core.bigFileThreshold=1k -c checkout.useThreads=false \
+			cat-file --filters HEAD:big >expect &&
+		test_cmp expect big
+	)
+'
+
 test_done
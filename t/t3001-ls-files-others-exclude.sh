@@ -303,4 +303,34 @@ test_expect_success 'ls-files with "**" patterns and no slashes' '
 	test_must_be_empty actual
 '
 
+test_expect_success 'directories read in parallel give the same result' '
+	test_create_repo preload &&
+	(
+		cd preload &&
+		mkdir -p a/b c/d/e empty &&
+		for d in . a a/b c c/d c/d/e
+		do
+			>$d/tracked &&
+			>$d/untracked.o &&
+			>$d/untracked.c || return 1
+		done &&
+		>c/d/e/.gitignore &&
+		echo "*.o" >.gitignore &&
+		echo "!untracked.o" >c/.gitignore &&
+		mkdir untracked-dir &&
+		>untracked-dir/file &&
+		git add "*tracked" .gitignore c/.gitignore &&
+		for args in "-o" "-o --exclude-standard" "-o -i --exclude-standard" \
+			"-o --directory --exclude-standard" \
+			"-o --directory --no-empty-directory"
+		do
+			git -c core.preloadIndex=false ls-files $args >../expect &&
+			GIT_TRACE2_EVENT="$(pwd)/../trace" GIT_TEST_PRELOAD_INDEX=1 \
+				git -c core.preloadIndex=true ls-files $args >../actual &&
+			test_cmp ../expect ../actual || return 1
+		done
+	) &&
+	grep "\"preload/directories\",\"value\":\"6\"" trace
+'
+
 test_done
@@ -24,4 +24,11 @@ test_expect_success 'no buffer overflow in lazy_init_name_hash' '
 	test-tool lazy-init-name-hash -m
 '
 
+test_expect_success 'concurrent lookups find every entry' '
+	test_seq 100 | sed "s|^|100644 $EMPTY_BLOB	e/only_|;s|$|/f|" |
+	git update-index --index-info &&
+	test-tool lazy-init-name-hash --lookup --threads=4 >out &&
+	grep " lookup 4\$" out
+'
+
 test_done
@@ -315,4 +315,51 @@ test_expect_success 'line-log with --before' '
 	test_cmp expect actual
 '
 
+test_expect_success 'setup for checking changes next to the range' '
+	git checkout --orphan around &&
+	git rm -rf . &&
+	test_write_lines a b x x c d >around.t &&
+	git add around.t &&
+	test_tick &&
+	git commit -m "add around.t" &&
+	test_write_lines top a b x x c d >around.t &&
+	git commit -am "add a line above" &&
+	test_write_lines top a b x x c d bottom >around.t &&
+	git commit -am "add a line below" &&
+	test_write_lines top a b x x x c d bottom >around.t &&
+	git commit -am "repeat a line below" &&
+	test_write_lines top a b x x x c D bottom >around.t &&
+	git commit -am "change a line below" &&
+	test_write_lines top a B x x x c D bottom >around.t &&
+	git commit -am "change a line inside"
+'
+
+test_expect_success '-L skips changes that do not touch the range' '
+	cat >expect <<-\EOF &&
+	change a line inside
+	add around.t
+	EOF
+	git log --format=%s --no-patch -L3,4:around.t >actual &&
+	test_cmp expect actual &&
+	cat >expect <<-\EOF &&
+	repeat a line below
+	add around.t
+	EOF
+	git log --format=%s --no-patch -L5,6:around.t >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success '-L with changed-path filters' '
+	git checkout parallel-change &&
+	git log -L1,2:b.c >expect &&
+	git log --first-parent -L1,2:b.c >expect.first-parent &&
+	test_when_finished "rm -f .git/objects/info/commit-graph" &&
+	git -c commitGraph.mergeChangedPaths=true \
+		commit-graph write --reachable --changed-paths &&
+	git log -L1,2:b.c >actual &&
+	test_cmp expect actual &&
+	git log --first-parent -L1,2:b.c >actual &&
+	test_cmp expect.first-parent actual
+'
+
 test_done
@@ -120,8 +120,9 @@ test_expect_success 'git log with --walk-reflogs does not use Bloom filters' '
 	test_bloom_filters_not_used "--walk-reflogs -- A"
 '
 
-test_expect_success 'git log -- multiple path specs does not use Bloom filters' '
-	test_bloom_filters_not_used "-- file4 A/file1"
+test_expect_success 'git log -- multiple path specs uses Bloom filters' '
+	test_bloom_filters_used "-- file4 A/file1" &&
+	test_bloom_filters_used "-- A/B/C file5"
 '
 
 test_expect_success 'git log -- "." pathspec at root does not use Bloom filters' '
@@ -133,9 +134,113 @@ test_expect_success 'git log with wildcard that resolves to a single path uses B
 	test_bloom_filters_used "-- *renamed"
 '
 
-test_expect_success 'git log with wildcard that resolves to a multiple paths does not uses Bloom filters' '
-	test_bloom_filters_not_used "-- *" &&
-	test_bloom_filters_not_used "-- file*"
+test_expect_success 'git log with wildcard that resolves to multiple paths uses Bloom filters' '
+	test_bloom_filters_used "-- *" &&
+	test_bloom_filters_used "-- file*"
+'
+
+test_expect_success 'git log with wildcard below a directory uses Bloom filters' '
+	test_bloom_filters_used "-- :(glob)A/*1" &&
+	test_bloom_filters_used "-- :(glob)A/B/**/file?" &&
+	test_bloom_filters_used "-- :(glob)A/B/C/* A/file1"
+'
+
+test_expect_success 'git log with wildcard at the top level does not use Bloom filters' '
+	test_bloom_filters_not_used "-- :(glob)file?" &&
+	test_bloom_filters_not_used "-- :(glob)A/B/C/* :(glob)file?"
+'
+
+test_expect_success 'git log with excluded paths uses Bloom filters' '
+	test_bloom_filters_used "-- A :(exclude)A/B" &&
+	test_bloom_filters_not_used "-- :(exclude)A/B"
+'
+
+test_expect_success 'git log with case-insensitive pathspec does not use Bloom filters' '
+	test_bloom_filters_not_used "-- :(icase)a/file1"
+'
+
+test_expect_success 'setup - write Bloom filters for merges' '
+	git clone . merges &&
+	(
+		cd merges &&
+		GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+			git -c commitGraph.mergeChangedPaths=true \
+			commit-graph write --reachable --changed-paths &&
+		grep "\"key\":\"merge-filter-computed\",\"value\":\"1\"" trace.event &&
+		test-tool read-graph >out &&
+		grep "bloom_merge_indexes bloom_merge_data" out &&
+
+		# the filters for merges are kept when rewriting the graph
+		git commit-graph write --reachable &&
+		test-tool read-graph >out &&
+		grep "bloom_merge_indexes bloom_merge_data" out
+	)
+'
+
+for option in "--full-history" "--full-history --simplify-merges" "--simplify-merges" "--first-parent"
+do
+	for path in A file4 file5
+	do
+		test_expect_success "git log $option -- $path uses Bloom filters for merges" '
+			(
+				cd merges &&
+				test_bloom_filters_used "$option -- $path"
+			)
+		'
+	done
+done
+
+definitely_not () {
+	sed -n "s/.*\"definitely_not\":\([0-9]*\).*/\1/p" "$TRASH_DIRECTORY/trace.perf"
+}
+
+test_expect_success 'Bloom filters for merges answer comparisons with later parents' '
+	(
+		cd merges &&
+		git -c commitGraph.mergeChangedPaths=false \
+			commit-graph write --reachable &&
+		test-tool read-graph >out &&
+		! grep bloom_merge out &&
+		test_bloom_filters_used "--full-history -- file4" &&
+		without=$(definitely_not) &&
+
+		git -c commitGraph.mergeChangedPaths=true \
+			commit-graph write --reachable &&
+		test_bloom_filters_used "--full-history -- file4" &&
+		with=$(definitely_not) &&
+		test $with -gt $without
+	)
+'
+
+test_expect_success 'out-of-range Bloom filters for merges are ignored' '
+	git clone merges merges-corrupt &&
+	(
+		cd merges-corrupt &&
+		git -c commitGraph.mergeChangedPaths=true \
+			commit-graph write --reachable --changed-paths &&
+		git log --full-history --format=%H -- file4 >expect &&
+
+		# point every merge filter past the end of the BMDA chunk
+		cat >corrupt.pl <<-\EOF &&
+		open(my $fh, "+<", $ARGV[0]) or die;
+		binmode $fh;
+		read($fh, my $data, -s $fh);
+		my ($start, $end);
+		for my $i (0 .. ord(substr($data, 6, 1)) - 1) {
+			my ($id, undef, $off) = unpack("a4NN", substr($data, 8 + 12 * $i, 12));
+			next unless $id eq "BMIX";
+			$start = $off;
+			$end = (unpack("a4NN", substr($data, 20 + 12 * $i, 12)))[2];
+		}
+		defined $start or die "no BMIX chunk";
+		seek($fh, $start, 0);
+		print $fh pack("N", 0x40000000 + 8 * $_) for 1 .. ($end - $start) / 4;
+		EOF
+		chmod u+w .git/objects/info/commit-graph &&
+		perl corrupt.pl .git/objects/info/commit-graph &&
+		git log --full-history --format=%H -- file4 >actual &&
+		test_cmp expect actual
+	)
 '
 
 test_expect_success 'setup - add commit-graph to the chain without Bloom filters' '
@@ -180,6 +180,31 @@ rev_list_tests_head () {
 		git rev-list --objects --use-bitmap-index $branch tagged-blob >actual &&
 		grep $blob actual
 	'
+
+	test_expect_success "reachability queries via bitmap ($state, $branch)" '
+		for query in \
+			"merge-base --is-ancestor $branch~50 $branch" \
+			"merge-base --is-ancestor $branch $branch~50" \
+			"merge-base --is-ancestor other~3 second" \
+			"merge-base --is-ancestor HEAD~2 HEAD" \
+			"tag --contains $branch~50" \
+			"tag --contains HEAD~2" \
+			"branch --merged $branch~3" \
+			"branch --no-merged $branch" \
+			"for-each-ref --contains $branch~105" \
+			"for-each-ref --no-contains HEAD~1"
+		do
+			{
+				git -c pack.useBitmapReachability=false $query &&
+				echo yes || echo no
+			} >expect &&
+			{
+				git -c pack.useBitmapReachability $query &&
+				echo yes || echo no
+			} >actual &&
+			test_cmp expect actual || return 1
+		done
+	'
 }
 
 rev_list_tests () {
@@ -484,6 +509,58 @@ test_expect_success 'enumerating progress counts pack-reused objects' '
 	grep "pack-reused $count" stderr
 '
 
+test_expect_success 'pack.allowPackReuse=multi reuses objects from other packs' '
+	git init multi-pack-reuse &&
+	(
+		cd multi-pack-reuse &&
+		test_seq 1 100 >file &&
+		git add file &&
+		test_commit --no-tag base file &&
+		for i in 1 2 3
+		do
+			echo $i >>file &&
+			git commit -q -a -m "old $i" || return 1
+		done &&
+		git repack -adb &&
+		for i in 4 5 6
+		do
+			echo $i >>file &&
+			git commit -q -a -m "new $i" || return 1
+		done &&
+		git repack -d &&
+		ls .git/objects/pack/*.pack >packs &&
+		test_line_count = 2 packs &&
+
+		count=$(git rev-list --objects --all --count) &&
+		GIT_PROGRESS_DELAY=0 git -c pack.allowPackReuse=multi \
+			pack-objects --all --stdout --progress \
+			</dev/null >multi.pack 2>stderr &&
+		grep "pack-reused $count" stderr &&
+
+		GIT_PROGRESS_DELAY=0 git -c pack.allowPackReuse=single \
+			pack-objects --all --stdout --progress \
+			</dev/null >single.pack 2>stderr &&
+		! grep "pack-reused $count" stderr &&
+
+		# leave holes in both packs, so that delta offsets in the
+		# reused chunks need to be rewritten
+		printf "HEAD\n^HEAD~4\n" >revs &&
+		git -c pack.allowPackReuse=multi \
+			pack-objects --revs --stdout <revs >partial.pack &&
+
+		for pack in multi single
+		do
+			git init --bare $pack.git &&
+			git -C $pack.git index-pack --strict --stdin <$pack.pack ||
+			return 1
+		done &&
+		git -C multi.git rev-list --objects $(git rev-parse HEAD) >/dev/null &&
+		git init --bare partial.git &&
+		git -C partial.git index-pack --stdin <partial.pack &&
+		git -C partial.git cat-file -e $(git rev-parse HEAD:file)
+	)
+'
+
 # have_delta <obj> <expected_base>
 #
 # Note that because this relies on cat-file, it might find _any_ copy of an
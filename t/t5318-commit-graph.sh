@@ -67,7 +67,9 @@ graph_git_behavior() {
 		graph_git_two_modes "log --topo-order $BRANCH" &&
 		graph_git_two_modes "log --graph $COMPARE..$BRANCH" &&
 		graph_git_two_modes "branch -vv" &&
-		graph_git_two_modes "merge-base -a $BRANCH $COMPARE"
+		graph_git_two_modes "merge-base -a $BRANCH $COMPARE" &&
+		graph_git_two_modes "rev-list $BRANCH $COMPARE" &&
+		graph_git_two_modes "rev-list --count --all"
 	'
 }
 
@@ -683,6 +685,24 @@ test_expect_success 'git fsck (checks commit-graph)' '
 	test_must_fail git fsck
 '
 
+test_expect_success 'rev-list walks the commit-graph directly' '
+	cd "$TRASH_DIRECTORY/full" &&
+	git commit-graph write --reachable &&
+	git -c core.commitGraph=false rev-list --all >expect &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" git rev-list --all >actual &&
+	test_cmp expect actual &&
+	grep "\"walk-visited\",\"value\":\"$(git rev-list --count --all)\"" trace &&
+	git -c core.commitGraph=false rev-list --first-parent -n 3 \
+		--no-merges merge/3 >expect &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" git rev-list --first-parent -n 3 \
+		--no-merges merge/3 >actual &&
+	test_cmp expect actual &&
+	grep "\"walk-visited\"" trace &&
+	rm -f trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" git rev-list --topo-order --all &&
+	! grep "\"walk-visited\"" trace
+'
+
 test_expect_success 'setup non-the_repository tests' '
 	rm -rf repo &&
 	git init repo &&
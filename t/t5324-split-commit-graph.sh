@@ -69,7 +69,9 @@ graph_git_behavior() {
 		graph_git_two_modes "log --topo-order $BRANCH" &&
 		graph_git_two_modes "log --graph $COMPARE..$BRANCH" &&
 		graph_git_two_modes "branch -vv" &&
-		graph_git_two_modes "merge-base -a $BRANCH $COMPARE"
+		graph_git_two_modes "merge-base -a $BRANCH $COMPARE" &&
+		graph_git_two_modes "rev-list $BRANCH $COMPARE" &&
+		graph_git_two_modes "rev-list --count --all"
 	'
 }
 
@@ -0,0 +1,155 @@
+#!/bin/sh
+
+test_description='commit-graph first-parent jumps'
+
+GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME=main
+export GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME
+
+. ./test-lib.sh
+
+GIT_TEST_COMMIT_GRAPH=0
+GIT_TEST_COMMIT_GRAPH_CHANGED_PATHS=0
+
+test_expect_success 'setup history with merges and tags' '
+	test_commit root &&
+	for i in $(test_seq 1 40)
+	do
+		if test $((i % 7)) = 0
+		then
+			git checkout -b side$i main~3 &&
+			test_commit side$i.1 &&
+			test_commit side$i.2 &&
+			git checkout main &&
+			git merge --no-ff -m "merge side$i" side$i || return 1
+		else
+			test_commit c$i || return 1
+		fi &&
+		if test $((i % 9)) = 0
+		then
+			git tag -a -m "v$i" v$i || return 1
+		fi
+	done
+'
+
+test_expect_success 'jumps are only written when asked for' '
+	git commit-graph write --reachable &&
+	test-tool read-graph >out &&
+	! grep first_parent_jumps out &&
+	git -c commitGraph.firstParentJumps=true commit-graph write --reachable &&
+	test-tool read-graph >out &&
+	grep first_parent_jumps out &&
+	git commit-graph write --reachable &&
+	test-tool read-graph >out &&
+	grep first_parent_jumps out &&
+	git -c commitGraph.firstParentJumps=false commit-graph write --reachable &&
+	test-tool read-graph >out &&
+	! grep first_parent_jumps out
+'
+
+# check_counts <tips>...: "rev-list --count --first-parent" gives the same
+# answer with the commit-graph as without, between any of the commits on
+# the first-parent chain of main and any of the tips
+check_counts () {
+	for bottom in $(git rev-list --first-parent main) side14 side35.1
+	do
+		for tip in "$@"
+		do
+			git -c core.commitGraph=false rev-list --count \
+				--first-parent $bottom..$tip >expect &&
+			git rev-list --count --first-parent $bottom..$tip >actual &&
+			test_cmp expect actual &&
+			git -c core.commitGraph=false rev-list --count \
+				--first-parent -n 5 $bottom..$tip >expect &&
+			git rev-list --count --first-parent -n 5 $bottom..$tip >actual &&
+			test_cmp expect actual || return 1
+		done
+	done
+}
+
+test_expect_success 'rev-list --count --first-parent' '
+	git -c commitGraph.firstParentJumps=true commit-graph write --reachable &&
+	check_counts main main~4 side35 side14^
+'
+
+test_expect_success 'rev-list --count --first-parent with pack filters' '
+	git init pack-filters &&
+	(
+		cd pack-filters &&
+		for i in $(test_seq 6)
+		do
+			test_commit p$i || return 1
+		done &&
+		git repack -ad &&
+		test_commit loose &&
+		git -c commitGraph.firstParentJumps=true \
+			commit-graph write --reachable &&
+		echo 1 >expect &&
+		git rev-list --count --first-parent --unpacked p1..HEAD >actual &&
+		test_cmp expect actual &&
+		for pack in .git/objects/pack/*.pack
+		do
+			touch "${pack%.pack}.keep" || return 1
+		done &&
+		git rev-list --count --first-parent --no-kept-objects \
+			p1..HEAD >actual &&
+		test_cmp expect actual
+	)
+'
+
+test_expect_success 'describe --first-parent' '
+	for commit in $(git rev-list --all)
+	do
+		git -c core.commitGraph=false describe --always --first-parent \
+			$commit >expect &&
+		git describe --always --first-parent $commit >actual &&
+		test_cmp expect actual &&
+		git -c core.commitGraph=false describe --always --tags --first-parent \
+			$commit >expect &&
+		git describe --always --tags --first-parent $commit >actual &&
+		test_cmp expect actual || return 1
+	done
+'
+
+test_expect_success 'describe --first-parent does not walk the chain' '
+	git describe --first-parent main >expect &&
+	GIT_TEST_COMMIT_GRAPH_DIE_ON_PARSE=1 \
+		git describe --first-parent main >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'name-rev' '
+	for commit in $(git rev-list --all)
+	do
+		git -c core.commitGraph=false name-rev $commit >expect &&
+		git name-rev $commit >actual &&
+		test_cmp expect actual || return 1
+	done
+'
+
+test_expect_success 'jumps in a split commit-graph' '
+	git checkout -b split main~10 &&
+	test_commit split1 &&
+	git merge -m "merge main" main &&
+	test_commit split2 &&
+	git tag -a -m "split" vsplit &&
+	git -c commitGraph.firstParentJumps=true \
+		commit-graph write --reachable --split=no-merge &&
+	test_line_count = 2 .git/objects/info/commit-graphs/commit-graph-chain &&
+	check_counts split split~1 &&
+	git describe --first-parent split >actual &&
+	echo vsplit >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'jumps on top of a base graph without them' '
+	rm -rf .git/objects/info/commit-graph* &&
+	git commit-graph write --reachable --split &&
+	test_commit top1 &&
+	test_commit top2 &&
+	git -c commitGraph.firstParentJumps=true \
+		commit-graph write --reachable --split=no-merge &&
+	test_line_count = 2 .git/objects/info/commit-graphs/commit-graph-chain &&
+	check_counts split top2 top1
+'
+
+test_done
@@ -146,6 +146,38 @@ test_expect_success 'handle clock skew' '
 	have_not_sent old3
 '
 
+test_expect_success 'handle clock skew with generation numbers' '
+	rm -rf server client trace &&
+	git init server &&
+	test_commit -C server to_fetch &&
+
+	git init client &&
+
+	# 3 regular commits
+	test_tick=2000000000 &&
+	test_commit -C client c0 &&
+	test_commit -C client c1 &&
+	test_commit -C client c2 &&
+
+	# 4 old commits
+	test_tick=1000000000 &&
+	git -C client checkout c1 &&
+	test_commit -C client old1 &&
+	test_commit -C client old2 &&
+	test_commit -C client old3 &&
+	test_commit -C client old4 &&
+	git -C client commit-graph write --reachable &&
+
+	# "old4" to "old1" are walked before their ancestor "c1" even though
+	# they are dated much earlier. Unlike in the test above, "old1" is not
+	# mistaken for a commit without a parent, so it is skipped, and the
+	# skip it carries reaches "c1" too.
+	test_config -C client fetch.negotiationalgorithm generation &&
+	trace_fetch client "$(pwd)/server" &&
+	have_sent c2 old4 old2 c0 &&
+	have_not_sent old3 old1 c1
+'
+
 test_expect_success 'do not send "have" with ancestors of commits that server ACKed' '
 	rm -rf server client trace &&
 	git init server &&
@@ -556,6 +556,51 @@ test_expect_success 'repack does not loosen promisor objects' '
 	grep "loosen_unused_packed_objects/loosened:0" trace
 '
 
+test_expect_success 'checkout prefetches missing blobs in growing batches' '
+	rm -rf server client trace &&
+	test_when_finished "rm -rf server client trace" &&
+	git init server &&
+	for i in $(test_seq 10)
+	do
+		echo $i >server/file.$i || return 1
+	done &&
+	git -C server add . &&
+	git -C server commit -m files &&
+	test_config -C server uploadpack.allowfilter 1 &&
+	test_config -C server uploadpack.allowanysha1inwant 1 &&
+
+	git clone --no-checkout --filter=blob:none "file://$(pwd)/server" client &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" git -C client \
+		-c promisor.prefetchBatchSize=4 checkout main &&
+	for i in $(test_seq 10)
+	do
+		echo $i >expect &&
+		test_cmp expect client/file.$i || return 1
+	done &&
+
+	# 10 blobs, in batches of 4 (capped from the initial size), 4 and 2
+	grep "\"key\":\"prefetch/batches\",\"value\":\"3\"" trace &&
+	grep "\"key\":\"prefetch/objects\",\"value\":\"10\"" trace &&
+	git -C client rev-list --objects --missing=print HEAD >missing &&
+	! grep "^?" missing
+'
+
+test_expect_success 'promisor.prefetchBatchSize=0 fetches up front' '
+	rm -rf server client trace &&
+	test_when_finished "rm -rf server client trace" &&
+	git init server &&
+	test_commit -C server one &&
+	test_commit -C server two &&
+	test_config -C server uploadpack.allowfilter 1 &&
+	test_config -C server uploadpack.allowanysha1inwant 1 &&
+
+	git clone --no-checkout --filter=blob:none "file://$(pwd)/server" client &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" git -C client \
+		-c promisor.prefetchBatchSize=0 checkout main &&
+	test_path_is_file client/two.t &&
+	! grep "prefetch/batches" trace
+'
+
 . "$TEST_DIRECTORY"/lib-httpd.sh
 start_httpd
 
@@ -961,6 +961,65 @@ test_expect_success 'packfile URIs with fetch instead of clone' '
 		fetch "$HTTPD_URL/smart/http_parent"
 '
 
+test_expect_success 'packfile URI download resumes from a partial pack' '
+	P="$HTTPD_DOCUMENT_ROOT_PATH/http_parent" &&
+	rm -rf "$P" http_child log &&
+
+	git init "$P" &&
+	git -C "$P" config "uploadpack.allowsidebandall" "true" &&
+
+	echo my-blob >"$P/my-blob" &&
+	git -C "$P" add my-blob &&
+	git -C "$P" commit -m x &&
+
+	configure_exclusion "$P" my-blob >h &&
+
+	# Pretend that an earlier download of the pack was interrupted
+	# after its first 20 bytes.
+	git init http_child &&
+	partial="http_child/.git/objects/pack/pack-$(cat packh).pack.temp" &&
+	test_copy_bytes 20 <"$HTTPD_DOCUMENT_ROOT_PATH/mypack-$(cat packh).pack" \
+		>"$partial" &&
+
+	GIT_TRACE2_EVENT="$(pwd)/trace" GIT_TEST_SIDEBAND_ALL=1 \
+	git -C http_child -c protocol.version=2 \
+		-c fetch.uriprotocols=http,https \
+		fetch "$HTTPD_URL/smart/http_parent" &&
+	grep "\"key\":\"pack/resume_offset\",\"value\":\"20\"" trace &&
+	test_path_is_missing "$partial" &&
+	git -C http_child cat-file -e "$(cat h)"
+'
+
+test_expect_success 'packfile URI download keeps a pack that was already complete' '
+	rm -rf http_child trace &&
+	git init http_child &&
+	partial="http_child/.git/objects/pack/pack-$(cat packh).pack.temp" &&
+	cp "$HTTPD_DOCUMENT_ROOT_PATH/mypack-$(cat packh).pack" "$partial" &&
+	size=$(test_file_size "$partial") &&
+
+	GIT_TRACE2_EVENT="$(pwd)/trace" GIT_TEST_SIDEBAND_ALL=1 \
+	git -C http_child -c protocol.version=2 \
+		-c fetch.uriprotocols=http,https \
+		fetch "$HTTPD_URL/smart/http_parent" &&
+	grep "\"key\":\"pack/resume_offset\",\"value\":\"$size\"" trace &&
+	test_path_is_missing "$partial" &&
+	git -C http_child cat-file -e "$(cat h)"
+'
+
+test_expect_success 'packfile URI download discards partial data that is not a pack' '
+	rm -rf http_child trace &&
+	git init http_child &&
+	partial="http_child/.git/objects/pack/pack-$(cat packh).pack.temp" &&
+	echo "<html>not a pack</html>" >"$partial" &&
+
+	GIT_TRACE2_EVENT="$(pwd)/trace" GIT_TEST_SIDEBAND_ALL=1 \
+	git -C http_child -c protocol.version=2 \
+		-c fetch.uriprotocols=http,https \
+		fetch "$HTTPD_URL/smart/http_parent" &&
+	! grep "pack/resume_offset" trace &&
+	git -C http_child cat-file -e "$(cat h)"
+'
+
 test_expect_success 'fetching with valid packfile URI but invalid hash fails' '
 	P="$HTTPD_DOCUMENT_ROOT_PATH/http_parent" &&
 	rm -rf "$P" http_child log &&
@@ -600,6 +600,39 @@ test_expect_success 'basic: POST origin blobs' '
 	verify_connection_count 1
 '
 
+test_expect_success 'basic: POST origin blobs in parallel blocks' '
+	test_when_finished "per_test_cleanup" &&
+	start_gvfs_protocol_server &&
+
+	# Split the request into blocks of 2 objects and keep up to
+	# 3 of them in flight at once.
+	#
+	GIT_TRACE2_EVENT="$(pwd)/trace.parallel" \
+		git -C "$REPO_T1" gvfs-helper \
+		--cache-server=disable \
+		--remote=origin \
+		--no-progress \
+		post \
+		--block-size=2 \
+		--max-parallel=3 \
+		<"$OIDS_BLOBS_FILE" >OUT.output &&
+
+	stop_gvfs_protocol_server &&
+
+	# Files with the same content share a blob, and gvfs-helper
+	# only requests each object once.
+	#
+	nr_blobs=$(sort -u <"$OIDS_BLOBS_FILE" | wc -l) &&
+	nr_blocks=$(( ($nr_blobs + 1) / 2 )) &&
+	test_line_count = $nr_blocks OUT.output &&
+	grep "\"key\":\"POST/objects/parallel/nr_requests\",\"value\":\"$nr_blocks\"" \
+		trace.parallel &&
+	grep "\"key\":\"POST/objects/parallel/nr_retried\",\"value\":\"0\"" \
+		trace.parallel &&
+
+	verify_objects_in_shared_cache "$OIDS_BLOBS_FILE"
+'
+
 # Request a single blob via POST.  Per the GVFS Protocol, the server
 # should implicitly send a loose object for it.  Confirm that.
 #
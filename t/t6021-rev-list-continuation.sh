@@ -0,0 +1,100 @@
+#!/bin/sh
+
+test_description='saving and resuming a topo-ordered walk'
+
+GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME=main
+export GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME
+
+. ./test-lib.sh
+
+test_expect_success 'setup history with parallel lines' '
+	test_commit base &&
+	for i in 1 2 3 4 5 6
+	do
+		git checkout -b side$i main~$((i % 3)) 2>/dev/null ||
+		git checkout -b side$i main || return 1
+		for j in 1 2 3
+		do
+			test_commit side$i.$j || return 1
+		done &&
+		git checkout main &&
+		test_commit main$i &&
+		git merge -m "merge side$i" side$i || return 1
+	done &&
+	git commit-graph write --reachable
+'
+
+# page <size> <args>...: walk in pages of <size> commits, each one
+# resuming from the last, and write their concatenation to "pages"
+page () {
+	size=$1 &&
+	shift &&
+	rm -f cookie &&
+	git rev-list -n $size --write-continuation=cookie "$@" >pages &&
+	while grep -v " " cookie >/dev/null
+	do
+		git rev-list -n $size --continue-from=cookie \
+			--write-continuation=cookie "$@" >>pages || return 1
+	done
+}
+
+for order in --topo-order --date-order --author-date-order
+do
+	for size in 1 2 5
+	do
+		test_expect_success "pages of $size in $order order" '
+			git rev-list $order main side2 side5 >expect &&
+			page $size $order main side2 side5 &&
+			test_cmp expect pages
+		'
+	done
+done
+
+for args in "main -- side3.t main4.t" "side6..main" "--first-parent main" \
+	    "--no-merges main" "--merges main"
+do
+	test_expect_success "pages with $args" '
+		git rev-list --topo-order $args >expect &&
+		page 3 --topo-order $args &&
+		test_cmp expect pages
+	'
+done
+
+test_expect_success 'continuation after the last commit is empty' '
+	git rev-list --topo-order --write-continuation=cookie main >/dev/null &&
+	test_line_count = 2 cookie &&
+	git rev-list --topo-order --continue-from=cookie main >actual &&
+	test_must_be_empty actual
+'
+
+test_expect_success 'resuming does not walk again from the tips' '
+	git rev-list --topo-order -n 3 --write-continuation=cookie main &&
+	GIT_TRACE2_PERF="$(pwd)/trace" \
+		git rev-list --topo-order -n 1 --continue-from=cookie main &&
+	grep "\"count_topo_walked\":1}" trace
+'
+
+test_expect_success 'continuation must match the ordering' '
+	git rev-list --topo-order -n 3 --write-continuation=cookie main &&
+	test_must_fail git rev-list --date-order --continue-from=cookie main 2>err &&
+	grep "not saved by a walk in date order" err
+'
+
+test_expect_success 'incompatible options' '
+	test_must_fail git rev-list --write-continuation=cookie main 2>err &&
+	grep "requires --topo-order" err &&
+	test_must_fail git log --graph --write-continuation=cookie main 2>err &&
+	grep "cannot combine --write-continuation with --graph" err &&
+	test_must_fail git rev-list --topo-order --ancestry-path \
+		--write-continuation=cookie side1..main 2>err &&
+	grep "needs a commit-graph" err
+'
+
+test_expect_success 'continuation needs a commit-graph' '
+	git rev-list --topo-order -n 3 --write-continuation=cookie main &&
+	test_must_fail git -c core.commitGraph=false rev-list --topo-order \
+		--continue-from=cookie main 2>err &&
+	grep "needs a commit-graph" err
+'
+
+test_done
@@ -281,6 +281,35 @@ test_expect_success 'name-rev --stdin' '
 	test_cmp expect actual
 '
 
+test_expect_success 'name-rev --batch' '
+	git rev-list --all >revs &&
+	echo A >>revs &&
+	echo HEAD~2 >>revs &&
+	>expect &&
+	while read rev
+	do
+		git name-rev $rev >>expect || return 1
+	done <revs &&
+	git name-rev --batch <revs >actual &&
+	test_cmp expect actual &&
+	git name-rev $(cat revs) >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'name-rev --batch with a commit-graph' '
+	test_when_finished "rm -f .git/objects/info/commit-graph" &&
+	git commit-graph write --reachable &&
+	git rev-list --all | git name-rev --batch >actual &&
+	git rev-list --all >revs &&
+	git -c core.commitGraph=false name-rev --batch <revs >expect &&
+	test_cmp expect actual &&
+	git rev-list --all | git name-rev --batch --name-only --tags \
+		>actual &&
+	git -c core.commitGraph=false name-rev --batch --name-only --tags \
+		<revs >expect &&
+	test_cmp expect actual
+'
+
 test_expect_success 'describe --contains with the exact tags' '
 	echo "A^0" >expect &&
 	tag_object=$(git rev-parse refs/tags/A) &&
@@ -443,4 +443,105 @@ test_expect_success 'get_reachable_subset:none' '
 	test_all_modes get_reachable_subset
 '
 
+test_expect_success 'ahead-behind:one base' '
+	cat >input <<-\EOF &&
+	commit-1-1
+	commit-2-4
+	commit-4-2
+	commit-4-4
+	commit-5-5
+	commit-9-9
+	tag-8-3
+	EOF
+	cat >expect <<-\EOF &&
+	commit-1-1 0 15
+	commit-2-4 0 8
+	commit-4-2 0 8
+	commit-4-4 0 0
+	commit-5-5 9 0
+	commit-9-9 65 0
+	tag-8-3 12 4
+	EOF
+	run_all_modes git ahead-behind --base=commit-4-4 --stdin
+'
+
+test_expect_success 'ahead-behind:ignore missing' '
+	cat >input <<-\EOF &&
+	commit-2-4
+	not-a-ref
+	commit-4-2
+	EOF
+	test_must_fail git ahead-behind --base=commit-4-4 --stdin <input &&
+	cat >expect <<-\EOF &&
+	commit-2-4 0 8
+	commit-4-2 0 8
+	EOF
+	run_all_modes git ahead-behind --base=commit-4-4 --ignore-missing --stdin
+'
+
+test_expect_success 'ahead-behind:clock skew without commit-graph' '
+	git init skew &&
+	test_commit -C skew --date "1500000500 +0000" A &&
+	test_commit -C skew --date "1500001000 +0000" B &&
+	git -C skew checkout -b side &&
+	test_commit -C skew --date "1500001100 +0000" X1 &&
+	test_commit -C skew --date "1500000900 +0000" X2 &&
+	test_commit -C skew --date "1500001200 +0000" X3 &&
+	git -C skew checkout -b main B &&
+	test_commit -C skew --date "1500001050 +0000" M1 &&
+	echo "side 3 1" >expect &&
+	git -C skew ahead-behind --base=main side >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'ahead-behind:clock skew below a shared commit' '
+	git init skew-shared &&
+	tree=$(git -C skew-shared write-tree) &&
+	commit () {
+		GIT_COMMITTER_DATE="$1 +0000" &&
+		export GIT_COMMITTER_DATE &&
+		shift &&
+		git -C skew-shared commit-tree $tree "$@"
+	} &&
+
+	# "Y" is dated in the future, so it is walked right after "side"
+	# and before "S" is known to be reachable from "main" too.
+	Y=$(commit 1500009000 -m Y) &&
+	P=$(commit 1500000100 -m P -p $Y) &&
+	S=$(commit 1500000200 -m S -p $P) &&
+	main=$(commit 1500000300 -m main -p $S) &&
+	side=$(commit 1500000300 -m side -p $S -p $Y) &&
+	echo "$side 1 1" >expect &&
+	git -C skew-shared ahead-behind --base=$main $side >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'for-each-ref ahead-behind:multiple bases' '
+	cat >expect <<-\EOF &&
+	refs/heads/commit-1-1 0 15 0 1
+	refs/heads/commit-2-4 0 8 6 0
+	refs/heads/commit-4-2 0 8 6 0
+	refs/heads/commit-4-4 0 0 14 0
+	refs/tags/tag-8-3 12 4 22 0
+	EOF
+	run_all_modes git for-each-ref \
+		--format="%(refname) %(ahead-behind:commit-4-4) %(ahead-behind:commit-1-2)" \
+		refs/heads/commit-1-1 refs/heads/commit-2-4 refs/heads/commit-4-2 \
+		refs/heads/commit-4-4 refs/tags/tag-8-3
+'
+
+test_expect_success 'for-each-ref upstream:track matches ahead-behind' '
+	test_config branch.commit-2-4.remote . &&
+	test_config branch.commit-2-4.merge refs/heads/commit-4-2 &&
+	echo "[ahead 4, behind 4] 4 4" >expect &&
+	test_config branch.commit-1-1.remote . &&
+	test_config branch.commit-1-1.merge refs/heads/no-such-branch &&
+	run_all_modes git for-each-ref \
+		--format="%(upstream:track) %(ahead-behind:commit-4-2)" \
+		refs/heads/commit-2-4 &&
+	echo "[gone]" >expect &&
+	run_all_modes git for-each-ref --format="%(upstream:track)" \
+		refs/heads/commit-1-1
+'
+
 test_done
@@ -693,4 +693,70 @@ test_expect_success 'custom merge driver with checkout -m' '
 	test_cmp expect arm
 '
 
+test_expect_success 'setup directories for threaded switch' '
+	git init threads &&
+	(
+		cd threads &&
+		for d in a b c d
+		do
+			mkdir -p $d/sub &&
+			echo $d >$d/file &&
+			echo $d >$d/sub/file &&
+			echo $d >$d.txt || exit 1
+		done &&
+		git add . &&
+		git commit -m base &&
+		git checkout -b threads &&
+		echo changed >b/file &&
+		echo changed >d/sub/file &&
+		git rm -q c/sub/file &&
+		mkdir e &&
+		echo new >e/file &&
+		echo new >a/new &&
+		git add . &&
+		git commit -m threads &&
+		git checkout -
+	)
+'
+
+test_expect_success 'switching branches with threads' '
+	test_when_finished "git -C threads checkout -f - && git -C threads clean -fd" &&
+	echo local >threads/a/file &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" GIT_TRACE2_EVENT_NESTING=10 \
+		git -C threads -c index.threads=4 checkout threads &&
+	grep "\"key\":\"unpack_subtrees/threads\"" trace.event &&
+	git -C threads diff-index --cached --exit-code HEAD &&
+	echo " M a/file" >expect &&
+	git -C threads status --porcelain --untracked-files=no >actual &&
+	test_cmp expect actual &&
+	echo new >expect &&
+	test_cmp expect threads/a/new &&
+	test_path_is_missing threads/c/sub
+'
+
+test_expect_success 'threads look up untracked files case-insensitively' '
+	test_when_finished "rm -rf threads/e" &&
+	rm -f trace.event &&
+	mkdir threads/e &&
+	echo untracked >threads/e/file &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" GIT_TRACE2_EVENT_NESTING=10 \
+		test_must_fail git -C threads -c index.threads=4 \
+		-c core.ignorecase=true checkout threads 2>err &&
+	grep "\"key\":\"unpack_subtrees/threads\"" trace.event &&
+	test_i18ngrep "e/file" err &&
+	git -C threads diff-index --cached --exit-code HEAD
+'
+
+test_expect_success 'errors of a threaded switch are the same' '
+	test_when_finished "git -C threads checkout -f main && git -C threads clean -fd" &&
+	echo local >threads/b/file &&
+	echo local >threads/d/sub/file &&
+	echo untracked >threads/e &&
+	test_must_fail git -C threads -c index.threads=1 checkout threads 2>expect &&
+	test_must_fail git -C threads -c index.threads=4 checkout threads 2>actual &&
+	test_cmp expect actual &&
+	test_i18ngrep "b/file" actual &&
+	test_i18ngrep "d/sub/file" actual
+'
+
 test_done
@@ -1667,4 +1667,31 @@ test_expect_success '--no-optional-locks prevents index update' '
 	! grep ^1234567890 out
 '
 
+test_expect_success 'preloaded index finds the same changes' '
+	git init preload &&
+	(
+		cd preload &&
+		for d in $(test_seq 1 12)
+		do
+			mkdir dir$d &&
+			for f in $(test_seq 1 50)
+			do
+				echo $f >dir$d/file$f || return 1
+			done
+		done &&
+		git add . &&
+		git commit -q -m files &&
+		echo changed >dir3/file7 &&
+		echo changed >dir12/file50 &&
+		rm dir7/file1 &&
+		git -c core.preloadIndex=false status --porcelain >../expect &&
+		GIT_TRACE2_EVENT="$(pwd)/../trace" GIT_TEST_PRELOAD_INDEX=1 \
+			git -c core.preloadIndex=true status --porcelain >../actual
+	) &&
+	test_cmp expect actual &&
+	grep "\"preload/sum_lstat\",\"value\":\"600\"" trace &&
+	# each directory is looked up by a single thread
+	grep "\"preload/sum_leading_lstat\",\"value\":\"12\"" trace
+'
+
 test_done
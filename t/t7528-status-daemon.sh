@@ -0,0 +1,162 @@
+#!/bin/sh
+
+test_description='git status served by status--daemon'
+
+. ./test-lib.sh
+
+test-tool simple-ipc SUPPORTS_SIMPLE_IPC || {
+	skip_all='simple IPC not supported on this platform'
+	test_done
+}
+
+stop_status_daemon () {
+	git status--daemon stop
+}
+
+# The fsmonitor hook reports the paths listed in .git/fsmonitor-log;
+# its token is the number of lines in that log.  Tests append the paths
+# they touch to the log, like a real file system watcher would.
+write_integration_script () {
+	write_script .git/hooks/fsmonitor-test <<-\EOF
+	if test "$1" != 2
+	then
+		echo "Unsupported core.fsmonitor hook version." >&2
+		exit 1
+	fi
+	log=.git/fsmonitor-log
+	test -f $log || : >$log
+	last=$(wc -l <$log)
+	printf "t:%d\0" $last
+	case "$2" in
+	t:*)
+		sed -n "$((${2#t:} + 1)),\$p" $log | tr "\n" "\000"
+		;;
+	*)
+		printf "/\0"
+		;;
+	esac
+	EOF
+}
+
+touch_paths () {
+	for p in "$@"
+	do
+		echo "changed $p" >"$p" &&
+		echo "$p" >>.git/fsmonitor-log || return 1
+	done
+}
+
+# check_status [<status args>...]: status served by the daemon is the
+# same as the one computed directly
+check_status () {
+	git -c status.deserializeWait=fail status --porcelain=v2 "$@" >../actual &&
+	git -c status.useDaemon=false status --porcelain=v2 "$@" >../expect &&
+	test_cmp ../expect ../actual
+}
+
+# last_cache_result: the last cache check made by the daemon
+last_cache_result () {
+	grep "\"key\":\"cache\"" ../daemon-trace | tail -n 1 |
+	sed -e "s/.*\"value\":\"\([^\"]*\)\".*/\1/"
+}
+
+test_expect_success 'setup' '
+	git branch -M main &&
+	mkdir dir1 dir2 &&
+	touch_paths tracked dir1/tracked dir2/tracked modified dir1/modified &&
+	cat >.gitignore <<-\EOF &&
+	*.ign
+	EOF
+	git add . &&
+	test_tick &&
+	git commit -m initial &&
+	write_integration_script &&
+	git config core.fsmonitor .git/hooks/fsmonitor-test &&
+	git config status.useDaemon true &&
+	git update-index --fsmonitor &&
+	test_atexit stop_status_daemon &&
+	GIT_TRACE2_EVENT="$(pwd)/../daemon-trace" \
+		git status--daemon start &&
+	git status--daemon status
+'
+
+test_expect_success 'daemon serves the same status' '
+	touch_paths modified dir1/modified untracked dir2/untracked x.ign &&
+	check_status &&
+	check_status --untracked-files=all &&
+	check_status --ignored &&
+	check_status --untracked-files=no
+'
+
+# Other commands that write the index (like the "git status" without
+# the daemon in check_status) make the daemon scan again, so compare
+# two answers from the daemon here.
+test_expect_success 'unchanged worktree is served from the cache' '
+	check_status &&
+	git -c status.deserializeWait=fail status --porcelain=v2 >../expect &&
+	git -c status.deserializeWait=fail status --porcelain=v2 >../actual &&
+	test_cmp ../expect ../actual &&
+	echo current >../expect &&
+	last_cache_result >../actual &&
+	test_cmp ../expect ../actual
+'
+
+test_expect_success 'changes reported by fsmonitor are picked up' '
+	git -c status.deserializeWait=fail status --porcelain=v2 &&
+	touch_paths dir2/tracked dir1/new &&
+	check_status &&
+	echo worktree >../expect &&
+	last_cache_result >../actual &&
+	test_cmp ../expect ../actual &&
+	rm dir1/new &&
+	echo dir1/new >>.git/fsmonitor-log &&
+	check_status
+'
+
+test_expect_success 'changes to the index are picked up' '
+	git add modified dir1 &&
+	check_status &&
+	git rm --cached -q dir2/tracked &&
+	check_status
+'
+
+test_expect_success 'changes to HEAD are picked up' '
+	test_tick &&
+	git commit -q -m second &&
+	check_status &&
+	git checkout -q -b side &&
+	check_status &&
+	git checkout -q main &&
+	check_status
+'
+
+test_expect_success 'changes to info/exclude are picked up' '
+	check_status --ignored &&
+	echo untracked >>.git/info/exclude &&
+	check_status --ignored
+'
+
+test_expect_success 'status falls back when the daemon is stopped' '
+	git status--daemon stop &&
+	test_must_fail git status--daemon status &&
+	git -c status.useDaemon=false status --porcelain=v2 >../expect &&
+	git status --porcelain=v2 >../actual &&
+	test_cmp ../expect ../actual &&
+	test_must_fail git -c status.deserializeWait=fail status
+'
+
+test_expect_success 'daemon without fsmonitor scans for every request' '
+	test_config core.fsmonitor "" &&
+	rm -f ../daemon-trace &&
+	GIT_TRACE2_EVENT="$(pwd)/../daemon-trace" \
+		git status--daemon start &&
+	test_when_finished "git status--daemon stop" &&
+	check_status &&
+	touch_paths dir1/tracked &&
+	check_status &&
+	echo no-token >../expect &&
+	last_cache_result >../actual &&
+	test_cmp ../expect ../actual
+'
+
+test_done
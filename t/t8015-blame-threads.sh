@@ -0,0 +1,67 @@
+#!/bin/sh
+
+test_description='git blame with worker threads'
+GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME=main
+export GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME
+
+. ./test-lib.sh
+
+PROG='git blame -c --threads=4'
+. "$TEST_DIRECTORY"/annotate-tests.sh
+
+test_expect_success 'setup history with merges and a rename' '
+	git checkout -b threads main &&
+	test_write_lines 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 >lines &&
+	git add lines &&
+	git commit -m lines &&
+	for i in 1 2 3 4 5 6 7 8
+	do
+		git checkout -b side$i threads &&
+		sed -e "s/^$i\$/side $i/" lines >lines.new &&
+		mv lines.new lines &&
+		git commit -a -m "side $i" &&
+		git checkout threads &&
+		j=$((i + 8)) &&
+		sed -e "s/^$j\$/main $j/" lines >lines.new &&
+		mv lines.new lines &&
+		git commit -a -m "main $j" &&
+		git merge -m "merge side $i" side$i || return 1
+	done &&
+	git mv lines renamed &&
+	echo last >>renamed &&
+	git commit -m rename
+'
+
+for opts in "" "-w" "--first-parent" "--porcelain" "-L 3,12" "--incremental" "--ignore-rev threads~4"
+do
+	test_expect_success "blame $opts: threads do not change the output" '
+		git blame $opts --threads=1 threads -- renamed >expect &&
+		git blame $opts --threads=4 threads -- renamed >actual &&
+		test_cmp expect actual &&
+		git -c blame.threads=0 blame $opts threads -- renamed >actual &&
+		test_cmp expect actual
+	'
+done
+
+test_expect_success 'diffs are computed by the worker threads' '
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git blame --threads=4 threads -- renamed >/dev/null &&
+	grep "\"key\":\"prefetch/diffs-used\",\"value\":\"[1-9]" trace &&
+	rm trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git blame --threads=1 threads -- renamed >/dev/null &&
+	! grep prefetch/diffs-used trace
+'
+
+test_expect_success 'threads do not change the statistics' '
+	git blame --show-stats --threads=1 threads -- renamed >expect &&
+	git blame --show-stats --threads=4 threads -- renamed >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'blame rejects a negative number of threads' '
+	test_must_fail git blame --threads=-1 threads -- renamed &&
+	test_must_fail git -c blame.threads=-1 blame threads -- renamed
+'
+
+test_done
@@ -0,0 +1,138 @@
+#!/bin/sh
+
+test_description='git blame with the on-disk blame cache'
+GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME=main
+export GIT_TEST_DEFAULT_INITIAL_BRANCH_NAME
+
+. ./test-lib.sh
+
+PROG='git -c blame.cache=true blame -c'
+. "$TEST_DIRECTORY"/annotate-tests.sh
+
+test_expect_success 'setup history with merges and a rename' '
+	git checkout -b cache main &&
+	test_write_lines 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 >lines &&
+	git add lines &&
+	git commit -m lines &&
+	for i in 1 2 3 4 5 6 7 8
+	do
+		git checkout -b side$i cache &&
+		sed -e "s/^$i\$/side $i/" lines >lines.new &&
+		mv lines.new lines &&
+		git commit -a -m "side $i" &&
+		git checkout cache &&
+		j=$((i + 8)) &&
+		sed -e "s/^$j\$/main $j/" lines >lines.new &&
+		mv lines.new lines &&
+		git commit -a -m "main $j" &&
+		git merge -m "merge side $i" side$i || return 1
+	done &&
+	git mv lines renamed &&
+	echo last >>renamed &&
+	git commit -a -m rename
+'
+
+for opts in "" "-w" "--first-parent" "--porcelain" "-L 3,12" "--root" "-b"
+do
+	test_expect_success "blame $opts: the cache does not change the output" '
+		rm -rf .git/blame-cache &&
+		git blame $opts cache -- renamed >expect &&
+		git -c blame.cache=true blame $opts cache~3 -- lines &&
+		git -c blame.cache=true blame $opts cache -- renamed >actual &&
+		test_cmp expect actual &&
+		git -c blame.cache=true blame $opts cache -- renamed >actual &&
+		test_cmp expect actual
+	'
+done
+
+test_expect_success 'blame starts from the result for an older commit' '
+	rm -rf .git/blame-cache &&
+	git -c blame.cache=true blame cache^ -- lines >/dev/null &&
+	git -c blame.cache=true blame --show-stats cache -- renamed >out &&
+	grep "^num commits: 1\$" out &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git -c blame.cache=true blame cache -- renamed >/dev/null &&
+	grep "\"key\":\"cache/hits\",\"value\":\"1\"" trace &&
+	git -c blame.cache=true blame --show-stats cache -- renamed >out &&
+	grep "^num commits: 0\$" out
+'
+
+test_expect_success 'working tree blame uses the result for HEAD' '
+	rm -rf .git/blame-cache &&
+	git -c blame.cache=true blame HEAD -- renamed &&
+	echo more >>renamed &&
+	test_when_finished "git checkout renamed" &&
+	git blame renamed >expect &&
+	git -c blame.cache=true blame --show-stats renamed >actual &&
+	grep "^num commits: 1\$" actual &&
+	git -c blame.cache=true blame renamed >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'cache is not used when not asked for' '
+	rm -rf .git/blame-cache &&
+	git blame cache -- renamed >/dev/null &&
+	test_path_is_missing .git/blame-cache
+'
+
+test_expect_success 'cache is not used with -M or limited ranges' '
+	rm -rf .git/blame-cache &&
+	git -c blame.cache=true blame -M cache -- renamed >/dev/null &&
+	git -c blame.cache=true blame cache~4..cache -- renamed >/dev/null &&
+	test_path_is_missing .git/blame-cache
+'
+
+test_expect_success 'damaged cache entries are ignored' '
+	rm -rf .git/blame-cache &&
+	git blame --porcelain cache -- renamed >expect &&
+	git -c blame.cache=true blame cache^ -- lines >/dev/null &&
+	for f in $(find .git/blame-cache -type f)
+	do
+		sed -e "s/^entry 0 /entry 1 /" "$f" >"$f.new" &&
+		mv "$f.new" "$f" || return 1
+	done &&
+	git -c blame.cache=true blame --porcelain cache -- renamed >actual &&
+	test_cmp expect actual &&
+	for f in $(find .git/blame-cache -type f)
+	do
+		echo garbage >"$f" || return 1
+	done &&
+	git -c blame.cache=true blame --porcelain cache -- renamed >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'cache entries past the end of a blob are ignored' '
+	rm -rf .git/blame-cache &&
+	git blame --porcelain cache -- renamed >expect &&
+	git -c blame.cache=true blame cache^ -- lines >/dev/null &&
+	for f in $(find .git/blame-cache -type f)
+	do
+		sed -e "s/^\(entry [0-9]* [0-9]*\) [0-9]*/\1 1000/" \
+			"$f" >"$f.new" &&
+		mv "$f.new" "$f" || return 1
+	done &&
+	git -c blame.cache=true blame --porcelain cache -- renamed >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'gc prunes the results that are not used' '
+	rm -rf .git/blame-cache &&
+	git -c blame.cache=true blame cache -- renamed >/dev/null &&
+	git -c blame.cache=true blame cache^ -- lines >/dev/null &&
+	find .git/blame-cache -type f >files &&
+	test_line_count = 2 files &&
+	test-tool chmtime =-$((40 * 86400)) $(cat files) &&
+	git -c blame.cache=true blame --show-stats cache -- renamed >out &&
+	grep "^num commits: 0\$" out &&
+	git gc --quiet &&
+	find .git/blame-cache -type f >files &&
+	test_line_count = 1 files &&
+	git -c gc.blameCacheExpire=never gc --quiet &&
+	find .git/blame-cache -type f >files &&
+	test_line_count = 1 files &&
+	git -c gc.blameCacheExpire=now gc --quiet &&
+	find .git/blame-cache -type f >files &&
+	test_must_be_empty files
+'
+
+test_done
@@ -169,17 +169,15 @@ int tree_entry_gently(struct tree_desc *desc, struct name_entry *entry)
 }
 
 static int traverse_trees_atexit_registered;
-static int traverse_trees_count;
-static int traverse_trees_cur_depth;
-static int traverse_trees_max_depth;
+static struct traverse_trees_stats traverse_trees_stats;
 
 static void trace2_traverse_trees_statistics_atexit(void)
 {
 	struct json_writer jw = JSON_WRITER_INIT;
 
 	jw_object_begin(&jw, 0);
-	jw_object_intmax(&jw, "traverse_trees_count", traverse_trees_count);
-	jw_object_intmax(&jw, "traverse_trees_max_depth", traverse_trees_max_depth);
+	jw_object_intmax(&jw, "traverse_trees_count", traverse_trees_stats.count);
+	jw_object_intmax(&jw, "traverse_trees_max_depth", traverse_trees_stats.max_depth);
 	jw_end(&jw);
 
 	trace2_data_json("traverse_trees", the_repository, "statistics", &jw);
@@ -187,6 +185,20 @@ static void trace2_traverse_trees_statistics_atexit(void)
 	jw_release(&jw);
 }
 
+void traverse_trees_stats_init(struct traverse_trees_stats *stats, int depth)
+{
+	stats->count = 0;
+	stats->cur_depth = depth;
+	stats->max_depth = depth;
+}
+
+void traverse_trees_add_stats(const struct traverse_trees_stats *stats)
+{
+	traverse_trees_stats.count += stats->count;
+	if (stats->max_depth > traverse_trees_stats.max_depth)
+		traverse_trees_stats.max_depth = stats->max_depth;
+}
+
 void setup_traverse_info(struct traverse_info *info, const char *base)
 {
 	size_t pathlen = strlen(base);
@@ -440,12 +452,14 @@ int traverse_trees(struct index_state *istate,
 	struct strbuf base = STRBUF_INIT;
 	int interesting = 1;
 	char *traverse_path;
+	struct traverse_trees_stats *stats = info->stats ? info->stats :
+		&traverse_trees_stats;
 
-	traverse_trees_count++;
-	traverse_trees_cur_depth++;
+	stats->count++;
+	stats->cur_depth++;
 
-	if (traverse_trees_cur_depth > traverse_trees_max_depth)
-		traverse_trees_max_depth = traverse_trees_cur_depth;
+	if (stats->cur_depth > stats->max_depth)
+		stats->max_depth = stats->cur_depth;
 
 	if (n >= ARRAY_SIZE(entry))
 		BUG("traverse_trees() called with too many trees (%d)", n);
@@ -547,7 +561,7 @@ int traverse_trees(struct index_state *istate,
 	info->traverse_path = NULL;
 	strbuf_release(&base);
 
-	traverse_trees_cur_depth--;
+	stats->cur_depth--;
 	return error;
 }
 
@@ -108,6 +108,25 @@ typedef int (*traverse_callback_t)(int n, unsigned long mask, unsigned long dirm
  */
 int traverse_trees(struct index_state *istate, int n, struct tree_desc *t, struct traverse_info *info);
 
+/*
+ * The statistics traverse_trees() reports to trace2 at exit.
+ */
+struct traverse_trees_stats {
+	int count;
+	int cur_depth;
+	int max_depth;
+};
+
+/**
+ * Threads that traverse trees at the same time keep their statistics
+ * apart: each starts its own with `traverse_trees_stats_init()`, giving
+ * the number of traversals its own is nested in, points the `stats`
+ * member of its `traverse_info` at it, and the statistics are added to
+ * the others with `traverse_trees_add_stats()` once the threads are done.
+ */
+void traverse_trees_stats_init(struct traverse_trees_stats *stats, int depth);
+void traverse_trees_add_stats(const struct traverse_trees_stats *stats);
+
 enum get_oid_result get_tree_entry_follow_symlinks(struct repository *r, struct object_id *tree_oid, const char *name, struct object_id *result, struct strbuf *result_path, unsigned short *mode);
 
 /**
@@ -163,6 +182,9 @@ struct traverse_info {
 
 	/* tells whether to stop at the first error or not. */
 	int show_all_errors;
+
+	/* where to keep the statistics, if not with those of the process. */
+	struct traverse_trees_stats *stats;
 };
 
 /**
@@ -22,6 +22,7 @@
 #include "entry.h"
 #include "parallel-checkout.h"
 #include "sparse-index.h"
+#include "thread-utils.h"
 
 /*
  * Error messages expected by scripts out of plumbing commands such as
@@ -219,6 +220,67 @@ static void add_entry(struct unpack_trees_options *o,
 	do_add_entry(o, dup_cache_entry(ce, &o->result), set, clear);
 }
 
+/*
+ * The directories at the top of the trees can be unpacked by threads
+ * before the traversal gets to them; see unpack_subtrees_in_parallel().
+ * Each job works on its own copy of the options, with a result index
+ * of its own and a "src_index" that ends with the entries below its
+ * directory.
+ */
+struct unpack_job {
+	struct unpack_trees_options o;
+	struct index_state view;
+	struct name_entry names[MAX_UNPACK_TREES];
+	int n;
+	unsigned long dirmask;
+	int pos, end;
+	/* rejected paths in order, with the error type in "util" */
+	struct string_list rejects;
+	struct traverse_trees_stats stats;
+	int ret;
+};
+
+struct unpack_parallel {
+	struct index_state *src_index;
+	struct traverse_info *info;
+	pthread_mutex_t mutex;
+	int running, failed;
+	struct unpack_job *job;
+	int nr, alloc, next, done;
+};
+
+/*
+ * Lookups that need the whole of the source index, and the state that
+ * is shared between the jobs behind them (the cache-tree, the untracked
+ * cache, the excludes...), are serialized while the threads run.  The
+ * name hash is built before they start and only read while they run,
+ * so its lookups need no lock.
+ */
+static struct index_state *lock_src_index(struct unpack_trees_options *o)
+{
+	if (!o->parallel || !o->parallel->running)
+		return o->src_index;
+	pthread_mutex_lock(&o->parallel->mutex);
+	return o->parallel->src_index;
+}
+
+static void unlock_src_index(struct unpack_trees_options *o)
+{
+	if (o->parallel && o->parallel->running)
+		pthread_mutex_unlock(&o->parallel->mutex);
+}
+
+static unsigned src_index_match_stat(const struct cache_entry *ce,
+				     struct stat *st,
+				     struct unpack_trees_options *o)
+{
+	int flags = CE_MATCH_IGNORE_VALID|CE_MATCH_IGNORE_SKIP_WORKTREE;
+	unsigned changed = ie_match_stat(lock_src_index(o), ce, st, flags);
+
+	unlock_src_index(o);
+	return changed;
+}
+
 /*
  * add error messages on path <path>
  * corresponding to the type <e> with the message <msg>
@@ -231,6 +293,14 @@ static int add_rejected_path(struct unpack_trees_options *o,
 	if (o->quiet)
 		return -1;
 
+	if (o->parallel && o->parallel->running) {
+		/* replayed when the traversal gets to the directory */
+		struct unpack_job *job = container_of(o, struct unpack_job, o);
+
+		string_list_append(&job->rejects, path)->util = (void *)(intptr_t)e;
+		return -1;
+	}
+
 	if (!o->show_all_errors)
 		return error(ERRORMSG(o, e), super_prefixed(path));
 
@@ -455,14 +525,20 @@ static int check_updates(struct unpack_trees_options *o,
 	if (should_update_submodules())
 		load_gitmodules_file(index, &state);
 
-	if (has_promisor_remote())
+	get_parallel_checkout_configs(&pc_workers, &pc_threshold);
+
+	if (has_promisor_remote()) {
 		/*
 		 * Prefetch the objects that are to be checked out in the loop
-		 * below.
+		 * below. Unless parallel checkout is going to hand them to
+		 * its workers, this happens in the background, while the
+		 * loop writes out the entries that are already there.
 		 */
-		prefetch_cache_entries(index, must_checkout);
-
-	get_parallel_checkout_configs(&pc_workers, &pc_threshold);
+		if (pc_workers > 1)
+			prefetch_cache_entries(index, must_checkout);
+		else
+			prefetch_cache_entries_async(index, must_checkout);
+	}
 
 	enable_delayed_checkout(&state);
 	if (pc_workers > 1)
@@ -484,6 +560,7 @@ static int check_updates(struct unpack_trees_options *o,
 			sum_checkout++;
 		}
 	}
+	promisor_remote_prefetch_finish(the_repository);
 	if (pc_workers > 1)
 		errs |= run_parallel_checkout(&state, pc_workers, pc_threshold,
 					      progress, &cnt);
@@ -862,6 +939,62 @@ static int traverse_by_cache_tree(int pos, int nr_entries, int nr_names,
 	return 0;
 }
 
+/*
+ * If a thread already unpacked the directory "p" at the top of the
+ * trees, add its entries to the result and replay the errors it ran
+ * into, as if the traversal had just gone through it. Returns 1 and
+ * the result of the job in "ret" if it did.
+ */
+static int take_unpacked_subtree(struct unpack_trees_options *o,
+				 const struct name_entry *p, int *ret)
+{
+	struct unpack_parallel *q = o->parallel;
+	struct unpack_job *job;
+	struct index_state *result;
+	int i;
+
+	if (q->done >= q->nr)
+		return 0;
+	job = &q->job[q->done];
+	for (i = 0; !job->names[i].mode; i++)
+		; /* find the name, like the traversal does */
+	if (job->names[i].pathlen != p->pathlen ||
+	    memcmp(job->names[i].path, p->path, p->pathlen))
+		return 0;
+	q->done++;
+
+	for (i = 0; i < job->rejects.nr; i++)
+		add_rejected_path(o, (intptr_t)job->rejects.items[i].util,
+				  job->rejects.items[i].string);
+	o->nontrivial_merge |= job->o.nontrivial_merge;
+
+	/*
+	 * The entries below "p" sort after everything the traversal
+	 * added so far, and the thread already checked them when it
+	 * added them to its own result.
+	 */
+	result = &job->o.result;
+	if (result->ce_mem_pool) {
+		if (!o->result.ce_mem_pool) {
+			o->result.ce_mem_pool = xmalloc(sizeof(*o->result.ce_mem_pool));
+			mem_pool_init(o->result.ce_mem_pool, 0);
+		}
+		mem_pool_combine(o->result.ce_mem_pool, result->ce_mem_pool);
+	}
+	for (i = 0; i < result->cache_nr; i++) {
+		struct cache_entry *ce = result->cache[i];
+
+		ce->ce_flags &= ~CE_HASHED;
+		add_index_entry(&o->result, ce, ADD_CACHE_JUST_APPEND);
+	}
+	result->cache_nr = 0;
+	discard_index(result);
+	string_list_clear(&job->rejects, 0);
+
+	*ret = job->ret;
+	return 1;
+}
+
 static int traverse_trees_recursive(int n, unsigned long dirmask,
 				    unsigned long df_conflicts,
 				    struct name_entry *names,
@@ -876,6 +1009,14 @@ static int traverse_trees_recursive(int n, unsigned long dirmask,
 	struct name_entry *p;
 	int nr_entries;
 
+	p = names;
+	while (!p->mode)
+		p++;
+
+	if (o->parallel && !o->parallel->running && !info->prev &&
+	    take_unpacked_subtree(o, p, &ret))
+		return ret;
+
 	nr_entries = all_trees_same_as_cache_tree(n, dirmask, names, info);
 	if (nr_entries > 0) {
 		int pos = index_pos_by_traverse_info(names, info);
@@ -895,10 +1036,6 @@ static int traverse_trees_recursive(int n, unsigned long dirmask,
 		return ret;
 	}
 
-	p = names;
-	while (!p->mode)
-		p++;
-
 	newinfo = *info;
 	newinfo.prev = info;
 	newinfo.pathspec = info->pathspec;
@@ -1707,6 +1844,236 @@ static void populate_from_existing_patterns(struct unpack_trees_options *o,
 		o->pl = pl;
 }
 
+/*
+ * The top-level directories are unpacked by threads when there are at
+ * least this many entries in the index per thread.
+ */
+#define THREAD_COST (10000)
+#define MAX_PARALLEL (32)
+
+/*
+ * Queue the directories at the top of the trees that can be unpacked
+ * on their own: those that are not a file in any of the trees or in
+ * the index. Those the cache-tree already matches are left to the
+ * traversal, which goes through them quickly.
+ */
+static int queue_subtree(int n, unsigned long mask, unsigned long dirmask,
+			 struct name_entry *names, struct traverse_info *info)
+{
+	struct unpack_trees_options *o = info->data;
+	struct unpack_parallel *q = o->parallel;
+	struct index_state *istate = o->src_index;
+	const struct name_entry *p = names;
+	struct strbuf name = STRBUF_INIT;
+	struct unpack_job *job;
+	int pos, end;
+
+	if (mask != dirmask ||
+	    all_trees_same_as_cache_tree(n, dirmask, names, info))
+		return mask;
+
+	while (!p->mode)
+		p++;
+	strbuf_add(&name, p->path, p->pathlen);
+	pos = index_name_pos(istate, name.buf, name.len);
+	if (pos < 0)
+		pos = -pos - 1;
+	if (pos < istate->cache_nr &&
+	    !strcmp(istate->cache[pos]->name, name.buf))
+		goto out;
+
+	/* the entries below "name/" end where "name0" would go */
+	strbuf_addch(&name, '/');
+	pos = index_name_pos(istate, name.buf, name.len);
+	if (pos >= 0)
+		goto out;
+	pos = -pos - 1;
+	name.buf[name.len - 1] = '0';
+	end = index_name_pos(istate, name.buf, name.len);
+	if (end < 0)
+		end = -end - 1;
+
+	ALLOC_GROW(q->job, q->nr + 1, q->alloc);
+	job = &q->job[q->nr++];
+	memset(job, 0, sizeof(*job));
+	COPY_ARRAY(job->names, names, n);
+	job->n = n;
+	job->dirmask = dirmask;
+	job->pos = pos;
+	job->end = end;
+out:
+	strbuf_release(&name);
+	return mask;
+}
+
+static void unpack_subtree(struct unpack_job *job, struct traverse_info *top)
+{
+	struct unpack_trees_options *o = &job->o;
+	struct traverse_info info = *top;
+	struct cache_entry *ce;
+
+	info.data = o;
+	info.traverse_path = "";
+	info.stats = &job->stats;
+	job->ret = traverse_trees_recursive(job->n, job->dirmask, 0,
+					    job->names, &info);
+
+	/*
+	 * The index entries below the directory that are in none of
+	 * the trees; the traversal would unpack them before going on
+	 * with the next name.
+	 */
+	while ((!job->ret || o->show_all_errors) &&
+	       (ce = next_cache_entry(o)))
+		if (unpack_index_entry(ce, o) < 0)
+			job->ret = -1;
+}
+
+static void *unpack_thread(void *data)
+{
+	struct unpack_parallel *q = data;
+
+	for (;;) {
+		struct unpack_job *job;
+
+		pthread_mutex_lock(&q->mutex);
+		job = q->failed || q->next >= q->nr ? NULL : &q->job[q->next++];
+		pthread_mutex_unlock(&q->mutex);
+		if (!job)
+			break;
+
+		unpack_subtree(job, q->info);
+		if (job->ret < 0 && !job->o.show_all_errors) {
+			/* the traversal will not get past this one */
+			pthread_mutex_lock(&q->mutex);
+			q->failed = 1;
+			pthread_mutex_unlock(&q->mutex);
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Unpack the directories at the top of the trees in parallel, before
+ * the traversal gets to them; it then takes what the threads found
+ * in order (see take_unpacked_subtree()), so that the result and the
+ * errors are the same as without threads.
+ *
+ * This is only done for the merge functions of this file, which keep
+ * their state in the options and the result, and when nothing else
+ * needs the traversal to go in order (submodules, pathspecs, sparse
+ * directories or split indexes).
+ */
+static void unpack_subtrees_in_parallel(unsigned len, struct tree_desc *t,
+					struct traverse_info *info)
+{
+	struct unpack_trees_options *o = info->data;
+	struct unpack_parallel *q;
+	pthread_t threads[MAX_PARALLEL];
+	int nr_threads, cpus, had_lock, i;
+
+	if (!HAVE_THREADS || !o->merge || o->diff_index_cached ||
+	    o->debug_unpack || o->prefix || o->pathspec ||
+	    (o->fn != oneway_merge && o->fn != twoway_merge &&
+	     o->fn != threeway_merge) ||
+	    o->src_index->sparse_index || o->src_index->split_index ||
+	    should_update_submodules())
+		return;
+	if (git_config_get_index_threads(&nr_threads))
+		nr_threads = 0;
+	if (!nr_threads) {
+		nr_threads = o->src_index->cache_nr / THREAD_COST;
+		cpus = online_cpus();
+		if (nr_threads > cpus)
+			nr_threads = cpus;
+	}
+	if (nr_threads > MAX_PARALLEL)
+		nr_threads = MAX_PARALLEL;
+	if (nr_threads < 2)
+		return;
+
+	CALLOC_ARRAY(q, 1);
+	q->src_index = o->src_index;
+	q->info = info;
+	o->parallel = q;
+
+	info->fn = queue_subtree;
+	traverse_trees(o->src_index, len, t, info);
+	info->fn = unpack_callback;
+	if (nr_threads > q->nr)
+		nr_threads = q->nr;
+	if (nr_threads < 2) {
+		free(q->job);
+		FREE_AND_NULL(o->parallel);
+		return;
+	}
+
+	for (i = 0; i < q->nr; i++) {
+		struct unpack_job *job = &q->job[i];
+
+		job->o = *o;
+		/* only used to look for the entries of the job */
+		job->view = *o->src_index;
+		job->view.cache_nr = job->end;
+		job->o.src_index = &job->view;
+		job->o.cache_bottom = job->pos;
+		memset(&job->o.result, 0, sizeof(job->o.result));
+		job->o.result.initialized = 1;
+		job->o.result.version = o->result.version;
+		memset(job->o.unpack_rejects, 0, sizeof(job->o.unpack_rejects));
+		string_list_init_dup(&job->rejects);
+		/* as if below the top-level traverse_trees() */
+		traverse_trees_stats_init(&job->stats, 1);
+	}
+
+	trace2_region_enter("unpack_trees", "unpack_subtrees", the_repository);
+	trace2_data_intmax("unpack_trees", the_repository,
+			   "unpack_subtrees/threads", nr_threads);
+	trace2_data_intmax("unpack_trees", the_repository,
+			   "unpack_subtrees/jobs", q->nr);
+
+	/* Load the settings the merge functions look at lazily */
+	gvfs_config_is_set(GVFS_NO_DELETE_OUTSIDE_SPARSECHECKOUT);
+
+	had_lock = obj_read_use_lock;
+	enable_obj_read_lock();
+	if (ignore_case)
+		prepare_name_hash(o->src_index);
+	pthread_mutex_init(&q->mutex, NULL);
+	q->running = 1;
+	for (i = 0; i < nr_threads; i++) {
+		int err = pthread_create(&threads[i], NULL, unpack_thread, q);
+		if (err)
+			die(_("unable to create unpack_trees thread: %s"),
+			    strerror(err));
+	}
+	for (i = 0; i < nr_threads; i++)
+		if (pthread_join(threads[i], NULL))
+			die(_("unable to join unpack_trees thread"));
+	q->running = 0;
+	for (i = 0; i < q->nr; i++)
+		traverse_trees_add_stats(&q->job[i].stats);
+	pthread_mutex_destroy(&q->mutex);
+	if (!had_lock)
+		disable_obj_read_lock();
+
+	trace2_region_leave("unpack_trees", "unpack_subtrees", the_repository);
+}
+
+static void clear_unpack_parallel(struct unpack_trees_options *o)
+{
+	struct unpack_parallel *q = o->parallel;
+	int i;
+
+	if (!q)
+		return;
+	for (i = q->done; i < q->nr; i++) {
+		discard_index(&q->job[i].o.result);
+		string_list_clear(&q->job[i].rejects, 0);
+	}
+	free(q->job);
+	FREE_AND_NULL(o->parallel);
+}
 
 static int verify_absent(const struct cache_entry *,
 			 enum unpack_trees_error_types,
@@ -1818,7 +2185,9 @@ int unpack_trees(unsigned len, struct tree_desc *t, struct unpack_trees_options
 
 		trace_performance_enter();
 		trace2_region_enter("unpack_trees", "traverse_trees", the_repository);
+		unpack_subtrees_in_parallel(len, t, &info);
 		ret = traverse_trees(o->src_index, len, t, &info);
+		clear_unpack_parallel(o);
 		trace2_region_leave("unpack_trees", "traverse_trees", the_repository);
 		trace_performance_leave("traverse_trees");
 		if (ret < 0)
@@ -2038,8 +2407,7 @@ static int verify_uptodate_1(const struct cache_entry *ce,
 		return 0;
 
 	if (!lstat(ce->name, &st)) {
-		int flags = CE_MATCH_IGNORE_VALID|CE_MATCH_IGNORE_SKIP_WORKTREE;
-		unsigned changed = ie_match_stat(o->src_index, ce, &st, flags);
+		unsigned changed = src_index_match_stat(ce, &st, o);
 
 		if (submodule_from_ce(ce)) {
 			int r = check_submodule_move_head(ce,
@@ -2094,10 +2462,14 @@ static int verify_uptodate_sparse(const struct cache_entry *ce,
 static void invalidate_ce_path(const struct cache_entry *ce,
 			       struct unpack_trees_options *o)
 {
+	struct index_state *istate;
+
 	if (!ce)
 		return;
-	cache_tree_invalidate_path(o->src_index, ce->name);
-	untracked_cache_invalidate_path(o->src_index, ce->name, 1);
+	istate = lock_src_index(o);
+	cache_tree_invalidate_path(istate, ce->name);
+	untracked_cache_invalidate_path(istate, ce->name, 1);
+	unlock_src_index(o);
 }
 
 /*
@@ -2130,7 +2502,11 @@ static int verify_clean_subdirectory(const struct cache_entry *ce,
 
 	if (S_ISGITLINK(ce->ce_mode)) {
 		struct object_id oid;
-		int sub_head = resolve_gitlink_ref(ce->name, "HEAD", &oid);
+		int sub_head;
+
+		lock_src_index(o);
+		sub_head = resolve_gitlink_ref(ce->name, "HEAD", &oid);
+		unlock_src_index(o);
 		/*
 		 * If we are not going to update the submodule, then
 		 * we don't care.
@@ -2178,7 +2554,8 @@ static int verify_clean_subdirectory(const struct cache_entry *ce,
 	memset(&d, 0, sizeof(d));
 	if (o->dir)
 		d.exclude_per_dir = o->dir->exclude_per_dir;
-	i = read_directory(&d, o->src_index, pathbuf, namelen+1, NULL);
+	i = read_directory(&d, lock_src_index(o), pathbuf, namelen+1, NULL);
+	unlock_src_index(o);
 	if (i)
 		return add_rejected_path(o, ERROR_NOT_UPTODATE_DIR, ce->name);
 	free(pathbuf);
@@ -2195,10 +2572,13 @@ static int verify_clean_subdirectory(const struct cache_entry *ce,
  */
 static int icase_exists(struct unpack_trees_options *o, const char *name, int len, struct stat *st)
 {
+	struct index_state *istate = o->src_index;
 	const struct cache_entry *src;
 
-	src = index_file_exists(o->src_index, name, len, 1);
-	return src && !ie_match_stat(o->src_index, src, st, CE_MATCH_IGNORE_VALID|CE_MATCH_IGNORE_SKIP_WORKTREE);
+	if (o->parallel && o->parallel->running)
+		istate = o->parallel->src_index;
+	src = index_file_exists(istate, name, len, 1);
+	return src && !src_index_match_stat(src, st, o);
 }
 
 static int check_ok_to_remove(const char *name, int len, int dtype,
@@ -2207,6 +2587,7 @@ static int check_ok_to_remove(const char *name, int len, int dtype,
 			      struct unpack_trees_options *o)
 {
 	const struct cache_entry *result;
+	int excluded = 0;
 
 	/*
 	 * It may be that the 'lstat()' succeeded even though
@@ -2218,8 +2599,11 @@ static int check_ok_to_remove(const char *name, int len, int dtype,
 	if (ignore_case && icase_exists(o, name, len, st))
 		return 0;
 
-	if (o->dir &&
-	    is_excluded(o->dir, o->src_index, name, &dtype))
+	if (o->dir) {
+		excluded = is_excluded(o->dir, lock_src_index(o), name, &dtype);
+		unlock_src_index(o);
+	}
+	if (excluded)
 		/*
 		 * ce->name is explicitly excluded, so it is Ok to
 		 * overwrite it.
@@ -2266,7 +2650,9 @@ static int verify_absent_1(const struct cache_entry *ce,
 	if (o->index_only || o->reset || !o->update)
 		return 0;
 
+	lock_src_index(o);
 	len = check_leading_path(ce->name, ce_namelen(ce), 0);
+	unlock_src_index(o);
 	if (!len)
 		return 0;
 	else if (len > 0) {
@@ -2752,8 +3138,7 @@ int oneway_merge(const struct cache_entry * const *src,
 		if (o->reset && o->update && !ce_uptodate(old) && !ce_skip_worktree(old) &&
 			!(old->ce_flags & CE_FSMONITOR_VALID)) {
 			struct stat st;
-			if (lstat(old->name, &st) ||
-			    ie_match_stat(o->src_index, old, &st, CE_MATCH_IGNORE_VALID|CE_MATCH_IGNORE_SKIP_WORKTREE))
+			if (lstat(old->name, &st) || src_index_match_stat(old, &st, o))
 				update |= CE_UPDATE;
 		}
 		if (o->update && S_ISGITLINK(old->ce_mode) &&
@@ -11,6 +11,7 @@
 struct cache_entry;
 struct unpack_trees_options;
 struct pattern_list;
+struct unpack_parallel;
 
 typedef int (*merge_fn_t)(const struct cache_entry * const *src,
 		struct unpack_trees_options *options);
@@ -88,6 +89,7 @@ struct unpack_trees_options {
 	struct index_state result;
 
 	struct pattern_list *pl; /* for internal use */
+	struct unpack_parallel *parallel; /* for internal use */
 	struct checkout_metadata meta;
 };
 
@@ -2,6 +2,7 @@
 #include "wt-status.h"
 #include "pkt-line.h"
 #include "trace.h"
+#include "simple-ipc.h"
 
 static void set_deserialize_reject_reason(const char *reason)
 {
@@ -36,11 +37,21 @@ static int check_path_contains(const char *out, int out_len, const char *in, int
 		!memcmp(out, in, out_len));
 }
 
+/*
+ * Serialized data received from the status daemon.  When set, it is
+ * parsed instead of reading from the file descriptor (which is then -1).
+ */
+static char *deserialize_src_buf;
+static size_t deserialize_src_len;
+
 static const char *my_packet_read_line(int fd, int *line_len)
 {
 	static char buf[LARGE_PACKET_MAX];
 
-	*line_len = packet_read(fd, NULL, NULL, buf, sizeof(buf),
+	*line_len = packet_read(fd,
+				deserialize_src_buf ? &deserialize_src_buf : NULL,
+				deserialize_src_buf ? &deserialize_src_len : NULL,
+				buf, sizeof(buf),
 				PACKET_READ_CHOMP_NEWLINE |
 				PACKET_READ_GENTLE_ON_EOF);
 	return (*line_len > 0) ? buf : NULL;
@@ -819,6 +830,14 @@ static int try_deserialize_read_from_file(const struct wt_status *cmd_s,
 	return result;
 }
 
+static void wt_status_deserialize_print(const struct wt_status *cmd_s,
+					struct wt_status *des_s)
+{
+	wt_status_get_state(cmd_s->repo, &des_s->state, des_s->branch &&
+			    !strcmp(des_s->branch, "HEAD"));
+	wt_status_print(des_s);
+}
+
 /*
  * Read raw serialized status data from the given file (or STDIN).
  *
@@ -858,11 +877,69 @@ int wt_status_deserialize(const struct wt_status *cmd_s,
 
 	trace2_region_leave("status", "deserialize", the_repository);
 
-	if (result == DESERIALIZE_OK) {
-		wt_status_get_state(cmd_s->repo, &des_s.state, des_s.branch &&
-				    !strcmp(des_s.branch, "HEAD"));
-		wt_status_print(&des_s);
+	if (result == DESERIALIZE_OK)
+		wt_status_deserialize_print(cmd_s, &des_s);
+
+	return result;
+}
+
+GIT_PATH_FUNC(wt_status_daemon_ipc_path, "status--daemon.ipc")
+
+#ifdef SUPPORTS_SIMPLE_IPC
+int wt_status_deserialize_from_daemon(const struct wt_status *cmd_s)
+{
+	struct ipc_client_connect_options options
+		= IPC_CLIENT_CONNECT_OPTIONS_INIT;
+	struct strbuf request = STRBUF_INIT;
+	struct strbuf answer = STRBUF_INIT;
+	struct wt_status des_s;
+	int result = DESERIALIZE_ERR;
+
+	trace2_region_enter("status", "deserialize", the_repository);
+
+	/*
+	 * The daemon computes status for the untracked and ignored
+	 * modes we ask for.  It also uses our idea of HEAD to notice
+	 * when its cached results belong to another commit.
+	 */
+	strbuf_addf(&request, "status %d %d %s %s",
+		    cmd_s->show_untracked_files, cmd_s->show_ignored_mode,
+		    oid_to_hex(&cmd_s->oid_commit),
+		    cmd_s->branch ? cmd_s->branch : "");
+
+	options.wait_if_busy = 1;
+	if (ipc_client_send_command(wt_status_daemon_ipc_path(), &options,
+				    request.buf, request.len, &answer)) {
+		set_deserialize_reject_reason("status-daemon/unavailable");
+		trace_printf_key(&trace_deserialize, "no status daemon");
+	} else if (!answer.len) {
+		set_deserialize_reject_reason("status-daemon/no-data");
+		trace_printf_key(&trace_deserialize, "status daemon sent no data");
+	} else {
+		deserialize_src_buf = answer.buf;
+		deserialize_src_len = answer.len;
+		result = wt_deserialize_fd(cmd_s, &des_s, -1);
+		deserialize_src_buf = NULL;
+		deserialize_src_len = 0;
 	}
 
+	trace2_data_string("status", the_repository, "deserialize/path",
+			   "status--daemon");
+	trace2_data_string("status", the_repository, "deserialize/result",
+			   ((result == DESERIALIZE_OK) ? "ok" : "reject"));
+	trace2_region_leave("status", "deserialize", the_repository);
+
+	if (result == DESERIALIZE_OK)
+		wt_status_deserialize_print(cmd_s, &des_s);
+
+	strbuf_release(&request);
+	strbuf_release(&answer);
 	return result;
 }
+#else
+int wt_status_deserialize_from_daemon(const struct wt_status *cmd_s)
+{
+	set_deserialize_reject_reason("status-daemon/unsupported");
+	return DESERIALIZE_ERR;
+}
+#endif
@@ -55,11 +55,19 @@ static void append_core_excludes_file_info(int fd)
 	 *
 	 * The "core.excludefile" setting defaults to $XDG_HOME/git/ignore
 	 * and uses a global variable which should have been set during
-	 * wt_status_collect_untracked().
+	 * wt_status_collect_untracked().  With "-uno" that is never
+	 * called, so fall back to the default here like the deserialize
+	 * code does.
 	 *
 	 * See dir.c:setup_standard_excludes()
 	 */
-	append_exclude_info(fd, excludes_file, "core_excludes");
+	if (excludes_file) {
+		append_exclude_info(fd, excludes_file, "core_excludes");
+	} else {
+		char *path = xdg_config_home("ignore");
+		append_exclude_info(fd, path, "core_excludes");
+		free(path);
+	}
 }
 
 static void append_repo_excludes_file_info(int fd)
@@ -245,6 +245,19 @@ int wt_status_deserialize(const struct wt_status *cmd_s,
 
 int wt_status_deserialize_access(const char *path, int mode);
 
+/*
+ * The simple-ipc path that `git status--daemon` listens on.
+ */
+const char *wt_status_daemon_ipc_path(void);
+
+/*
+ * Like wt_status_deserialize(), but ask a running `git status--daemon`
+ * for the status results instead of reading them from a file.  Returns
+ * DESERIALIZE_ERR if no daemon is listening or its results cannot be
+ * used for this command.
+ */
+int wt_status_deserialize_from_daemon(const struct wt_status *cmd_s);
+
 /*
  * A helper routine for serialize and deserialize to compute
  * metadata for the user-global and repo-local excludes files.